@@ -23,22 +23,17 @@ const int TURNTABLE_B = 19;
 struct Potentiometer
 {
     Potentiometer(float slope, float intercept) :
-      m{slope}, b{intercept}, estimate{0.0} {}
+      m{slope}, b{intercept} {}
 
     float m{}; //the slope of the linear graph
     float b{}; //the y intercept of the linear
-    float estimate{}; //uses exponential smoothing 
 
     float getPosition(uint16_t val)
     {
-        // 4 is the coefficient that represents how much we trust the estimate
-        // vs how much we trust the newest reading. The lower this coefficient, the
-        // more noise we have. The higher the coefficient, the more polluted our 
-        // result becomes with erroneous noise data. 4 seems to be a good middle
-        // ground.
-        float new_estimate = 0.0174533*(m*val + b);
-        estimate += (new_estimate - estimate)/4;
-        return estimate;
+        // Raw on purpose, the host filters these knowing what it drove the
+        // joints with, smoothing here would only add lag it can't see. With
+        // ~kalman_filter off the host smooths them the way this used to
+        return 0.0174533*(m*val + b);
     }
 };
 
@@ -68,6 +63,7 @@ PositionQuadrature turntable(TURNTABLE_CPR, TURNTABLE_A, TURNTABLE_B);
 VelocityQuadrature gearbox_left(GEARBOX_CPR, GEARBOX_LEFT_A, GEARBOX_LEFT_B);
 tfr_msgs::ArduinoAReading arduinoReading;
 ros::Publisher arduino("arduino_a", &arduinoReading);
+uint32_t sequence = 0;
 
 //potentiometers
 /*
@@ -97,6 +93,9 @@ void setup()
 
 void loop()
 {
+    //stamp with the time we start sampling, the host uses it to detect stale data
+    arduinoReading.header.stamp = nh.now();
+    arduinoReading.header.seq = sequence++;
     arduinoReading.tread_left_vel = gearbox_left.getVelocity() * GEARBOX_MPR;
     arduinoReading.arm_turntable_pos = turntable.getPosition()  * TURNTABLE_RPR;
 
@@ -46,6 +46,7 @@ VelocityQuadrature gearbox_right(CPR, GEARBOX_RIGHT_A, GEARBOX_RIGHT_B);
 //TODO Quadrature turntable(CPR, GEARBOX_LEFT_A, GEARBOX_LEFT_B);
 tfr_msgs::ArduinoBReading arduino_reading;
 ros::Publisher arduino("arduino_b", &arduino_reading);
+uint32_t sequence = 0;
 void motorOutput(const tfr_msgs::PwmCommand& command);
 ros::Subscriber<tfr_msgs::PwmCommand> motor_subscriber("/motor_output", &motorOutput );
 
@@ -80,6 +81,9 @@ void setup()
 
 void loop()
 {
+    //stamp with the time we sample, the host uses it to detect stale data
+    arduino_reading.header.stamp = nh.now();
+    arduino_reading.header.seq = sequence++;
     arduino_reading.tread_right_vel = gearbox_right.getVelocity()/GEARBOX_MPR;
     delay(8);
     nh.spinOnce(); //I know we don't have any callbacks, but the libary needs this call
@@ -0,0 +1,106 @@
+/****************************************************************************************
+ * File:            actuator_calibration.h
+ *
+ * Purpose:         Measures the velocity vs pwm curve of each arm actuator
+ *                  for the feedforward tables, and the fastest each joint
+ *                  moves and accelerates for the arm's trajectory timing.
+ *
+ *                  One joint at a time, we step through pwm levels up to
+ *                  max_pwm. Each level is run forward then backward so the
+ *                  joint ends up about where it started. Each run settles
+ *                  first, then the velocity is measured from the position
+ *                  feedback. A run that travels more than max_travel is
+ *                  cut short to keep the joint off its limits.
+ *
+ *                  The acceleration comes from how far a run got while it
+ *                  settled: speeding up at a to v then holding v covers
+ *                  v t - v^2 / 2a in t. The limits are the fastest velocity
+ *                  seen and the lowest acceleration at the highest pwm, and
+ *                  are written in the format of MoveIt's joint_limits.yaml.
+ *
+ *                  Driven by the control loop, only call it from there.
+ ***************************************************************************************/
+#ifndef ACTUATOR_CALIBRATION_H
+#define ACTUATOR_CALIBRATION_H
+
+#include <string>
+#include <vector>
+#include "robot_interface.h"
+#include "hardware_experiment.h"
+
+namespace tfr_control
+{
+    class ActuatorCalibration : public HardwareExperiment
+    {
+    public:
+        struct Settings
+        {
+            //pwm levels per direction, evenly spaced up to max_pwm
+            int steps;
+            double max_pwm;
+            //seconds to let the actuator get up to speed, then to measure
+            double settle_time;
+            double measure_time;
+            //furthest (rad) a single run may move the joint
+            double max_travel;
+            //where to write the measured joint limits, empty for nowhere,
+            //it's overwritten with only what was measured
+            std::string limits_file;
+        };
+
+        /*
+         * names are the URDF names of joints, used as keys in the saved file
+         * */
+        ActuatorCalibration(const Settings &settings,
+                const std::vector<Joint> &joints,
+                const std::vector<std::string> &names);
+        ActuatorCalibration(const ActuatorCalibration&) = delete;
+        ActuatorCalibration& operator=(const ActuatorCalibration&) = delete;
+        ActuatorCalibration(ActuatorCalibration&&) = delete;
+        ActuatorCalibration& operator=(ActuatorCalibration&&) = delete;
+
+        /*
+         * Runs the next bit of the sweep, now is in seconds. Returns true
+         * once every joint has been measured, the robot is left holding.
+         * */
+        bool update(RobotInterface &robot, const double &now) override;
+
+        /*
+         * Writes the tables as yaml, for the feedforward parameters of the
+         * control node, and the limits to limits_file
+         * */
+        bool save(const std::string &path) const override;
+
+    private:
+        enum class Phase
+        {
+            SETTLE,
+            MEASURE
+        };
+
+        const Settings settings;
+        const std::vector<Joint> joints;
+        const std::vector<std::string> names;
+        //measured pwm and velocity for each joint
+        std::vector<std::vector<double>> pwm;
+        std::vector<std::vector<double>> velocity;
+        //acceleration (rad/s^2) each run came up to speed at, by pwm too
+        std::vector<std::vector<double>> acceleration;
+
+        //where we are in the sweep
+        size_t joint;
+        int run;
+        Phase phase;
+        double phase_start;
+        double settle_time;
+        double run_start_position;
+        double measure_start_position;
+
+        //pwm of the current run, runs alternate direction
+        double runPWM() const;
+        void startRun(RobotInterface &robot, const double &now);
+        bool saveLimits() const;
+    };
+}
+
+#endif // ACTUATOR_CALIBRATION_H
@@ -0,0 +1,50 @@
+/****************************************************************************************
+ * File:            arduino_backend.h
+ *
+ * Purpose:         The real robot. Readings come in on /sensors/arduino_a and
+ *                  /sensors/arduino_b and are handed to the control loop
+ *                  through a TripleBuffer, pwm goes out on /motor_output.
+ ***************************************************************************************/
+#ifndef ARDUINO_BACKEND_H
+#define ARDUINO_BACKEND_H
+
+#include <ros/ros.h>
+#include <tfr_msgs/ArduinoAReading.h>
+#include <tfr_msgs/ArduinoBReading.h>
+#include <tfr_msgs/PwmCommand.h>
+#include "hardware_backend.h"
+#include "triple_buffer.h"
+
+namespace tfr_control
+{
+    class ArduinoBackend : public HardwareBackend
+    {
+    public:
+        explicit ArduinoBackend(ros::NodeHandle &n);
+        ArduinoBackend(const ArduinoBackend&) = delete;
+        ArduinoBackend& operator=(const ArduinoBackend&) = delete;
+        ArduinoBackend(ArduinoBackend&&) = delete;
+        ArduinoBackend& operator=(ArduinoBackend&&) = delete;
+
+        bool readArduinoA(ArduinoAData &data) override;
+        bool readArduinoB(ArduinoBData &data) override;
+        void write(const tfr_msgs::PwmCommand &command) override;
+
+    private:
+        //written by the subscriber callbacks, read once per control cycle
+        //NOTE declared before the subscribers so they exist before any callback
+        TripleBuffer<ArduinoAData> arduino_a_buffer;
+        TripleBuffer<ArduinoBData> arduino_b_buffer;
+
+        ros::Subscriber arduino_a;
+        ros::Subscriber arduino_b;
+        ros::Publisher pwm_publisher;
+
+        void receiveArduinoA(const tfr_msgs::ArduinoAReadingConstPtr &msg);
+        void receiveArduinoB(const tfr_msgs::ArduinoBReadingConstPtr &msg);
+
+        static double stampOf(const std_msgs::Header &header);
+    };
+}
+
+#endif // ARDUINO_BACKEND_H
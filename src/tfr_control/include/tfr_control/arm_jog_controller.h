@@ -0,0 +1,85 @@
+/****************************************************************************************
+ * File:            arm_jog_controller.h
+ *
+ * Purpose:         A ros_control controller that moves the arm at a commanded
+ *                  velocity per joint, for smooth teleop positioning.
+ *
+ *                  Operators stream tfr_msgs/ArmJog velocities, and each update
+ *                  the controller integrates the latest one into the position
+ *                  targets of the arm joints, clamped to the joint limits and
+ *                  velocities in the robot description. A target never gets
+ *                  more than max_lead ahead of its joint, so a joint that
+ *                  can't keep up doesn't wind up a target it carries on to
+ *                  after the jog ends. When the jog ends, on a zero jog or
+ *                  when no command arrives for deadman_timeout, the arm holds
+ *                  where it is measured to be.
+ *
+ *                  It claims the same joints as the arm trajectory controllers,
+ *                  so the control node switches between them, see
+ *                  /toggle_arm_jog. On starting it holds the arm where it is.
+ *
+ *                  Loaded by the control node's controller manager, see
+ *                  config/controllers.yaml for its parameters.
+ *
+ * Subscribed To:   /arm_jog
+ ***************************************************************************************/
+#ifndef ARM_JOG_CONTROLLER_H
+#define ARM_JOG_CONTROLLER_H
+
+#include <ros/ros.h>
+#include <controller_interface/controller.h>
+#include <hardware_interface/joint_command_interface.h>
+#include <realtime_tools/realtime_buffer.h>
+#include <tfr_msgs/ArmJog.h>
+#include <vector>
+
+namespace tfr_control
+{
+    class ArmJogController :
+        public controller_interface::Controller<hardware_interface::PositionJointInterface>
+    {
+    public:
+        ArmJogController();
+        ArmJogController(const ArmJogController&) = delete;
+        ArmJogController& operator=(const ArmJogController&) = delete;
+        ArmJogController(ArmJogController&&) = delete;
+        ArmJogController& operator=(ArmJogController&&) = delete;
+
+        bool init(hardware_interface::PositionJointInterface *hw,
+                ros::NodeHandle &root, ros::NodeHandle &n) override;
+        void starting(const ros::Time &time) override;
+        void update(const ros::Time &time, const ros::Duration &period) override;
+
+    private:
+        //latest velocities from /arm_jog
+        struct Command
+        {
+            std::vector<double> velocity;
+            ros::Time stamp;
+        };
+
+        std::vector<hardware_interface::JointHandle> joints;
+        //from the robot description (rad, rad/s)
+        std::vector<double> lower_limits;
+        std::vector<double> upper_limits;
+        std::vector<double> velocity_limits;
+        //seconds without a command before the arm holds
+        double deadman_timeout;
+        //furthest a target may get from its joint (rad)
+        double max_lead;
+
+        realtime_tools::RealtimeBuffer<Command> command;
+        ros::Subscriber jog_subscriber;
+
+        //owned by the control thread
+        std::vector<double> targets;
+        //whether a nonzero jog moved the targets last update
+        bool jogging;
+        //commands from before we started don't count
+        ros::Time start_time;
+
+        void jogCallback(const tfr_msgs::ArmJog::ConstPtr &msg);
+    };
+}
+
+#endif // ARM_JOG_CONTROLLER_H
@@ -0,0 +1,99 @@
+/****************************************************************************************
+ * File:            arm_kinematics.h
+ *
+ * Purpose:         Closed form kinematics of the digging arm.
+ *
+ *                  The arm is a turntable carrying a planar chain, the lower
+ *                  arm, upper arm and scoop all pitch about parallel axes, and
+ *                  nothing is offset sideways. So every point of the arm lies
+ *                  in the vertical plane through the turntable axis, and a
+ *                  tip pose is fully described by its position and its pitch,
+ *                  its heading always points along the plane.
+ *
+ *                  Inverse kinematics then falls apart into pieces with exact
+ *                  answers: the heading gives the turntable, the tip's pitch
+ *                  and offset give where the scoop joint has to be, and the
+ *                  lower and upper arm are a two link planar arm with an
+ *                  elbow up and an elbow down answer. So there are at most two
+ *                  solutions, plus turntable angles a full turn apart, found
+ *                  with a handful of trig calls.
+ *
+ *                  Angles are in radians and lengths in meters, joints are in
+ *                  the order turntable, lower arm, upper arm, scoop.
+ *
+ *                  This class knows nothing about ROS, see
+ *                  arm_kinematics_plugin.h for the MoveIt plugin built on it.
+ ***************************************************************************************/
+#ifndef ARM_KINEMATICS_H
+#define ARM_KINEMATICS_H
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace tfr_control
+{
+    class ArmKinematics
+    {
+    public:
+        using Joints = std::array<double, 4>;
+
+        /*
+         * Where each joint sits in its parent's frame, all of the pitch
+         * joints turn about y and only have x and z offsets
+         * */
+        struct Geometry
+        {
+            //turntable axis in the base frame, and its heading at zero
+            double base_x, base_y, base_z, base_yaw;
+            //lower arm joint in the turntable frame
+            double shoulder_x, shoulder_z;
+            //upper arm joint in the lower arm frame
+            double elbow_x, elbow_z;
+            //scoop joint in the upper arm frame
+            double wrist_x, wrist_z;
+            //the tip in the scoop frame
+            double tip_x, tip_z;
+        };
+
+        struct Pose
+        {
+            double x, y, z;
+            //heading of the arm's plane, and pitch of the tip in it
+            double yaw, pitch;
+        };
+
+        ArmKinematics(const Geometry &geometry, const Joints &lower, const Joints &upper);
+        ArmKinematics(const ArmKinematics&) = default;
+        ArmKinematics& operator=(const ArmKinematics&) = default;
+        ~ArmKinematics() = default;
+
+        const Geometry& getGeometry() const;
+
+        Pose forward(const Joints &joints) const;
+
+        /*
+         * Every set of joints within the limits that puts the tip at the
+         * pose. The position has to lie in the vertical plane through the
+         * turntable axis along yaw, either ahead of the axis or behind it,
+         * reaching back over the turntable. Empty when it's out of reach.
+         * */
+        std::vector<Joints> inverse(const Pose &pose) const;
+
+        //angle in (-pi, pi]
+        static double wrap(double angle);
+
+    private:
+        Geometry geometry;
+        Joints lower;
+        Joints upper;
+        //the lower and upper arm in polar form, length and angle off the
+        //joint's zero direction
+        double lower_length, lower_angle;
+        double upper_length, upper_angle;
+
+        bool withinLimits(size_t joint, double angle) const;
+    };
+}
+
+#endif // ARM_KINEMATICS_H
@@ -0,0 +1,139 @@
+/****************************************************************************************
+ * File:            arm_kinematics_plugin.h
+ *
+ * Purpose:         A MoveIt kinematics plugin for the arm_end group that solves
+ *                  inverse kinematics in closed form with ArmKinematics, instead
+ *                  of iterating towards an answer like KDL does.
+ *
+ *                  Every solution is found at once in a few microseconds, so
+ *                  the search calls never actually search, they try the
+ *                  solutions nearest the seed first. The multiple solution
+ *                  getPositionIK returns all of them.
+ *
+ *                  The geometry is read from the robot description when the
+ *                  plugin is initialized, and it refuses groups that don't have
+ *                  the shape ArmKinematics needs: a turntable about z followed
+ *                  by three joints about parallel y axes with no sideways
+ *                  offsets, the tip fixed to the last link.
+ *
+ *                  A 4 DOF arm can't reach every orientation, a target's
+ *                  orientation has to be one the arm can hold at its position
+ *                  to within orientation_tolerance, or with position_only_ik
+ *                  set the orientation is ignored and the scoop keeps the pitch
+ *                  of the seed.
+ *
+ *                  Set up in tfr_moveit/config/kinematics.yaml, compare it to
+ *                  other solvers with ik_benchmark.
+ *
+ * Parameters:      position_only_ik - ignore the target orientation (bool, false)
+ *                  orientation_tolerance - how far (rad) a target orientation
+ *                      may be from one the arm can reach (double, 0.001)
+ ***************************************************************************************/
+#ifndef ARM_KINEMATICS_PLUGIN_H
+#define ARM_KINEMATICS_PLUGIN_H
+
+#include <moveit/kinematics_base/kinematics_base.h>
+#include <Eigen/Geometry>
+#include <memory>
+#include <string>
+#include <vector>
+#include "arm_kinematics.h"
+
+namespace tfr_control
+{
+    class ArmKinematicsPlugin : public kinematics::KinematicsBase
+    {
+    public:
+        ArmKinematicsPlugin();
+        ArmKinematicsPlugin(const ArmKinematicsPlugin&) = delete;
+        ArmKinematicsPlugin& operator=(const ArmKinematicsPlugin&) = delete;
+        ArmKinematicsPlugin(ArmKinematicsPlugin&&) = delete;
+        ArmKinematicsPlugin& operator=(ArmKinematicsPlugin&&) = delete;
+
+        bool initialize(const std::string &robot_description, const std::string &group_name,
+                const std::string &base_frame, const std::string &tip_frame,
+                double search_discretization) override;
+
+        bool getPositionIK(const geometry_msgs::Pose &ik_pose,
+                const std::vector<double> &ik_seed_state,
+                std::vector<double> &solution,
+                moveit_msgs::MoveItErrorCodes &error_code,
+                const kinematics::KinematicsQueryOptions &options =
+                    kinematics::KinematicsQueryOptions()) const override;
+
+        /*
+         * Every solution for the single pose, nearest the seed first
+         * */
+        bool getPositionIK(const std::vector<geometry_msgs::Pose> &ik_poses,
+                const std::vector<double> &ik_seed_state,
+                std::vector<std::vector<double>> &solutions,
+                kinematics::KinematicsResult &result,
+                const kinematics::KinematicsQueryOptions &options) const override;
+
+        bool searchPositionIK(const geometry_msgs::Pose &ik_pose,
+                const std::vector<double> &ik_seed_state,
+                double timeout,
+                std::vector<double> &solution,
+                moveit_msgs::MoveItErrorCodes &error_code,
+                const kinematics::KinematicsQueryOptions &options =
+                    kinematics::KinematicsQueryOptions()) const override;
+
+        bool searchPositionIK(const geometry_msgs::Pose &ik_pose,
+                const std::vector<double> &ik_seed_state,
+                double timeout,
+                const std::vector<double> &consistency_limits,
+                std::vector<double> &solution,
+                moveit_msgs::MoveItErrorCodes &error_code,
+                const kinematics::KinematicsQueryOptions &options =
+                    kinematics::KinematicsQueryOptions()) const override;
+
+        bool searchPositionIK(const geometry_msgs::Pose &ik_pose,
+                const std::vector<double> &ik_seed_state,
+                double timeout,
+                std::vector<double> &solution,
+                const IKCallbackFn &solution_callback,
+                moveit_msgs::MoveItErrorCodes &error_code,
+                const kinematics::KinematicsQueryOptions &options =
+                    kinematics::KinematicsQueryOptions()) const override;
+
+        bool searchPositionIK(const geometry_msgs::Pose &ik_pose,
+                const std::vector<double> &ik_seed_state,
+                double timeout,
+                const std::vector<double> &consistency_limits,
+                std::vector<double> &solution,
+                const IKCallbackFn &solution_callback,
+                moveit_msgs::MoveItErrorCodes &error_code,
+                const kinematics::KinematicsQueryOptions &options =
+                    kinematics::KinematicsQueryOptions()) const override;
+
+        /*
+         * Only the tip frame is supported
+         * */
+        bool getPositionFK(const std::vector<std::string> &link_names,
+                const std::vector<double> &joint_angles,
+                std::vector<geometry_msgs::Pose> &poses) const override;
+
+        const std::vector<std::string>& getJointNames() const override;
+        const std::vector<std::string>& getLinkNames() const override;
+
+    private:
+        std::unique_ptr<ArmKinematics> arm;
+        //rotation of the tip frame in the last link's frame
+        Eigen::Matrix3d tip_rotation;
+        std::vector<std::string> joint_names;
+        std::vector<std::string> link_names;
+
+        bool position_only_ik;
+        double orientation_tolerance;
+
+        /*
+         * Every solution for the pose within the consistency limits (which may
+         * be empty) around the seed, nearest the seed first
+         * */
+        std::vector<ArmKinematics::Joints> solve(const geometry_msgs::Pose &ik_pose,
+                const std::vector<double> &ik_seed_state,
+                const std::vector<double> &consistency_limits) const;
+    };
+}
+
+#endif // ARM_KINEMATICS_PLUGIN_H
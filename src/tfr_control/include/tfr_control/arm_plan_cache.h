@@ -0,0 +1,91 @@
+/****************************************************************************************
+ * File:            arm_plan_cache.h
+ *
+ * Purpose:         Remembers the MoveIt plans the arm action server made, so a
+ *                  goal it has planned before doesn't have to be planned again.
+ *
+ *                  Plans are keyed by their goal, and by their start state
+ *                  quantized to start_tolerance, a plan is only reused if it
+ *                  starts within start_tolerance (rad) of every joint of the
+ *                  arm now. The digging templates repeat every set and every
+ *                  run, so nearly every digging goal hits.
+ *
+ *                  The returned plan starts exactly where the arm is, so the
+ *                  caller still has to check it's collision free before using
+ *                  it, the cache knows nothing about the planning scene.
+ *
+ *                  Plans can be saved to and loaded from a bag, so a library
+ *                  planned once can be reused across runs.
+ *
+ *                  This class is not threadsafe.
+ ***************************************************************************************/
+#ifndef ARM_PLAN_CACHE_H
+#define ARM_PLAN_CACHE_H
+
+#include <moveit_msgs/RobotTrajectory.h>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace tfr_control
+{
+    class ArmPlanCache
+    {
+    public:
+        struct Settings
+        {
+            //furthest (rad) any joint may be from a plan's start to reuse it
+            double start_tolerance;
+            //most plans to hold, new ones are dropped when it's full
+            size_t capacity;
+        };
+
+        ArmPlanCache(const Settings &settings);
+        ArmPlanCache(const ArmPlanCache&) = delete;
+        ArmPlanCache& operator=(const ArmPlanCache&) = delete;
+        ArmPlanCache(ArmPlanCache&&) = delete;
+        ArmPlanCache& operator=(ArmPlanCache&&) = delete;
+        ~ArmPlanCache() = default;
+
+        /*
+         * Looks for a plan to goal from start, on a hit plan gets it with the
+         * first point moved to start. Returns false on a miss.
+         * */
+        bool find(const std::vector<double> &goal, const std::vector<double> &start,
+                moveit_msgs::RobotTrajectory &plan) const;
+
+        /*
+         * Remembers a plan to goal, replacing any from the same start. Its
+         * last point is snapped to the goal so the key survives a save.
+         * */
+        void insert(const std::vector<double> &goal, moveit_msgs::RobotTrajectory plan);
+
+        /*
+         * Forgets the plan to goal from start, when it turned out to be bad
+         * */
+        void erase(const std::vector<double> &goal, const std::vector<double> &start);
+
+        size_t size() const;
+
+        /*
+         * Adds the plans in a bag written by save, returns false if it
+         * couldn't be read
+         * */
+        bool load(const std::string &file);
+        bool save(const std::string &file) const;
+
+    private:
+        using Key = std::vector<int64_t>;
+
+        //goals are matched exactly, to a tenth of a milliradian
+        static constexpr double GOAL_RESOLUTION = 1e-4;
+
+        const Settings settings;
+        std::map<Key, moveit_msgs::RobotTrajectory> plans;
+
+        Key keyOf(const std::vector<double> &goal, const std::vector<double> &start) const;
+    };
+}
+
+#endif // ARM_PLAN_CACHE_H
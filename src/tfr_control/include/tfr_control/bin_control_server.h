@@ -1,14 +1,17 @@
 /****************************************************************************************
  * File:            bin_control_server.h
- * 
+ *
  * Purpose:         This class implements an action server that provides an interface
  *                  between primary systems and the hardware layer of the robot.
  *                  It allows systems to raise or lower the bin and communicates when
  *                  that task has been completed.
- * 
- *                  This class is not a node, and lives in the controller_launcher node.
- * 
- * Actions Implemented (Server):    Bin.action
+ *
+ *                  This class is not a node, and lives in the control node. The
+ *                  control loop hands it the bin position every cycle, and the
+ *                  goal is woken the cycle the bin gets within tolerance of its
+ *                  target, so there's nothing to poll.
+ *
+ * Actions Implemented (Server):    Bin.action on /bin
  * Publishes To:                    /bin_position_controller/command
  ***************************************************************************************/
 #ifndef BIN_CONTROL_SERVER_H
@@ -17,38 +20,69 @@
 #include <ros/ros.h>
 #include <actionlib/server/simple_action_server.h>
 #include <tfr_msgs/BinAction.h>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 
-using Server = actionlib::SimpleActionServer<tfr_msgs::BinAction>;
-
-class BinControlServer
+namespace tfr_control
 {
-public:
-    BinControlServer() = delete;
-    explicit BinControlServer(ros::NodeHandle& n, float target_bin_angle);
-    BinControlServer(const BinControlServer& other) = delete;
-    BinControlServer(BinControlServer&&) = delete;
-
-    ~BinControlServer() = default;
-
-    BinControlServer& operator=(const BinControlServer&) = delete;
-    BinControlServer& operator=(BinControlServer&&) = delete;
-
-    void ControlBin(const tfr_msgs::BinGoalConstPtr& goal);
-    void SignalBinController();
-
-private:
-    void wait_for_bin();
-    
-    ros::NodeHandle& node;
-    Server server;
-    ros::Publisher bin_command_publisher;
-    const float TARGET_BIN_ANGLE;
-    std::mutex signal_mutex;
-    bool bin_task_completed;
-    std::condition_variable signal;
-
-};
+    class BinControlServer
+    {
+    public:
+        struct Settings
+        {
+            //how close (rad) the bin has to get to its target, unless the
+            //goal says
+            double tolerance;
+            //seconds a goal may take before it's aborted
+            double timeout;
+        };
+
+        BinControlServer() = delete;
+        BinControlServer(ros::NodeHandle& n, const Settings &settings);
+        BinControlServer(const BinControlServer& other) = delete;
+        BinControlServer(BinControlServer&&) = delete;
+
+        ~BinControlServer();
+
+        BinControlServer& operator=(const BinControlServer&) = delete;
+        BinControlServer& operator=(BinControlServer&&) = delete;
+
+        /*
+         * Called by the control loop with the bin position it just read,
+         * completes the goal if the bin is there. Never blocks on the goal.
+         * */
+        void SignalBinController(const double &position);
+
+    private:
+        using Server = actionlib::SimpleActionServer<tfr_msgs::BinAction>;
+
+        void ControlBin(const tfr_msgs::BinGoalConstPtr& goal);
+        void Preempt();
+        /*
+         * Sleeps until the bin is there, we're preempted, or we time out,
+         * returns true only if the bin got there
+         * */
+        bool wait_for_bin();
+
+        ros::NodeHandle& node;
+        const Settings settings;
+        Server server;
+        ros::Publisher bin_command_publisher;
+        //where the current goal wants the bin, nan when there's no goal,
+        //and how close it has to get
+        std::atomic<double> target;
+        std::atomic<double> goal_tolerance;
+        //where the bin was last read, so preemption can hold it there
+        std::atomic<double> last_position;
+
+        //guards the flags below, signal is notified whenever they change
+        std::mutex signal_mutex;
+        bool bin_task_completed;
+        bool preempted;
+        bool shutting_down;
+        std::condition_variable signal;
+    };
+}
 
 #endif // BIN_CONTROL_SERVER_H
@@ -0,0 +1,96 @@
+/****************************************************************************************
+ * File:            current_budget.h
+ *
+ * Purpose:         Keeps the total current the motors draw under what the
+ *                  battery can supply, so the treads, arm and bin can all
+ *                  move at once without browning out.
+ *
+ *                  Every cycle we estimate each motor's draw as its stall
+ *                  current scaled by its pwm, then hand out the budget by
+ *                  priority. Groups are served lowest priority number first,
+ *                  a group that doesn't fit in what's left has all of its
+ *                  motors scaled down by the same factor. Scaling a whole
+ *                  group together keeps the treads on their curve and the bin
+ *                  actuators in sync.
+ *
+ *                  A motor scaled under the pwm that moves it would only
+ *                  stall and burn current, so it's cut to zero instead, and
+ *                  what it would have drawn goes to the rest of its group,
+ *                  then to the groups after it. The treads and the two bin
+ *                  actuators are cut as pairs, one tread alone would spin
+ *                  the robot and one bin actuator alone would rack the bin.
+ *
+ *                  Only the control thread may call limit(), the getters are
+ *                  safe from any thread.
+ ***************************************************************************************/
+#ifndef CURRENT_BUDGET_H
+#define CURRENT_BUDGET_H
+
+#include <atomic>
+#include <cstdint>
+#include <tfr_msgs/PwmCommand.h>
+
+namespace tfr_control
+{
+    class CurrentBudget
+    {
+    public:
+        /*
+         * Every motor we send pwm to
+         * */
+        enum Motor
+        {
+            TREAD_LEFT,
+            TREAD_RIGHT,
+            TURNTABLE,
+            ARM_LOWER,
+            ARM_UPPER,
+            ARM_SCOOP,
+            BIN_LEFT,
+            BIN_RIGHT,
+            MOTOR_COUNT
+        };
+
+        struct Settings
+        {
+            //amps we may draw in total
+            double budget;
+            //amps each motor draws at full pwm
+            double stall_current[MOTOR_COUNT];
+            //lower numbers are served first
+            int priority[MOTOR_COUNT];
+            //slowest pwm that moves each motor
+            double min_pwm[MOTOR_COUNT];
+        };
+
+        explicit CurrentBudget(const Settings &settings);
+        CurrentBudget(const CurrentBudget&) = delete;
+        CurrentBudget& operator=(const CurrentBudget&) = delete;
+        CurrentBudget(CurrentBudget&&) = delete;
+        CurrentBudget& operator=(CurrentBudget&&) = delete;
+
+        /*
+         * Scales down the pwm in command until it fits in the budget
+         * */
+        void limit(tfr_msgs::PwmCommand &command);
+
+        //estimated amps asked for and let through last cycle
+        double getDemand() const;
+        double getAllocated() const;
+        //cycles where something had to be scaled down
+        uint64_t getLimitedCycles() const;
+
+    private:
+        const Settings settings;
+
+        std::atomic<double> demand;
+        std::atomic<double> allocated;
+        std::atomic<uint64_t> limited_cycles;
+
+        static float& channel(tfr_msgs::PwmCommand &command, int motor);
+        //the motor that has to be cut with this one, or -1
+        static int twin(int motor);
+    };
+}
+
+#endif // CURRENT_BUDGET_H
@@ -0,0 +1,61 @@
+/****************************************************************************************
+ * File:            feedforward_table.h
+ *
+ * Purpose:         The measured velocity vs pwm curve of one actuator, used
+ *                  backwards to find the pwm that gives a velocity.
+ *
+ *                  Points come from the calibration mode of the control node,
+ *                  both pwm and velocity are signed so the table also knows
+ *                  which way the actuator is mounted. Asking for any speed
+ *                  slower than the slowest measured point gets that point's
+ *                  pwm, which is the smallest pwm we saw break through the
+ *                  dead band, so small corrections don't stall.
+ ***************************************************************************************/
+#ifndef FEEDFORWARD_TABLE_H
+#define FEEDFORWARD_TABLE_H
+
+#include <vector>
+
+namespace tfr_control
+{
+    class FeedforwardTable
+    {
+    public:
+        //measured speeds below this (rad/s) count as stalled
+        static constexpr double STALL_VELOCITY = 1e-3;
+
+        FeedforwardTable() = default;
+
+        /*
+         * pwm[i] moved the joint at velocity[i], stalled points are dropped
+         * */
+        FeedforwardTable(const std::vector<double> &pwm,
+                const std::vector<double> &velocity);
+
+        /*
+         * Gets the pwm for a signed velocity, 0 if the table has nothing
+         * for that direction
+         * */
+        double pwmFor(const double &velocity) const;
+
+        /*
+         * If there is anything in the table for both directions
+         * */
+        bool isCalibrated() const;
+
+    private:
+        struct Point
+        {
+            double speed;
+            double pwm;
+        };
+        //sorted by speed, one list per direction
+        std::vector<Point> forward;
+        std::vector<Point> reverse;
+
+        static double interpolate(const std::vector<Point> &points,
+                const double &speed);
+    };
+}
+
+#endif // FEEDFORWARD_TABLE_H
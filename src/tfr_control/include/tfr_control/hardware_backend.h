@@ -0,0 +1,71 @@
+/****************************************************************************************
+ * File:            hardware_backend.h
+ *
+ * Purpose:         The boundary between RobotInterface and whatever is on the
+ *                  other side of it, chosen at runtime by the control node.
+ *
+ *                  ArduinoBackend talks to the real robot over the arduino
+ *                  topics, PlantBackend runs a model of the actuators and
+ *                  treads in process, and PlaybackBackend replays recorded
+ *                  readings from a bag.
+ *
+ *                  read and write are only ever called from the control
+ *                  thread.
+ ***************************************************************************************/
+#ifndef HARDWARE_BACKEND_H
+#define HARDWARE_BACKEND_H
+
+#include <cstdint>
+#include <tfr_msgs/PwmCommand.h>
+
+namespace tfr_control
+{
+    /*
+     * Fixed layout copy of the arduino a reading
+     * */
+    struct ArduinoAData
+    {
+        //acquisition time (s) and sequence number
+        double stamp;
+        uint32_t seq;
+        double tread_left_vel;
+        double arm_turntable_pos;
+        double arm_lower_pos;
+        double arm_upper_pos;
+        double arm_scoop_pos;
+        double bin_left_pos;
+        double bin_right_pos;
+    };
+
+    /*
+     * Fixed layout copy of the arduino b reading
+     * */
+    struct ArduinoBData
+    {
+        //acquisition time (s) and sequence number
+        double stamp;
+        uint32_t seq;
+        double tread_right_vel;
+    };
+
+    class HardwareBackend
+    {
+    public:
+        virtual ~HardwareBackend() = default;
+
+        /*
+         * Gets the newest reading from each arduino, returns true if it
+         * arrived since the last call. data is left alone if there has never
+         * been a reading.
+         * */
+        virtual bool readArduinoA(ArduinoAData &data) = 0;
+        virtual bool readArduinoB(ArduinoBData &data) = 0;
+
+        /*
+         * Sends out the pwm for every motor
+         * */
+        virtual void write(const tfr_msgs::PwmCommand &command) = 0;
+    };
+}
+
+#endif // HARDWARE_BACKEND_H
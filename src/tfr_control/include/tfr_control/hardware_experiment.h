@@ -0,0 +1,40 @@
+/****************************************************************************************
+ * File:            hardware_experiment.h
+ *
+ * Purpose:         Something the control node runs on the robot in place of
+ *                  the controllers, like a calibration sweep or autotune,
+ *                  ending in results saved to file.
+ *
+ *                  The control node holds every joint's position each cycle
+ *                  before calling update, so an experiment only drives the
+ *                  joints it is interested in.
+ ***************************************************************************************/
+#ifndef HARDWARE_EXPERIMENT_H
+#define HARDWARE_EXPERIMENT_H
+
+#include <string>
+
+namespace tfr_control
+{
+    class RobotInterface;
+
+    class HardwareExperiment
+    {
+    public:
+        virtual ~HardwareExperiment() = default;
+
+        /*
+         * Runs the next bit of the experiment, now is in seconds. Returns
+         * true once it's finished.
+         * */
+        virtual bool update(RobotInterface &robot, const double &now) = 0;
+
+        /*
+         * Writes the results as yaml, false if there is nothing to write or
+         * the file couldn't be written
+         * */
+        virtual bool save(const std::string &path) const = 0;
+    };
+}
+
+#endif // HARDWARE_EXPERIMENT_H
@@ -0,0 +1,112 @@
+/****************************************************************************************
+ * File:            joint_kalman_filter.h
+ *
+ * Purpose:         Estimates the position and velocity of a potentiometer
+ *                  driven joint from its raw readings and the pwm we drive it
+ *                  with.
+ *
+ *                  The joint is modeled as a motor whose speed lags toward
+ *                  input_gain*pwm with a time constant, with white
+ *                  acceleration noise on top. Knowing what we commanded lets
+ *                  the filter follow a move without the lag of a plain
+ *                  smoothing filter, and trust the potentiometer less.
+ *
+ *                  Innovation statistics are kept so we can tell whether
+ *                  the noise settings match the robot. The normalized
+ *                  innovation squared averages 1 when they do, more means
+ *                  the filter is overconfident, less means it's too timid.
+ *
+ *                  Only the control thread may update, the statistics are
+ *                  safe to read from any thread.
+ ***************************************************************************************/
+#ifndef JOINT_KALMAN_FILTER_H
+#define JOINT_KALMAN_FILTER_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace tfr_control
+{
+    class JointKalmanFilter
+    {
+    public:
+        struct Settings
+        {
+            //speed at full pwm in rad/s, signed by how the motor is mounted
+            double input_gain;
+            //seconds for the joint to get 63% of the way to a new speed
+            double time_constant;
+            //spectral density of the unmodeled acceleration (rad^2/s^3)
+            double process_noise;
+            //variance of a potentiometer reading (rad^2)
+            double measurement_noise;
+        };
+
+        /*
+         * Innovation statistics since the last call to takeInnovations
+         * */
+        struct Innovations
+        {
+            uint64_t count;
+            double mean;
+            double rms;
+            //mean normalized innovation squared
+            double nis;
+        };
+
+        explicit JointKalmanFilter(const Settings &settings);
+        JointKalmanFilter(const JointKalmanFilter&) = delete;
+        JointKalmanFilter& operator=(const JointKalmanFilter&) = delete;
+        JointKalmanFilter(JointKalmanFilter&&) = delete;
+        JointKalmanFilter& operator=(JointKalmanFilter&&) = delete;
+
+        /*
+         * Folds in a reading taken at stamp (s). pwm is what the joint was
+         * driven with since the last reading.
+         * */
+        void update(const double &measured, const double &stamp, const double &pwm);
+
+        /*
+         * Forgets everything, the next reading starts the filter over
+         * */
+        void reset();
+
+        /*
+         * State at the last reading, and extrapolated forward to time (s)
+         * */
+        double getPosition() const;
+        double getVelocity() const;
+        double predictPosition(const double &time) const;
+
+        /*
+         * Gets the innovation statistics since the last call and starts a
+         * new window. Call from one thread only.
+         * */
+        Innovations takeInnovations();
+
+    private:
+        //longer than this between readings and we start over
+        static constexpr double MAX_GAP = 0.5;
+
+        const Settings settings;
+        bool initialized;
+        double last_stamp;
+        //state and its covariance
+        double position;
+        double velocity;
+        double p00, p01, p11;
+
+        //innovation sums for the current window
+        std::atomic<uint64_t> innovation_count;
+        std::atomic<double> innovation_sum;
+        std::atomic<double> innovation_squares;
+        std::atomic<double> nis_sum;
+        //sums at the start of the window
+        uint64_t reported_count;
+        double reported_sum;
+        double reported_squares;
+        double reported_nis;
+    };
+}
+
+#endif // JOINT_KALMAN_FILTER_H
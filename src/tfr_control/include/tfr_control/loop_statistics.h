@@ -0,0 +1,155 @@
+/****************************************************************************************
+ * File:            loop_statistics.h
+ *
+ * Purpose:         Always on timing of the control loop. Every cycle the control
+ *                  thread records how long each phase took, those go into
+ *                  lock free histograms, deadline counters, and a ring of the
+ *                  most recent raw samples.
+ *
+ *                  Recording is a handful of relaxed atomic increments so it
+ *                  can stay on in competition. Summaries and sample dumps are
+ *                  taken from other threads without ever blocking the loop.
+ *
+ *                  Only the control thread may call record(), any thread may
+ *                  read.
+ ***************************************************************************************/
+#ifndef LOOP_STATISTICS_H
+#define LOOP_STATISTICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace tfr_control
+{
+    /*
+     * The timed parts of a control cycle
+     * */
+    enum class LoopPhase
+    {
+        PERIOD,     //time between the start of consecutive cycles
+        READ,       //RobotInterface::read
+        UPDATE,     //ControllerManager::update
+        WRITE,      //RobotInterface::write
+        CYCLE       //read + update + write
+    };
+
+    /*
+     * Log-linear histogram of durations with eight sub buckets per power of
+     * two from 16ns to 4s, so percentiles come out within about 12% of the
+     * true value.
+     * Counts are cumulative, windows are taken by differencing snapshots.
+     * */
+    class LatencyHistogram
+    {
+    public:
+        static const int BUCKETS = 240;
+
+        struct Snapshot
+        {
+            uint64_t counts[BUCKETS];
+        };
+
+        LatencyHistogram();
+        LatencyHistogram(const LatencyHistogram&) = delete;
+        LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+        //control thread only
+        void record(uint64_t ns);
+
+        void snapshot(Snapshot &out) const;
+
+        //largest value since the last call
+        uint64_t takeMax();
+
+        /*
+         * Gets the p-th (0-1) percentile in ns of the samples in the window
+         * between two snapshots, 0 if the window is empty
+         * */
+        static uint64_t percentile(const Snapshot &now, const Snapshot &before,
+                double p);
+
+        static int bucketOf(uint64_t ns);
+        static uint64_t bucketLowerBound(int bucket);
+
+    private:
+        std::atomic<uint64_t> counts[BUCKETS];
+        std::atomic<uint64_t> max;
+    };
+
+    class LoopStatistics
+    {
+    public:
+        static const int PHASE_COUNT = 5;
+        //raw samples held for dumping
+        static const int SAMPLE_COUNT = 2048;
+
+        /*
+         * One cycle worth of raw timings in ns
+         * */
+        struct Sample
+        {
+            uint32_t period;
+            uint32_t read;
+            uint32_t update;
+            uint32_t write;
+        };
+
+        /*
+         * Summary of one phase over a reporting window, in ns
+         * */
+        struct Summary
+        {
+            uint64_t samples;
+            uint64_t p50;
+            uint64_t p99;
+            uint64_t max;
+        };
+
+        /*
+         * nominal_period is the requested cycle time, a cycle overruns if its
+         * work takes longer than that, and misses its deadline if it starts
+         * more than tolerance*nominal_period late.
+         * */
+        LoopStatistics(uint64_t nominal_period, double tolerance);
+        LoopStatistics(const LoopStatistics&) = delete;
+        LoopStatistics& operator=(const LoopStatistics&) = delete;
+
+        //control thread only
+        void record(uint64_t period, uint64_t read, uint64_t update, uint64_t write);
+
+        /*
+         * Summarizes every phase since the last call to summarize. Reporting
+         * should happen from one thread.
+         * */
+        void summarize(Summary (&summaries)[PHASE_COUNT]);
+
+        //totals since startup
+        uint64_t getCycles() const;
+        uint64_t getOverruns() const;
+        uint64_t getDeadlineMisses() const;
+        uint64_t getNominalPeriod() const;
+
+        /*
+         * Copies out the most recent raw samples, oldest first
+         * */
+        void recentSamples(std::vector<Sample> &out) const;
+
+    private:
+        const uint64_t nominal_period;
+        const uint64_t late_threshold;
+
+        LatencyHistogram histograms[PHASE_COUNT];
+        LatencyHistogram::Snapshot last_reported[PHASE_COUNT];
+
+        std::atomic<uint64_t> cycles;
+        std::atomic<uint64_t> overruns;
+        std::atomic<uint64_t> deadline_misses;
+
+        //ring of raw samples, head counts every sample ever written
+        std::atomic<uint32_t> ring[SAMPLE_COUNT][4];
+        std::atomic<uint64_t> head;
+    };
+}
+
+#endif // LOOP_STATISTICS_H
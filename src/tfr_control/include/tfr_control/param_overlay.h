@@ -0,0 +1,28 @@
+/****************************************************************************************
+ * File:            param_overlay.h
+ *
+ * Purpose:         Loads a YAML file over parameters that are already set, like
+ *                  rosparam load, for files the robot writes itself.
+ *
+ *                  Calibration and the autotune save what they measure outside
+ *                  the source tree, under ~/.ros, and the shipped config only
+ *                  holds the defaults. On startup the saved file is loaded on
+ *                  top of them if it's there. Every value in the file replaces
+ *                  the one at the same name, everything else keeps its default,
+ *                  and a file that doesn't exist yet changes nothing.
+ ***************************************************************************************/
+#ifndef PARAM_OVERLAY_H
+#define PARAM_OVERLAY_H
+
+#include <string>
+
+namespace tfr_control
+{
+    /*
+     * Sets every value in file under the parameter namespace ns. Returns
+     * false only if the file exists but can't be read as a YAML map.
+     * */
+    bool loadParamOverlay(const std::string &file, const std::string &ns);
+}
+
+#endif // PARAM_OVERLAY_H
@@ -0,0 +1,109 @@
+/****************************************************************************************
+ * File:            plant_backend.h
+ *
+ * Purpose:         A model of the robot's motors run in process, so the whole
+ *                  control and controller stack can run closed loop without
+ *                  the robot.
+ *
+ *                  Every motor is first order, its speed lags toward
+ *                  speed*pwm with the configured time constant and stalls
+ *                  below a pwm deadband. Positions are integrated and stopped
+ *                  at the joint limits. The signs match the way the motors
+ *                  are mounted, so RobotInterface drives the model exactly
+ *                  as it drives the real robot.
+ *
+ *                  The model steps on ros time, so it also runs faster or
+ *                  slower than real time under a simulated clock.
+ ***************************************************************************************/
+#ifndef PLANT_BACKEND_H
+#define PLANT_BACKEND_H
+
+#include <ros/ros.h>
+#include <tfr_msgs/PwmCommand.h>
+#include "hardware_backend.h"
+
+namespace tfr_control
+{
+    class PlantBackend : public HardwareBackend
+    {
+    public:
+        /*
+         * Travel of a joint, lower == upper means unlimited
+         * */
+        struct Range
+        {
+            double lower;
+            double upper;
+        };
+
+        struct Settings
+        {
+            //seconds for a motor to get 63% of the way to a new speed
+            double time_constant;
+            //speed at full pwm, rad/s for joints m/s for treads
+            double turntable_speed;
+            double arm_speed;
+            double bin_speed;
+            double tread_speed;
+            //fraction slower the right bin actuator runs than the left
+            double bin_skew;
+            //motors stall below this pwm
+            double deadband;
+            //how often (hz) the modeled arduinos report
+            double reading_rate;
+            Range turntable;
+            Range lower_arm;
+            Range upper_arm;
+            Range scoop;
+            Range bin;
+        };
+
+        explicit PlantBackend(const Settings &settings);
+        PlantBackend(const PlantBackend&) = delete;
+        PlantBackend& operator=(const PlantBackend&) = delete;
+        PlantBackend(PlantBackend&&) = delete;
+        PlantBackend& operator=(PlantBackend&&) = delete;
+
+        bool readArduinoA(ArduinoAData &data) override;
+        bool readArduinoB(ArduinoBData &data) override;
+        void write(const tfr_msgs::PwmCommand &command) override;
+
+    private:
+        enum Motor
+        {
+            TREAD_LEFT,
+            TREAD_RIGHT,
+            TURNTABLE,
+            ARM_LOWER,
+            ARM_UPPER,
+            ARM_SCOOP,
+            BIN_LEFT,
+            BIN_RIGHT,
+            MOTOR_COUNT
+        };
+
+        const Settings settings;
+        //signed speed of each motor at full pwm
+        double gains[MOTOR_COUNT];
+        Range ranges[MOTOR_COUNT];
+
+        double pwm[MOTOR_COUNT];
+        double velocity[MOTOR_COUNT];
+        double position[MOTOR_COUNT];
+        bool enabled;
+
+        ros::Time last_step;
+        ros::Time last_reading;
+        uint32_t sequence;
+        //whether each arduino has a reading it hasn't handed out yet
+        bool pending_a;
+        bool pending_b;
+
+        /*
+         * Advances the model to now, and takes a reading if one is due
+         * */
+        void step(const ros::Time &now);
+    };
+}
+
+#endif // PLANT_BACKEND_H
@@ -0,0 +1,71 @@
+/****************************************************************************************
+ * File:            playback_backend.h
+ *
+ * Purpose:         Replays arduino readings recorded in a bag, paced by when
+ *                  they were recorded, so the estimators, diagnostics and
+ *                  controllers can be exercised on real sensor data without
+ *                  the robot.
+ *
+ *                  Stamps are shifted to the time of playback so stale
+ *                  detection behaves as it did on the robot. Pwm commands go
+ *                  nowhere, the readings don't respond to them.
+ ***************************************************************************************/
+#ifndef PLAYBACK_BACKEND_H
+#define PLAYBACK_BACKEND_H
+
+#include <ros/ros.h>
+#include <tfr_msgs/PwmCommand.h>
+#include <string>
+#include <vector>
+#include "hardware_backend.h"
+
+namespace tfr_control
+{
+    class PlaybackBackend : public HardwareBackend
+    {
+    public:
+        /*
+         * Loads every /sensors/arduino_a and /sensors/arduino_b message from
+         * bag, when loop is set playback starts over once it runs out.
+         * Throws rosbag::BagException if the bag can't be read.
+         * */
+        PlaybackBackend(const std::string &bag, bool loop);
+        PlaybackBackend(const PlaybackBackend&) = delete;
+        PlaybackBackend& operator=(const PlaybackBackend&) = delete;
+        PlaybackBackend(PlaybackBackend&&) = delete;
+        PlaybackBackend& operator=(PlaybackBackend&&) = delete;
+
+        bool readArduinoA(ArduinoAData &data) override;
+        bool readArduinoB(ArduinoBData &data) override;
+        void write(const tfr_msgs::PwmCommand &command) override;
+
+    private:
+        /*
+         * A reading and when it was recorded, relative to the start of the bag
+         * */
+        template <typename Data>
+        struct Recorded
+        {
+            double offset;
+            Data data;
+        };
+
+        std::vector<Recorded<ArduinoAData>> readings_a;
+        std::vector<Recorded<ArduinoBData>> readings_b;
+        size_t cursor_a;
+        size_t cursor_b;
+        const bool loop;
+        //playback time is measured from here, moved forward when we loop
+        ros::Time start;
+        //length of the recording in seconds
+        double duration;
+
+        void rewind(const ros::Time &now);
+
+        template <typename Data>
+        bool next(const std::vector<Recorded<Data>> &readings, size_t &cursor,
+                Data &data);
+    };
+}
+
+#endif // PLAYBACK_BACKEND_H
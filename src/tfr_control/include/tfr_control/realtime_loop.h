@@ -0,0 +1,79 @@
+/****************************************************************************************
+ * File:            realtime_loop.h
+ *
+ * Purpose:         Runs a periodic task on its own thread, paced against
+ *                  absolute deadlines on the monotonic clock so sleep error
+ *                  never accumulates into the period.
+ *
+ *                  The thread can optionally be given SCHED_FIFO priority and
+ *                  pinned to a cpu, and the process memory can be locked to
+ *                  avoid page faults mid cycle. Each of these needs elevated
+ *                  privileges, if they are refused we warn and keep running
+ *                  with the normal scheduler.
+ *
+ *                  This class is not a node, and lives in the control node.
+ ***************************************************************************************/
+#ifndef REALTIME_LOOP_H
+#define REALTIME_LOOP_H
+
+#include <ros/ros.h>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+namespace tfr_control
+{
+    class RealtimeLoop
+    {
+    public:
+        /*
+         * Settings for the control thread
+         * */
+        struct Settings
+        {
+            //SCHED_FIFO priority 1-99, 0 leaves the default scheduler
+            int priority;
+            //cpu to pin the thread to, negative leaves it unpinned
+            int cpu;
+            //whether to mlockall the process before starting
+            bool lock_memory;
+        };
+
+        /*
+         * The task is handed the measured time since its last invocation
+         * */
+        using Task = std::function<void(const ros::Duration&)>;
+
+        RealtimeLoop() = delete;
+        RealtimeLoop(double rate, const Settings &settings, Task task);
+        RealtimeLoop(const RealtimeLoop&) = delete;
+        RealtimeLoop(RealtimeLoop&&) = delete;
+
+        ~RealtimeLoop();
+
+        RealtimeLoop& operator=(const RealtimeLoop&) = delete;
+        RealtimeLoop& operator=(RealtimeLoop&&) = delete;
+
+        /*
+         * Spins up the control thread
+         * */
+        void start();
+
+        /*
+         * Signals the control thread to finish its cycle and joins it
+         * */
+        void stop();
+
+    private:
+        void run();
+        void configureThread();
+
+        const long period_ns;
+        const Settings settings;
+        Task task;
+        std::atomic<bool> running;
+        std::thread thread;
+    };
+}
+
+#endif // REALTIME_LOOP_H
@@ -0,0 +1,165 @@
+/****************************************************************************************
+ * File:            relay_autotuner.h
+ *
+ * Purpose:         Suggests PID gains for one joint from a relay feedback
+ *                  experiment, then checks them with a step.
+ *
+ *                  The relay drives the joint bias +/- amplitude depending on
+ *                  which side of the setpoint it is on, and the joint settles
+ *                  into a steady oscillation. The period and amplitude of it
+ *                  give the ultimate gain and period, and from those a plant
+ *                  model and Tyreus-Luyben gains, which trade a little speed
+ *                  for much better damping than Ziegler-Nichols.
+ *
+ *                  Velocity driven joints (the treads) are modeled as first
+ *                  order plus dead time, with the relay on the joint command.
+ *                  Position driven joints are modeled as an integrator plus
+ *                  dead time, with the relay on the pwm, because their
+ *                  position loop lives in RobotInterface.
+ *
+ *                  The gains are used by the loop they were tuned in, see
+ *                  tuned_pid.h: RobotInterface's position loop for an arm
+ *                  joint, the SkidSteerController's velocity loop for a
+ *                  tread. Both load them from the autotune file, which save()
+ *                  writes with yaml-cpp.
+ *
+ *                  Driven by the control loop, only call it from there.
+ ***************************************************************************************/
+#ifndef RELAY_AUTOTUNER_H
+#define RELAY_AUTOTUNER_H
+
+#include <string>
+#include <vector>
+#include "robot_interface.h"
+#include "hardware_experiment.h"
+
+namespace tfr_control
+{
+    class RelayAutotuner : public HardwareExperiment
+    {
+    public:
+        struct Settings
+        {
+            //relay output is bias +/- amplitude
+            double amplitude;
+            double bias;
+            //error the relay ignores, keeps noise from chattering it
+            double hysteresis;
+            //setpoint of the relay, a velocity for velocity driven joints,
+            //an offset from the starting position for position driven ones
+            double setpoint;
+            //oscillations to measure, after two more to settle
+            int cycles;
+            //size and length (s) of the step used to check the gains
+            double step_size;
+            double step_time;
+            //furthest the joint may stray from the setpoint before we give up
+            double max_excursion;
+        };
+
+        /*
+         * Results of a finished experiment
+         * */
+        struct Result
+        {
+            //ultimate gain and period
+            double ultimate_gain;
+            double ultimate_period;
+            //plant model, time_constant is 0 for integrating joints
+            double plant_gain;
+            double time_constant;
+            double dead_time;
+            //suggested gains
+            double p;
+            double i;
+            double d;
+            //step response with the suggested gains
+            double rise_time;
+            double overshoot;
+        };
+
+        /*
+         * integrating is true for position driven joints
+         * */
+        RelayAutotuner(const Settings &settings, const Joint &joint,
+                const std::string &name, bool integrating);
+        RelayAutotuner(const RelayAutotuner&) = delete;
+        RelayAutotuner& operator=(const RelayAutotuner&) = delete;
+        RelayAutotuner(RelayAutotuner&&) = delete;
+        RelayAutotuner& operator=(RelayAutotuner&&) = delete;
+
+        /*
+         * Runs the next bit of the experiment, now is in seconds. Returns
+         * true once it is finished or has given up.
+         * */
+        bool update(RobotInterface &robot, const double &now) override;
+
+        /*
+         * If the experiment finished with something to report
+         * */
+        bool succeeded() const;
+        const Result& getResult() const;
+
+        /*
+         * Writes the result as yaml under the joint's name, replacing the
+         * joint's last result and keeping the other joints'
+         * */
+        bool save(const std::string &path) const override;
+
+    private:
+        enum class Phase
+        {
+            START,
+            PROBE,
+            RELAY,
+            STEP,
+            DONE
+        };
+
+        const Settings settings;
+        const Joint joint;
+        const std::string name;
+        const bool integrating;
+
+        Phase phase;
+        bool success;
+        Result result;
+
+        //which way the joint moves for a positive output
+        double direction;
+        double probe_start;
+        double probe_from;
+
+        //relay state
+        double setpoint;
+        bool high;
+        double highest;
+        double lowest;
+        double output_sum;
+        double measured_sum;
+        int samples;
+        std::vector<double> switch_times;
+        std::vector<double> amplitudes;
+
+        //step state
+        double step_start;
+        double step_from;
+        double last_time;
+        double last_error;
+        double integral;
+        double peak;
+        double rise_low;
+        double rise_high;
+
+        double measure(RobotInterface &robot) const;
+        void actuate(RobotInterface &robot, const double &value) const;
+
+        void probe(RobotInterface &robot, const double &now, const double &measured);
+        void relay(RobotInterface &robot, const double &now, const double &measured);
+        void identify();
+        void step(RobotInterface &robot, const double &now, const double &measured);
+        void finish(RobotInterface &robot, bool succeeded);
+    };
+}
+
+#endif // RELAY_AUTOTUNER_H
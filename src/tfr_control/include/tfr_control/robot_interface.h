@@ -21,11 +21,21 @@
 #include <hardware_interface/robot_hw.h>
 #include <utility>
 #include <algorithm>
-#include <tfr_msgs/ArduinoAReading.h>
-#include <tfr_msgs/ArduinoBReading.h>
+#include <memory>
 #include <tfr_msgs/PwmCommand.h>
 #include <tfr_utilities/control_code.h>
+#include <tfr_utilities/stream_monitor.h>
 #include <vector>
+#include <atomic>
+#include "hardware_backend.h"
+#include "velocity_estimator.h"
+#include "slew_limiter.h"
+#include "twin_actuator_controller.h"
+#include "current_budget.h"
+#include "feedforward_table.h"
+#include "joint_kalman_filter.h"
+#include "tuned_pid.h"
+#include "stream_health_interface.h"
 
 namespace tfr_control {
 
@@ -43,6 +53,18 @@ namespace tfr_control {
         SCOOP 
     };
 
+    /*
+     * The potentiometers, the bin has one on each actuator
+     * */
+    enum class Potentiometer
+    {
+        LOWER_ARM,
+        UPPER_ARM,
+        SCOOP,
+        BIN_LEFT,
+        BIN_RIGHT
+    };
+
     /**
      * Contains the lower level interface inbetween user commands coming
      * in from the controller layer, and manages the state of all joints,
@@ -54,15 +76,65 @@ namespace tfr_control {
         
         //Number of joints we need to control in our layer
         static const int JOINT_COUNT = 7;
+        static const int POTENTIOMETER_COUNT = 5;
 
+        /*
+         * Tuning for the hardware layer, loaded by the control node
+         * */
+        struct Settings
+        {
+            //seconds without a reading before a sensor stream is stale
+            double stale_timeout;
+            //bandwidth (hz) of the arm and bin velocity estimators
+            double velocity_bandwidth;
+            //tread speed (m/s) reached at full pwm
+            double drivebase_max_vel;
+            //pwm needed to just get the treads moving
+            double drivebase_min_pwm;
+            //commands slower than this (m/s) are treated as stop
+            double drivebase_deadband;
+            //limits on the commanded tread speed (m/s^2, m/s^3)
+            double drivebase_max_accel;
+            double drivebase_max_jerk;
+            //synchronization of the twin bin actuators
+            TwinActuatorController::Settings bin;
+            //how much current the motors may draw, and who gets it first
+            CurrentBudget::Settings power;
+            //measured pwm curves of the arm joints, uncalibrated joints use
+            //the fixed proportional mapping
+            FeedforwardTable feedforward[JOINT_COUNT];
+            //velocity (rad/s) asked of a calibrated joint per rad of error
+            double feedforward_gain;
+            //error (rad) a calibrated joint settles within
+            double feedforward_tolerance;
+            //autotuned gains (pwm per rad) of the arm joints' position loops,
+            //all zero for joints that haven't been tuned, tuned joints use
+            //them in place of their feedforward table or the fixed mapping
+            TunedPid::Gains position_gains[JOINT_COUNT];
+            //run the potentiometers through kalman filters, otherwise they
+            //are exponentially smoothed, as the firmware used to, and used
+            //with the velocity estimators
+            bool filter_potentiometers;
+            //input_gain is the magnitude, it's signed by how each actuator
+            //is mounted
+            JointKalmanFilter::Settings arm_filter;
+            JointKalmanFilter::Settings bin_filter;
+        };
 
-        RobotInterface(ros::NodeHandle &n, bool fakes, const double lower_lim[JOINT_COUNT],
-                const double upper_lim[JOINT_COUNT]);
+        /*
+         * backend is what we read from and write to, real or simulated
+         * */
+        RobotInterface(std::unique_ptr<HardwareBackend> backend,
+                const Settings &settings);
 
         
         /*
          * Reads state from hardware (encoders/potentiometers) and writes it to
          * shared memory 
+         *
+         * If a sensor stream goes stale we hold its last positions, report
+         * zero velocity for its treads, and write() stops driving the joints
+         * that depend on it until it recovers.
          * */
         void read();
 
@@ -83,16 +155,61 @@ namespace tfr_control {
          * */
         void getArmState(std::vector<double>&);
 
+        /*
+         * retrieves the position and velocity of any joint
+         * */
+        double getJointPosition(const Joint &joint);
+        double getJointVelocity(const Joint &joint);
+
+        /*
+         * Commands a joint directly, in place of its controller. For
+         * experiments run by the control node, control thread only.
+         * */
+        void setCommand(const Joint &joint, const double &value);
+
+        /*
+         * Drives an arm joint with a fixed pwm regardless of its command,
+         * until the overrides are cleared. For calibration, control thread
+         * only.
+         * */
+        void overridePWM(const Joint &joint, const double &pwm);
+        void clearOverrides();
+
         /*
          * Clears all command values being sent and sets them to safe values
          * stops the treads and commands the arm to hold position.
          * */
         void clearCommands();
 
+        /*
+         * Turns the motor output on and off, safe to call from any thread
+         * */
         void setEnabled(bool val);
 
+        /*
+         * Requests the turntable be zeroed at its current position, the
+         * request is applied on the next call to read(). Safe to call from
+         * any thread.
+         * */
         void zeroTurntable();
 
+        /*
+         * Health of each sensor stream, safe to call from any thread
+         * */
+        const tfr_utilities::StreamMonitor& getArduinoAMonitor() const;
+        const tfr_utilities::StreamMonitor& getArduinoBMonitor() const;
+
+        /*
+         * Estimated current draw, safe to call from any thread
+         * */
+        const CurrentBudget& getCurrentBudget() const;
+
+        /*
+         * Innovation statistics of a potentiometer filter since the last
+         * call, safe to call from one thread besides the control thread
+         * */
+        JointKalmanFilter::Innovations takeInnovations(const Potentiometer &pot);
+
     private:
         //joint states for Joint state publisher package
         hardware_interface::JointStateInterface joint_state_interface;
@@ -100,14 +217,34 @@ namespace tfr_control {
         hardware_interface::PositionJointInterface joint_position_interface;
         //cmd states for velocity driven joints
         hardware_interface::EffortJointInterface joint_effort_interface;
-
-        //reads from arduino encoder publisher
-        ros::Subscriber arduino_a;
-        ros::Subscriber arduino_b;
-        ros::Publisher pwm_publisher;
-        bool enabled;
-        tfr_msgs::ArduinoAReadingConstPtr latest_arduino_a;
-        tfr_msgs::ArduinoBReadingConstPtr latest_arduino_b;
+        //whether the velocity driven joints' feedback is current
+        StreamHealthInterface stream_health_interface;
+
+        //set by service callbacks, consumed by the control loop
+        std::atomic<bool> enabled;
+        std::atomic<bool> zero_turntable_requested;
+        //the robot, or a stand in for it
+        std::unique_ptr<HardwareBackend> backend;
+        //the snapshot taken in read() and reused by write()
+        ArduinoAData reading_a{};
+        ArduinoBData reading_b{};
+        //age and drops of each stream, updated in read()
+        tfr_utilities::StreamMonitor arduino_a_monitor;
+        tfr_utilities::StreamMonitor arduino_b_monitor;
+        //velocity of the potentiometer and encoder driven joints
+        VelocityEstimator velocity_estimators[JOINT_COUNT];
+        //position and velocity of the potentiometer driven joints, from the
+        //readings and what we last drove them with
+        const bool filter_potentiometers;
+        std::unique_ptr<JointKalmanFilter> potentiometer_filters[POTENTIOMETER_COUNT];
+        //smoothed potentiometers without the filters, nan until the first
+        //reading
+        double smoothed_potentiometers[POTENTIOMETER_COUNT];
+        //pwm sent by the last write(), what the joints ran on since
+        tfr_msgs::PwmCommand last_command{};
+        //bin actuator positions for write()
+        double bin_left_position;
+        double bin_right_position;
 
         double turntable_offset;
 
@@ -121,20 +258,60 @@ namespace tfr_control {
         double velocity_values[JOINT_COUNT]{};
         // Populated by us for controller layer to use
         double effort_values[JOINT_COUNT]{};
-        //used to limit acceleration pull on the drivebase
-        std::pair<double, double> drivebase_v0;
+        // Populated by us for controller layer to use
+        bool stale_values[JOINT_COUNT]{};
+        //shape the tread commands to limit acceleration pull on the drivebase
+        SlewLimiter left_tread_limiter;
+        SlewLimiter right_tread_limiter;
         ros::Time last_update;
+        //drivebase velocity to pwm calibration
+        const double drivebase_max_vel;
+        const double drivebase_min_pwm;
+        const double drivebase_deadband;
+        //keeps the bin actuators together
+        TwinActuatorController bin_controller;
+        //keeps everything running at once from browning us out
+        CurrentBudget current_budget;
+        //pwm curves of the arm joints
+        FeedforwardTable feedforward[JOINT_COUNT];
+        const double feedforward_gain;
+        const double feedforward_tolerance;
+        //position loops of the autotuned arm joints
+        TunedPid position_loops[JOINT_COUNT];
+        //fixed pwm for calibration, nan when not overridden
+        double pwm_overrides[JOINT_COUNT];
 
         
         void registerJoint(std::string name, Joint joint);
         void registerArmJoint(std::string name, Joint joint);
         void registerBinJoint(std::string name, Joint joint);
 
+        /*
+         * Runs the velocity estimator for a joint on the newest reading
+         * */
+        double estimateVelocity(const Joint &joint, const double &position,
+                const double &stamp);
 
-        //callback for publisher
-        void readArduinoA(const tfr_msgs::ArduinoAReadingConstPtr &msg);
-        //callback for publisher
-        void readArduinoB(const tfr_msgs::ArduinoBReadingConstPtr &msg);
+        /*
+         * Smooths the potentiometers in the newest reading in place, for
+         * when they aren't filtered
+         * */
+        void smoothPotentiometers();
+
+        /*
+         * Steps a potentiometer filter on the newest reading, and gets the
+         * position extrapolated to now
+         * */
+        double filterPotentiometer(const Potentiometer &pot, const double &measured,
+                const double &pwm, bool fresh, const double &now);
+
+        /**
+         * Gets the PWM for an arm joint, from its position loop if it has
+         * been autotuned, or its feedforward table if it has been
+         * calibrated, dt is the time since the last write
+         * */
+        double jointToPWM(const Joint &joint, const double &desired,
+                const double &measured, const double &dt);
 
         /**
          * Gets the PWM appropriate output for an angle joint at the current time
@@ -147,28 +324,17 @@ namespace tfr_control {
         double turntableAngleToPWM(const double &desired, const double &measured);
 
         /**
-         * Gets the PWM appropriate output for turntable at the current time
+         * Gets the PWM appropriate output for both bin actuators at the
+         * current time, dt is the time since the last write
          * */
         std::pair<double, double> twinAngleToPWM(const double &desired, 
-                const double &measured_left, const double &measured_right);
+                const double &measured_left, const double &measured_right,
+                const double &dt);
 
         /**
-         * Gets the PWM appropriate output for a joint at the current time
+         * Gets the PWM appropriate output for a tread moving at a velocity
          * */
-        double drivebaseVelocityToPWM(const double &v_1, const double &v_0);
-
-        /*
-         * Scale the PWM outputs to avoid browning out 
-         * */
-        double scalePWM(const double &pwm_1, const double &pwm_0);
-
-        void adjustFakeJoint(const Joint &joint);
-
-        // THESE DATA MEMBERS ARE FOR SIMULATION ONLY
-        // Holds the lower and upper limits of the URDF model joint
-        bool use_fake_values = false;
-        const double *lower_limits, *upper_limits;
-
+        double drivebaseVelocityToPWM(const double &velocity);
     };
 }
 
@@ -0,0 +1,181 @@
+/****************************************************************************************
+ * File:            skid_steer_controller.h
+ *
+ * Purpose:         A ros_control controller that drives the treads from the
+ *                  velocity commands and publishes odometry from their measured
+ *                  velocity, all inside the control loop.
+ *
+ *                  Twists are turned into tread velocities with differential
+ *                  steering kinematics and written as the tread commands,
+ *                  RobotInterface shapes and maps them to pwm. Each update the
+ *                  measured tread velocities from the same read() are
+ *                  integrated into a pose and published at publish_rate.
+ *
+ *                  Several nodes drive the robot, each on its own topic. Every
+ *                  source only keeps its latest twist, and each update the
+ *                  highest priority source with a live command owns the treads.
+ *                  A moving command is live until the source's timeout runs out,
+ *                  so sources have to keep sending it. A stop is live for
+ *                  stop_hold, so a source that stops hands over the treads
+ *                  shortly after instead of blocking everyone below it. With no
+ *                  live command the treads stop. Commands lower priority sources
+ *                  sent before the owner took over are dropped, so they can't
+ *                  come back when it hands over.
+ *
+ *                  A tread that has been autotuned, with gains at
+ *                  autotune/<joint>/pid, runs the velocity loop it was tuned
+ *                  with on its measured velocity, and writes the loop's
+ *                  output as its command instead. The file the autotune saved
+ *                  to, autotune_file, is loaded over autotune on init.
+ *
+ *                  A tread whose sensor stream has gone stale reads as still,
+ *                  so that's what goes into the odometry, with the twist
+ *                  covariance inflated until it recovers so fusion leans on
+ *                  the other sources. A tuned tread drives open loop while
+ *                  it's stale.
+ *
+ *                  Skid steering slips when it turns, so the span used for
+ *                  odometry is tuned separately from the one for commands.
+ *
+ *                  Loaded by the control node's controller manager, see
+ *                  config/controllers.yaml for its parameters.
+ *
+ * Subscribed To:   the topic of each source in the sources parameter
+ * Publishes To:    /drivebase_odom
+ *                  /cmd_vel_owner - latched, the source that owns the treads,
+ *                  "none" if none does
+ * Services:        /set_drivebase_odometry - moves the odometry toward a pose,
+ *                  at most a little at a time
+ *                  /reset_drivebase_odometry - jumps the odometry to a pose
+ ***************************************************************************************/
+#ifndef SKID_STEER_CONTROLLER_H
+#define SKID_STEER_CONTROLLER_H
+
+#include <ros/ros.h>
+#include <controller_interface/controller.h>
+#include <controller_interface/multi_interface_controller.h>
+#include <hardware_interface/joint_command_interface.h>
+#include <realtime_tools/realtime_buffer.h>
+#include <realtime_tools/realtime_publisher.h>
+#include <geometry_msgs/Twist.h>
+#include <nav_msgs/Odometry.h>
+#include <std_msgs/String.h>
+#include <tfr_msgs/SetOdometry.h>
+#include <memory>
+#include <vector>
+#include "tuned_pid.h"
+#include "stream_health_interface.h"
+
+namespace tfr_control
+{
+    class SkidSteerController :
+        public controller_interface::MultiInterfaceController<
+            hardware_interface::EffortJointInterface, StreamHealthInterface>
+    {
+    public:
+        SkidSteerController();
+        SkidSteerController(const SkidSteerController&) = delete;
+        SkidSteerController& operator=(const SkidSteerController&) = delete;
+        SkidSteerController(SkidSteerController&&) = delete;
+        SkidSteerController& operator=(SkidSteerController&&) = delete;
+
+        bool init(hardware_interface::RobotHW *hw,
+                ros::NodeHandle &root, ros::NodeHandle &n) override;
+        void starting(const ros::Time &time) override;
+        void update(const ros::Time &time, const ros::Duration &period) override;
+        void stopping(const ros::Time &time) override;
+
+    private:
+        //latest twist from a source, a zero stamp if it hasn't sent one
+        struct Command
+        {
+            double linear;
+            double angular;
+            ros::Time stamp;
+        };
+
+        //somewhere twists come from
+        struct Source
+        {
+            std::string name;
+            int priority;
+            //seconds a moving command stays live
+            double timeout;
+            realtime_tools::RealtimeBuffer<Command> command;
+            ros::Subscriber subscriber;
+        };
+
+        //pose asked for by a service, applied by the control thread
+        struct PoseRequest
+        {
+            double x;
+            double y;
+            double yaw;
+            bool smooth;
+            bool pending;
+        };
+
+        //furthest a smoothed set moves the odometry at once (m, rad)
+        static constexpr double MAX_XY_DELTA = 0.25;
+        static constexpr double MAX_YAW_DELTA = 0.13;
+
+        hardware_interface::JointHandle left_tread;
+        hardware_interface::JointHandle right_tread;
+        StreamHealthHandle left_health;
+        StreamHealthHandle right_health;
+        //tread separation (m) used for commands, and for odometry
+        double wheel_span;
+        double odometry_wheel_span;
+        //seconds a stop keeps the treads from lower priority sources
+        double stop_hold;
+        //velocity loops of autotuned treads, and the most (m/s) they may
+        //command
+        TunedPid left_loop;
+        TunedPid right_loop;
+        double max_tuned_velocity;
+        std::string parent_frame;
+        std::string child_frame;
+        ros::Duration publish_period;
+
+        //highest priority first
+        std::vector<std::unique_ptr<Source>> sources;
+        realtime_tools::RealtimeBuffer<PoseRequest> pose_request;
+        std::unique_ptr<realtime_tools::RealtimePublisher<nav_msgs::Odometry>> odometry_publisher;
+        std::unique_ptr<realtime_tools::RealtimePublisher<std_msgs::String>> owner_publisher;
+        ros::ServiceServer set_odometry;
+        ros::ServiceServer reset_odometry;
+
+        //odometry, owned by the control thread
+        double x;
+        double y;
+        double yaw;
+        ros::Time last_publish;
+        //index of the source that owns the treads, -1 for none, and the
+        //one we last told everyone about
+        int owner;
+        int published_owner;
+        //when the owner took over the treads
+        ros::Time owned_since;
+
+        bool loadSources(ros::NodeHandle &root, ros::NodeHandle &n);
+        void cmdVelCallback(const geometry_msgs::Twist::ConstPtr &msg, Source *source);
+        bool isLive(const Source &source, const Command &twist,
+                const ros::Time &time) const;
+        void dropMasked();
+        void publishOwner();
+        bool setOdometry(tfr_msgs::SetOdometry::Request &request,
+                tfr_msgs::SetOdometry::Response &response);
+        bool resetOdometry(tfr_msgs::SetOdometry::Request &request,
+                tfr_msgs::SetOdometry::Response &response);
+
+        void driveTread(hardware_interface::JointHandle &tread, TunedPid &loop,
+                const double &velocity, bool stopped, bool stale, const double &dt);
+
+        static double yawOf(const geometry_msgs::Quaternion &q);
+        void applyPoseRequest();
+        void publishOdometry(const ros::Time &time, const double &linear,
+                const double &angular, bool stale);
+    };
+}
+
+#endif // SKID_STEER_CONTROLLER_H
@@ -0,0 +1,82 @@
+/****************************************************************************************
+ * File:            slew_limiter.h
+ *
+ * Purpose:         Shapes a velocity setpoint so it never changes faster than
+ *                  an acceleration limit, and the acceleration never changes
+ *                  faster than a jerk limit.
+ *
+ *                  Near the target the acceleration is tapered so the output
+ *                  lands on the setpoint without overshooting it, that is
+ *                  what lets the drivebase stop where navigation asked.
+ ***************************************************************************************/
+#ifndef SLEW_LIMITER_H
+#define SLEW_LIMITER_H
+
+#include <cmath>
+#include <algorithm>
+
+namespace tfr_control
+{
+    class SlewLimiter
+    {
+    public:
+        /*
+         * max_accel in units/s^2, max_jerk in units/s^3
+         * */
+        SlewLimiter(double max_accel, double max_jerk) :
+            accel_limit{max_accel}, jerk_limit{max_jerk}, value{0}, rate{0}
+        {}
+
+        /*
+         * Steps toward target over dt seconds, returns the limited value
+         * */
+        double update(double target, double dt)
+        {
+            if (dt <= 0)
+                return value;
+
+            double error = target - value;
+            double direction = (error < 0) ? -1 : 1;
+            //fastest we may still be changing and stop in time with this jerk
+            double taper = std::sqrt(2 * jerk_limit * std::abs(error));
+            double desired = direction *
+                std::min({accel_limit, taper, std::abs(error) / dt});
+
+            double max_change = jerk_limit * dt;
+            rate += std::max(-max_change, std::min(desired - rate, max_change));
+            double next = value + rate * dt;
+
+            //never step past the target, we'd just have to come back, the
+            //taper has already brought the rate close to zero by now
+            if ((target - next) * error <= 0)
+            {
+                rate = 0;
+                next = target;
+            }
+            value = next;
+            return value;
+        }
+
+        /*
+         * Jumps to a value at rest, e.g. when the output is disabled
+         * */
+        void reset(double start = 0)
+        {
+            value = start;
+            rate = 0;
+        }
+
+        double getValue() const
+        {
+            return value;
+        }
+
+    private:
+        double accel_limit;
+        double jerk_limit;
+        double value;
+        double rate;
+    };
+}
+
+#endif // SLEW_LIMITER_H
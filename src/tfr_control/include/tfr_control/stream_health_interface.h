@@ -0,0 +1,53 @@
+/****************************************************************************************
+ * File:            stream_health_interface.h
+ *
+ * Purpose:         A hardware interface that tells controllers whether the
+ *                  feedback of a joint is current. RobotInterface reports a
+ *                  joint whose sensor stream has gone stale as holding still,
+ *                  which a controller can't tell apart from a joint that
+ *                  really stopped, so it asks here.
+ *
+ *                  Handles are named after their joints, and aren't claimed,
+ *                  any number of controllers may read them.
+ ***************************************************************************************/
+#ifndef STREAM_HEALTH_INTERFACE_H
+#define STREAM_HEALTH_INTERFACE_H
+
+#include <hardware_interface/internal/hardware_resource_manager.h>
+#include <string>
+
+namespace tfr_control
+{
+    class StreamHealthHandle
+    {
+    public:
+        StreamHealthHandle() : name{}, stale{nullptr} {}
+
+        /*
+         * stale is owned by the hardware layer and updated in its read()
+         * */
+        StreamHealthHandle(const std::string &joint, const bool *stale_flag) :
+            name{joint}, stale{stale_flag}
+        {}
+
+        std::string getName() const
+        {
+            return name;
+        }
+
+        bool isStale() const
+        {
+            return stale == nullptr || *stale;
+        }
+
+    private:
+        std::string name;
+        const bool *stale;
+    };
+
+    class StreamHealthInterface :
+        public hardware_interface::HardwareResourceManager<StreamHealthHandle>
+    {};
+}
+
+#endif // STREAM_HEALTH_INTERFACE_H
@@ -0,0 +1,76 @@
+/****************************************************************************************
+ * File:            triple_buffer.h
+ *
+ * Purpose:         A single producer, single consumer mailbox for passing the
+ *                  latest value of a fixed layout struct between threads.
+ *
+ *                  The producer (a ros callback) always writes into a private
+ *                  back buffer and then swaps it with the shared middle buffer.
+ *                  The consumer (the control loop) swaps the middle buffer into
+ *                  its private front buffer only if something new was written.
+ *                  Both sides are wait free, never allocate, and the consumer
+ *                  always sees a complete value, never a half written one.
+ *
+ *                  Only one thread may call write() and only one thread may
+ *                  call read(), these may be different threads.
+ ***************************************************************************************/
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+namespace tfr_control
+{
+    template <typename T>
+    class TripleBuffer
+    {
+    public:
+        static_assert(std::is_trivially_copyable<T>::value,
+                "TripleBuffer only holds trivially copyable types");
+
+        TripleBuffer() : buffers{}, middle{1}, front{0}, back{2} {}
+        ~TripleBuffer() = default;
+        TripleBuffer(const TripleBuffer&) = delete;
+        TripleBuffer& operator=(const TripleBuffer&) = delete;
+        TripleBuffer(TripleBuffer&&) = delete;
+        TripleBuffer& operator=(TripleBuffer&&) = delete;
+
+        /*
+         * Publishes a new value, called by the producer only
+         * */
+        void write(const T& value)
+        {
+            buffers[back] = value;
+            back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+        }
+
+        /*
+         * Copies out the most recent value, called by the consumer only.
+         * Returns true if the value was written since the last read.
+         * */
+        bool read(T& value)
+        {
+            bool fresh = (middle.load(std::memory_order_relaxed) & FRESH) != 0;
+            if (fresh)
+                front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+            value = buffers[front];
+            return fresh;
+        }
+
+    private:
+        //low bits index a buffer, the high bit marks an unread middle buffer
+        static const uint8_t INDEX = 0x03;
+        static const uint8_t FRESH = 0x04;
+
+        T buffers[3];
+        std::atomic<uint8_t> middle;
+        //owned by the consumer
+        uint8_t front;
+        //owned by the producer
+        uint8_t back;
+    };
+}
+
+#endif // TRIPLE_BUFFER_H
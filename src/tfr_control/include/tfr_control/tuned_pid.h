@@ -0,0 +1,108 @@
+/****************************************************************************************
+ * File:            tuned_pid.h
+ *
+ * Purpose:         The PID loop the relay autotuner checks its gains with, run
+ *                  on those gains by the loops that were tuned: the arm
+ *                  joints' position loops in RobotInterface, on pwm, and the
+ *                  treads' velocity loops in the SkidSteerController, on the
+ *                  tread command.
+ *
+ *                  The autotune file maps each joint to its results, so it's
+ *                  loaded as autotune/<joint>/pid wherever those loops look
+ *                  for their gains. A joint without gains isn't tuned, and
+ *                  keeps driving the way it did before.
+ ***************************************************************************************/
+#ifndef TUNED_PID_H
+#define TUNED_PID_H
+
+#include <ros/ros.h>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <string>
+
+namespace tfr_control
+{
+    class TunedPid
+    {
+    public:
+        struct Gains
+        {
+            double p;
+            double i;
+            double d;
+        };
+
+        TunedPid() :
+            gains{0, 0, 0}, limit{std::numeric_limits<double>::infinity()},
+            integral{0}, last_error{std::nan("")}
+        {}
+
+        /*
+         * Reads autotune/<joint>/pid from n, returns false and leaves gains
+         * alone if the joint hasn't been tuned
+         * */
+        static bool load(const ros::NodeHandle &n, const std::string &joint, Gains &gains)
+        {
+            std::string ns = "autotune/" + joint + "/pid/";
+            Gains loaded{0, 0, 0};
+            if (!n.getParam(ns + "p", loaded.p) || !n.getParam(ns + "i", loaded.i) ||
+                    !n.getParam(ns + "d", loaded.d))
+                return false;
+            gains = loaded;
+            return true;
+        }
+
+        /*
+         * Output is clamped to +/- output_limit
+         * */
+        void setGains(const Gains &tuned, double output_limit)
+        {
+            gains = tuned;
+            limit = output_limit;
+            reset();
+        }
+
+        bool isTuned() const
+        {
+            return gains.p != 0 || gains.i != 0 || gains.d != 0;
+        }
+
+        /*
+         * Steps the loop dt seconds on error (setpoint - measured)
+         * */
+        double update(double error, double dt)
+        {
+            if (dt <= 0)
+                dt = 0;
+            double derivative = (dt > 0 && !std::isnan(last_error)) ?
+                (error - last_error) / dt : 0;
+            last_error = error;
+
+            double proportional = gains.p * error + gains.d * derivative;
+            //only integrate while the output can still act on it, otherwise
+            //the integrator winds up against a stalled joint
+            if (std::abs(proportional + gains.i * (integral + error * dt)) < limit)
+                integral += error * dt;
+            return std::max(-limit, std::min(proportional + gains.i * integral, limit));
+        }
+
+        /*
+         * Forgets the integral and last error, e.g. when the output is
+         * disabled or something else drove the joint
+         * */
+        void reset()
+        {
+            integral = 0;
+            last_error = std::nan("");
+        }
+
+    private:
+        Gains gains;
+        double limit;
+        double integral;
+        double last_error;
+    };
+}
+
+#endif // TUNED_PID_H
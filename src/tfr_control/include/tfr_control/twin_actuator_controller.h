@@ -0,0 +1,72 @@
+/****************************************************************************************
+ * File:            twin_actuator_controller.h
+ *
+ * Purpose:         Position control for a joint moved by two linear actuators
+ *                  side by side, like the bin.
+ *
+ *                  Two PI loops run together. The average loop moves the pair
+ *                  toward the target, the differential loop slows whichever
+ *                  actuator is ahead so the frame doesn't rack. The
+ *                  differential loop always gets the pwm it needs first, the
+ *                  average loop gets what's left.
+ *
+ *                  Far from the target the pair runs at full speed, inside
+ *                  ramp_distance the speed limit falls off linearly so we
+ *                  settle without hunting around the target.
+ ***************************************************************************************/
+#ifndef TWIN_ACTUATOR_CONTROLLER_H
+#define TWIN_ACTUATOR_CONTROLLER_H
+
+#include <utility>
+
+namespace tfr_control
+{
+    class TwinActuatorController
+    {
+    public:
+        struct Settings
+        {
+            //average position loop, pwm per rad and pwm per rad*s
+            double average_kp;
+            double average_ki;
+            //differential loop on left - right
+            double differential_kp;
+            double differential_ki;
+            //distance from the target (rad) where we start slowing down
+            double ramp_distance;
+            //slowest pwm that still moves the actuators
+            double min_pwm;
+            //close enough (rad) to the target, and to each other
+            double tolerance;
+        };
+
+        explicit TwinActuatorController(const Settings &settings);
+        TwinActuatorController(const TwinActuatorController&) = delete;
+        TwinActuatorController& operator=(const TwinActuatorController&) = delete;
+        TwinActuatorController(TwinActuatorController&&) = delete;
+        TwinActuatorController& operator=(TwinActuatorController&&) = delete;
+
+        /*
+         * Gets the effort (-1 to 1, positive extends) for the left and right
+         * actuator to move their average to desired. dt is the time in
+         * seconds since the last update.
+         * */
+        std::pair<double, double> update(const double &desired,
+                const double &left, const double &right, const double &dt);
+
+        /*
+         * Drops the integrators, for when the output isn't reaching the
+         * actuators
+         * */
+        void reset();
+
+    private:
+        const Settings settings;
+        double average_integral;
+        double differential_integral;
+
+        static double clamp(const double &value, const double &limit);
+    };
+}
+
+#endif // TWIN_ACTUATOR_CONTROLLER_H
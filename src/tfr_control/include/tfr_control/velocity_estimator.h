@@ -0,0 +1,94 @@
+/****************************************************************************************
+ * File:            velocity_estimator.h
+ *
+ * Purpose:         Estimates the velocity of a joint from its position readings
+ *                  with a critically damped alpha-beta filter.
+ *
+ *                  The bandwidth (hz) trades noise for lag, the filter gains
+ *                  are recomputed from it every sample so uneven sample times
+ *                  from the arduinos are handled correctly. It should be fed
+ *                  only new readings with their acquisition times, between
+ *                  readings the last estimate is held.
+ ***************************************************************************************/
+#ifndef VELOCITY_ESTIMATOR_H
+#define VELOCITY_ESTIMATOR_H
+
+#include <cmath>
+
+namespace tfr_control
+{
+    class VelocityEstimator
+    {
+    public:
+        explicit VelocityEstimator(double bandwidth = 5.0) :
+            omega{2 * M_PI * bandwidth}, position{0}, velocity{0},
+            last_stamp{0}, initialized{false}
+        {}
+
+        void setBandwidth(double bandwidth)
+        {
+            omega = 2 * M_PI * bandwidth;
+        }
+
+        /*
+         * Folds in a new position measurement taken at stamp (s), returns the
+         * velocity estimate
+         * */
+        double update(double measured, double stamp)
+        {
+            double dt = stamp - last_stamp;
+            if (!initialized || dt <= 0 || dt > MAX_GAP)
+            {
+                //nothing sensible to difference against, start over
+                position = measured;
+                velocity = 0;
+                last_stamp = stamp;
+                initialized = true;
+                return velocity;
+            }
+
+            //critically damped gains for this sample interval
+            double theta = std::exp(-omega * dt);
+            double alpha = 1 - theta * theta;
+            double beta = (1 - theta) * (1 - theta);
+
+            double predicted = position + velocity * dt;
+            double residual = measured - predicted;
+            position = predicted + alpha * residual;
+            velocity += beta * residual / dt;
+            last_stamp = stamp;
+            return velocity;
+        }
+
+        /*
+         * Forgets everything, the next measurement starts from rest
+         * */
+        void reset()
+        {
+            velocity = 0;
+            initialized = false;
+        }
+
+        double getVelocity() const
+        {
+            return velocity;
+        }
+
+        double getPosition() const
+        {
+            return position;
+        }
+
+    private:
+        //longer than this between samples and we don't trust the difference
+        static constexpr double MAX_GAP = 0.5;
+
+        double omega;
+        double position;
+        double velocity;
+        double last_stamp;
+        bool initialized;
+    };
+}
+
+#endif // VELOCITY_ESTIMATOR_H
@@ -0,0 +1,159 @@
+/****************************************************************************************
+ * File:            actuator_calibration.cpp
+ *
+ * Purpose:         This is the implementation file for the ActuatorCalibration
+ *                  class. See tfr_control/include/tfr_control/actuator_calibration.h
+ *                  for details.
+ ***************************************************************************************/
+#include "actuator_calibration.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+namespace tfr_control
+{
+    ActuatorCalibration::ActuatorCalibration(const Settings &s,
+            const std::vector<Joint> &j, const std::vector<std::string> &n) :
+        settings(s), joints{j}, names{n},
+        pwm(j.size()), velocity(j.size()), acceleration(j.size()),
+        joint{0}, run{-1}, phase{Phase::SETTLE}, phase_start{0}, settle_time{0},
+        run_start_position{0}, measure_start_position{0}
+    {}
+
+    bool ActuatorCalibration::update(RobotInterface &robot, const double &now)
+    {
+        if (joint >= joints.size())
+            return true;
+        if (run < 0)
+        {
+            ROS_INFO("Actuator Calibration: sweeping %s", names[joint].c_str());
+            run = 0;
+            startRun(robot, now);
+            return false;
+        }
+
+        double position = robot.getJointPosition(joints[joint]);
+        bool too_far = std::abs(position - run_start_position) > settings.max_travel;
+        double elapsed = now - phase_start;
+
+        if (phase == Phase::SETTLE &&
+                (elapsed >= settings.settle_time || too_far))
+        {
+            phase = Phase::MEASURE;
+            phase_start = now;
+            settle_time = elapsed;
+            measure_start_position = position;
+            //no room left to measure in, this run gives us nothing
+            if (!too_far)
+                return false;
+            elapsed = 0;
+        }
+
+        if (phase == Phase::MEASURE &&
+                (elapsed >= settings.measure_time || too_far))
+        {
+            if (elapsed > 0)
+            {
+                double measured = (position - measure_start_position) / elapsed;
+                pwm[joint].push_back(runPWM());
+                velocity[joint].push_back(measured);
+                //behind where holding v the whole time would have got to
+                double speed = std::abs(measured);
+                double lag = speed * settle_time -
+                    std::abs(measure_start_position - run_start_position);
+                double rate = lag > 0 ? speed * speed / (2 * lag) :
+                    std::numeric_limits<double>::infinity();
+                acceleration[joint].push_back(rate);
+                ROS_INFO("Actuator Calibration: %s pwm %f velocity %f acceleration %f",
+                        names[joint].c_str(), runPWM(), measured, rate);
+            }
+
+            run++;
+            if (run >= 2 * settings.steps)
+            {
+                robot.clearOverrides();
+                joint++;
+                run = -1;
+                return joint >= joints.size();
+            }
+            startRun(robot, now);
+        }
+        return false;
+    }
+
+    bool ActuatorCalibration::save(const std::string &path) const
+    {
+        std::ofstream out{path};
+        if (!out)
+            return false;
+        out << "# velocity (rad/s) measured at each pwm by the control node's calibration mode\n";
+        for (size_t i = 0; i < joints.size(); i++)
+        {
+            out << names[i] << ":\n";
+            out << "  pwm: [";
+            for (size_t k = 0; k < pwm[i].size(); k++)
+                out << (k ? ", " : "") << pwm[i][k];
+            out << "]\n";
+            out << "  velocity: [";
+            for (size_t k = 0; k < velocity[i].size(); k++)
+                out << (k ? ", " : "") << velocity[i][k];
+            out << "]\n";
+        }
+        return static_cast<bool>(out) && saveLimits();
+    }
+
+    double ActuatorCalibration::runPWM() const
+    {
+        double level = settings.max_pwm * (run / 2 + 1) / settings.steps;
+        return (run % 2 == 0) ? level : -level;
+    }
+
+    void ActuatorCalibration::startRun(RobotInterface &robot, const double &now)
+    {
+        phase = Phase::SETTLE;
+        phase_start = now;
+        run_start_position = robot.getJointPosition(joints[joint]);
+        robot.overridePWM(joints[joint], runPWM());
+    }
+
+    /*
+     * Only what was measured is written, the file is loaded on top of
+     * tfr_moveit's joint_limits.yaml. A joint we got no speed out of is left
+     * out, and one we got no acceleration out of only has its velocity, so
+     * MoveIt keeps whatever it had for the rest.
+     * */
+    bool ActuatorCalibration::saveLimits() const
+    {
+        if (settings.limits_file.empty())
+            return true;
+        std::ofstream out{settings.limits_file};
+        if (!out)
+            return false;
+        out << "# velocity (rad/s) and acceleration (rad/s^2) limits measured by the control node's calibration mode,\n";
+        out << "# loaded over tfr_moveit/config/joint_limits.yaml by passing it to control.launch as measured_limits\n";
+        out << "joint_limits:\n";
+        for (size_t i = 0; i < joints.size(); i++)
+        {
+            double fastest = 0;
+            for (double v : velocity[i])
+                fastest = std::max(fastest, std::abs(v));
+            //the last two runs are the highest pwm, one each way
+            double quickest = std::numeric_limits<double>::infinity();
+            for (size_t k = acceleration[i].size() < 2 ? 0 : acceleration[i].size() - 2;
+                    k < acceleration[i].size(); k++)
+                quickest = std::min(quickest, acceleration[i][k]);
+            bool accelerates = std::isfinite(quickest) && quickest > 0;
+            if (fastest <= 0)
+                continue;
+            out << "  " << names[i] << ":\n";
+            out << "    has_velocity_limits: true\n";
+            out << "    max_velocity: " << fastest << "\n";
+            if (!accelerates)
+                continue;
+            out << "    has_acceleration_limits: true\n";
+            out << "    max_acceleration: " << quickest << "\n";
+        }
+        return static_cast<bool>(out);
+    }
+}
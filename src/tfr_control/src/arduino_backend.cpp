@@ -0,0 +1,75 @@
+/****************************************************************************************
+ * File:            arduino_backend.cpp
+ *
+ * Purpose:         This is the implementation file for the ArduinoBackend class.
+ *                  See tfr_control/include/tfr_control/arduino_backend.h for details.
+ ***************************************************************************************/
+#include "arduino_backend.h"
+
+namespace tfr_control
+{
+    ArduinoBackend::ArduinoBackend(ros::NodeHandle &n) :
+        arduino_a_buffer{}, arduino_b_buffer{},
+        arduino_a{n.subscribe("/sensors/arduino_a", 5,
+                &ArduinoBackend::receiveArduinoA, this)},
+        arduino_b{n.subscribe("/sensors/arduino_b", 5,
+                &ArduinoBackend::receiveArduinoB, this)},
+        pwm_publisher{n.advertise<tfr_msgs::PwmCommand>("/motor_output", 15)}
+    {}
+
+    bool ArduinoBackend::readArduinoA(ArduinoAData &data)
+    {
+        return arduino_a_buffer.read(data);
+    }
+
+    bool ArduinoBackend::readArduinoB(ArduinoBData &data)
+    {
+        return arduino_b_buffer.read(data);
+    }
+
+    void ArduinoBackend::write(const tfr_msgs::PwmCommand &command)
+    {
+        pwm_publisher.publish(command);
+    }
+
+    /*
+     * Callback for our encoder subscriber
+     * */
+    void ArduinoBackend::receiveArduinoA(const tfr_msgs::ArduinoAReadingConstPtr &msg)
+    {
+        ArduinoAData data{};
+        data.stamp = stampOf(msg->header);
+        data.seq = msg->header.seq;
+        data.tread_left_vel = msg->tread_left_vel;
+        data.arm_turntable_pos = msg->arm_turntable_pos;
+        data.arm_lower_pos = msg->arm_lower_pos;
+        data.arm_upper_pos = msg->arm_upper_pos;
+        data.arm_scoop_pos = msg->arm_scoop_pos;
+        data.bin_left_pos = msg->bin_left_pos;
+        data.bin_right_pos = msg->bin_right_pos;
+        arduino_a_buffer.write(data);
+    }
+
+    /*
+     * Callback for our encoder subscriber
+     * */
+    void ArduinoBackend::receiveArduinoB(const tfr_msgs::ArduinoBReadingConstPtr &msg)
+    {
+        ArduinoBData data{};
+        data.stamp = stampOf(msg->header);
+        data.seq = msg->header.seq;
+        data.tread_right_vel = msg->tread_right_vel;
+        arduino_b_buffer.write(data);
+    }
+
+    /*
+     * Acquisition time of a reading, firmware that doesn't stamp its readings
+     * gets the time we received them
+     * */
+    double ArduinoBackend::stampOf(const std_msgs::Header &header)
+    {
+        if (header.stamp.isZero())
+            return ros::Time::now().toSec();
+        return header.stamp.toSec();
+    }
+}
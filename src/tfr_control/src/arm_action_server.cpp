@@ -15,42 +15,131 @@
  *              devel/include/tfr_msgs/ArmMoveFeedback.h
  *              devel/include/tfr_msgs/ArmMoveGoal.h
  *              devel/include/tfr_msgs/ArmMoveResult.h
- * 
+ *
+ *          Nothing here polls. The controller's result and preemption both
+ *          wake the goal thread through a condition variable.
+ *
+ *          Plans are cached by goal and start state, see arm_plan_cache.h. A
+ *          cached plan is checked against the current planning scene before
+ *          it's reused, and forgotten if it's invalid or fails to execute.
+ *          The digging templates can be planned up front and saved, so the
+ *          first dig of a run doesn't pay for planning either.
+ *
+ *          A goal can list waypoints to pass through on the way to its pose.
+ *          Each leg is planned (or found in the cache) on its own, then the
+ *          legs are joined into one path and timed together, with the
+ *          corners at the waypoints blended, so the arm moves past them
+ *          without stopping.
+ *
+ *          A goal can name the goal expected after it in next_pose. That one
+ *          is planned from where this one ends while the arm is moving, and
+ *          cached, so the next goal can start executing as soon as it
+ *          arrives.
+ *
+ *          Every move is retimed before it runs, as fast as the joint
+ *          velocity and acceleration limits allow, see
+ *          tfr_utilities/time_optimal_path.h. The limits are the ones MoveIt
+ *          loaded from tfr_moveit/config/joint_limits.yaml, which the control
+ *          node's calibration measures.
+ *
+ * Parameters:
+ *  ~result_timeout: seconds past the planned duration of a movement we wait
+ *  for the controller to report before giving up on it (double, default: 5.0)
+ *  ~path_resolution: how far apart (rad) moves are sampled when they're
+ *  timed (double, default: 0.01)
+ *  ~path_deviation: furthest (rad) a blended corner may cut away from its
+ *  waypoint, 0 stops at corners sharper than a right angle (double,
+ *  default: 0.05)
+ *  ~plan_cache: whether to reuse plans (bool, default: true)
+ *  ~plan_start_tolerance: furthest (rad) the arm may be from where a cached
+ *  plan starts to reuse it (double, default: 0.02)
+ *  ~plan_cache_size: most plans to remember (int, default: 512)
+ *  ~plan_cache_file: bag to load plans from at startup, and to save them to
+ *  after preplanning, empty for neither (string, default: "")
+ *  ~templates/positions: digging templates in the format of
+ *  tfr_mining/data/digging_queue_templates.yaml, every move between
+ *  consecutive states is planned at startup if it isn't cached (default: none)
+ *
  ***************************************************************************************/
 #include <ros/ros.h>
 #include <control_msgs/FollowJointTrajectoryActionResult.h>
 #include <actionlib/server/simple_action_server.h>
 #include <tfr_msgs/ArmMoveAction.h>
 #include <moveit/move_group_interface/move_group_interface.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit_msgs/GetPlanningScene.h>
+#include <std_srvs/SetBool.h>
+#include <tfr_utilities/time_optimal_path.h>
+#include "arm_plan_cache.h"
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
 
 //typedef actionlib::SimpleActionServer<tfr_msgs::ArmMoveAction> Server;
 typedef moveit::planning_interface::MoveItErrorCode MoveItErrorCode;
 
 class ArmActionServer {
 public:
-    ArmActionServer(ros::NodeHandle &n) : move_group{"arm_end"}, joint_model_group(*move_group.getCurrentState()->getJointModelGroup("arm_end")),
-        server{n, "move_arm", boost::bind(&ArmActionServer::execute, this, _1), false}
+    struct CacheSettings
+    {
+        bool enabled;
+        tfr_control::ArmPlanCache::Settings cache;
+        std::string file;
+        //arm positions in the order they're visited
+        std::vector<std::vector<double>> templates;
+    };
+
+    ArmActionServer(ros::NodeHandle &n, double timeout, double resolution,
+            double deviation, const CacheSettings &cache_settings) : move_group{"arm_end"}, joint_model_group(*move_group.getCurrentState()->getJointModelGroup("arm_end")),
+        server{n, "move_arm", boost::bind(&ArmActionServer::execute, this, _1), false},
+        result_timeout{timeout}, use_cache{cache_settings.enabled}, cache{cache_settings.cache},
+        scene{new planning_scene::PlanningScene(move_group.getRobotModel())},
+        scene_client{n.serviceClient<moveit_msgs::GetPlanningScene>("get_planning_scene")},
+        jog_client{n.serviceClient<std_srvs::SetBool>("toggle_arm_jog")},
+        timing{limitsOf(*move_group.getRobotModel()), resolution, deviation},
+        dig_status{-1}, preempted{false}, shutting_down{false}
     {
         ROS_INFO("Arm Action Server: Starting");
+        if (use_cache)
+            preplan(cache_settings);
+        server.registerPreemptCallback(boost::bind(&ArmActionServer::preemptCallback, this));
         server.start();
         result_sub = n.subscribe("arm_controller/follow_joint_trajectory/result", 1, &ArmActionServer::resultCallback, this);
         ROS_INFO("Arm Action Server: Started");
     }
 
+    /*
+     * Wakes up a goal that's waiting so the server's thread can be joined
+     * */
+    ~ArmActionServer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(digging_mutex);
+            shutting_down = true;
+        }
+        finished.notify_all();
+        server.shutdown();
+    }
+
 private:
     void resultCallback(const control_msgs::FollowJointTrajectoryActionResult::ConstPtr &msg)
     {
-        digging_mutex.lock();
-        if (msg->result.error_code == 0)
         {
-            dig_status = 0;
+            std::lock_guard<std::mutex> lock(digging_mutex);
+            dig_status = (msg->result.error_code == 0) ? 0 : 1;
         }
-        else
+        finished.notify_all();
+    }
+
+    void preemptCallback()
+    {
         {
-            dig_status = 1;
+            std::lock_guard<std::mutex> lock(digging_mutex);
+            preempted = true;
         }
-        digging_mutex.unlock();
+        finished.notify_all();
     }
 
    /*
@@ -68,7 +157,8 @@ private:
 	* invalid. (e.g. it tells the arm to hit the robot, or tells an actuator to 
 	* extend beyond its limits.) MoveIt should fail to produce a plan in these cases.
 	* 
-	* Arguments: An ArmMove action. (a vector of 4 float64) Defined in tfr_messages/action/ArmMove.action.
+	* Arguments: An ArmMove action. (a vector of 4 float64, optionally waypoints
+	* to pass through first) Defined in tfr_messages/action/ArmMove.action.
 	* 
 	* Returns: Sets the arm action server as either completed/preempted/aborted.
 	*
@@ -78,6 +168,7 @@ private:
     void execute(const tfr_msgs::ArmMoveGoalConstPtr& goal)
     {
         ROS_INFO("Arm Action Server: Goal Recieved");
+        releaseJog();
         // Set up the joint space goal vector to travel to based on the input goal
         // from the action server
         std::vector<double> joint_group_positions(4);
@@ -86,18 +177,54 @@ private:
         joint_group_positions[2] = goal->pose[2];
         joint_group_positions[3] = goal->pose[3];
 
-        // Set the current target
-        move_group.setJointValueTarget(joint_group_positions);
+        // Reuse a plan from about here if we have one that's still good,
+        // otherwise plan to the target
+        std::vector<double> start = move_group.getCurrentJointValues();
         moveit::planning_interface::MoveGroupInterface::Plan my_plan;
+        bool cached = false;
+        bool routed = !goal->waypoints.empty();
+        if (!routed && use_cache && cache.find(joint_group_positions, start, my_plan.trajectory_))
+        {
+            cached = retime(my_plan.trajectory_) && isValid(my_plan.trajectory_);
+            if (!cached)
+                cache.erase(joint_group_positions, start);
+        }
 
-        // Try to plan to the given target
-        bool success = (move_group.plan(my_plan) == MoveItErrorCode::SUCCESS);
+        bool success = cached;
+        if (routed)
+        {
+            std::vector<std::vector<double>> route;
+            for (size_t i = 0; i + 4 <= goal->waypoints.size(); i += 4)
+                route.emplace_back(goal->waypoints.begin() + i, goal->waypoints.begin() + i + 4);
+            route.push_back(joint_group_positions);
+            success = goal->waypoints.size() % 4 == 0 &&
+                planRoute(start, route, my_plan.trajectory_);
+        }
+        else if (!cached)
+        {
+            move_group.setJointValueTarget(joint_group_positions);
+            success = (move_group.plan(my_plan) == MoveItErrorCode::SUCCESS);
+            if (success && use_cache)
+                cache.insert(joint_group_positions, my_plan.trajectory_);
+        }
+        // Routes are timed as they're joined, cached plans as they're found,
+        // everything else here. The blends cut MoveIt's corners, so it's the
+        // timed plan that has to be clear
+        if (success && !routed && !cached &&
+                !(retime(my_plan.trajectory_) && isValid(my_plan.trajectory_)))
+        {
+            ROS_WARN("Arm Action Server: couldn't time the plan");
+            success = false;
+        }
 
-        ROS_INFO("Arm Action Server: plan finished");
-        // Reset the done flag, just in case
-        digging_mutex.lock();
-        dig_status = -1;
-        digging_mutex.unlock();
+        ROS_INFO("Arm Action Server: plan finished%s", cached ? " (cached)" : "");
+        // Reset the done flag, a new goal clears any preempt meant for the
+        // last one
+        {
+            std::lock_guard<std::mutex> lock(digging_mutex);
+            dig_status = -1;
+            preempted = server.isPreemptRequested();
+        }
 
         if (success)
         {
@@ -105,31 +232,37 @@ private:
             ROS_INFO("Executing movement");
             move_group.asyncExecute(my_plan);
 
-            ros::Rate rate(10);
+            // Sleep until the controller reports back, we're preempted, or
+            // the movement has run well past how long it should take
+            ros::Duration planned = my_plan.trajectory_.joint_trajectory.points.empty() ?
+                ros::Duration(0) :
+                my_plan.trajectory_.joint_trajectory.points.back().time_from_start;
+            auto deadline = std::chrono::steady_clock::now() +
+                std::chrono::duration<double>(planned.toSec() + result_timeout);
 
-            while (true)
+            // Plan the next goal while this one moves, a preempt waits for
+            // the planning to finish
+            if (use_cache && goal->next_pose.size() == joint_group_positions.size())
+                planBetween(joint_group_positions, goal->next_pose);
+
+            std::unique_lock<std::mutex> lock(digging_mutex);
+            bool woken = finished.wait_until(lock, deadline,
+                    [this]{ return dig_status >= 0 || preempted || shutting_down; });
+            if (!woken)
+            {
+                ROS_WARN("Arm Action Server: no result from the controller, stopping");
+                lock.unlock();
+                move_group.stop();
+                server.setAborted(tfr_msgs::ArmMoveResult());
+                return;
+            }
+            if (dig_status < 0)
             {
-                digging_mutex.lock();
-                if (dig_status >= 0)  // We're done digging (or it errored), break the loop
-                {
-                    digging_mutex.unlock();
-                    break;
-                }
-                digging_mutex.unlock();
-
-                if (server.isPreemptRequested())
-                {
-                    ROS_INFO("Preempting Arm Action Server");
-                    move_group.stop();
-
-                    tfr_msgs::ArmMoveResult result;
-                    server.setPreempted(result);
-                    digging_mutex.lock();
-                    dig_status = -1;
-                    digging_mutex.unlock();
-                    return;
-                }
-                rate.sleep();
+                ROS_INFO("Preempting Arm Action Server");
+                lock.unlock();
+                move_group.stop();
+                server.setPreempted(tfr_msgs::ArmMoveResult());
+                return;
             }
         } else
         {
@@ -144,12 +277,25 @@ private:
         // literally somewhere we aren't allowed to move?"), but that's for
         // later if we determine we need it.
 
-        // Add a delay to ensure that the arm has time to get there within time tolerances
-        // (found an issue where if you send a command too fast afterwards, it has an issue
-        // getting the state and processing fast enough)
-        ros::Duration(0.5).sleep();
+        // The next goal plans from the current state, so wait until MoveIt
+        // has heard one from after the move instead of sleeping blind (found
+        // an issue where if you send a command too fast afterwards, it has an
+        // issue getting the state and processing fast enough)
+        if (success)
+            move_group.getCurrentState(1.0);
+
+        int status;
+        {
+            std::lock_guard<std::mutex> lock(digging_mutex);
+            status = dig_status;
+            dig_status = -1;
+        }
+
+        // Don't keep handing out a plan the controller couldn't follow
+        if (success && status != 0 && use_cache && !routed)
+            cache.erase(joint_group_positions, start);
 
-        if (success && dig_status == 0)
+        if (success && status == 0)
         {
             ROS_DEBUG("Arm Action Server successful!");
             server.setSucceeded(result);
@@ -158,33 +304,282 @@ private:
             ROS_WARN("Arm Action Server unsuccessful...");
             server.setAborted(result);
         }
+    }
+
+    /*
+     * Checks a plan against the current planning scene, a service call and
+     * a collision check of each point, far quicker than planning again
+     * */
+    bool isValid(const moveit_msgs::RobotTrajectory &plan)
+    {
+        robot_trajectory::RobotTrajectory trajectory{move_group.getRobotModel(), "arm_end"};
+        trajectory.setRobotTrajectoryMsg(*move_group.getCurrentState(), plan);
+        return isValid(trajectory);
+    }
 
-        digging_mutex.lock();
-        dig_status = -1;
-        digging_mutex.unlock();
+    bool isValid(const robot_trajectory::RobotTrajectory &trajectory)
+    {
+        moveit_msgs::GetPlanningScene request;
+        request.request.components.components =
+            moveit_msgs::PlanningSceneComponents::SCENE_SETTINGS |
+            moveit_msgs::PlanningSceneComponents::WORLD_OBJECT_GEOMETRY |
+            moveit_msgs::PlanningSceneComponents::ALLOWED_COLLISION_MATRIX;
+        if (!scene_client.call(request))
+        {
+            ROS_WARN("Arm Action Server: no planning scene, can't check a cached plan");
+            return false;
+        }
+        scene->setPlanningSceneDiffMsg(request.response.scene);
+        return scene->isPathValid(trajectory, "arm_end");
+    }
+
+    /*
+     * Plans each leg of a route from start on its own, cached legs are
+     * reused, then joins them into one path and times it as a whole. The
+     * joints keep moving through the waypoints instead of stopping at the
+     * end of every leg.
+     * */
+    bool planRoute(const std::vector<double> &start,
+            const std::vector<std::vector<double>> &route,
+            moveit_msgs::RobotTrajectory &plan)
+    {
+        robot_state::RobotStatePtr current = move_group.getCurrentState();
+        robot_trajectory::RobotTrajectory path{move_group.getRobotModel(), "arm_end"};
+        std::vector<double> from = start;
+        for (const auto &to : route)
+        {
+            moveit_msgs::RobotTrajectory leg;
+            if (!use_cache || !cache.find(to, from, leg))
+            {
+                if (!planLeg(from, to, leg))
+                    return false;
+                if (use_cache)
+                    cache.insert(to, leg);
+            }
+            robot_trajectory::RobotTrajectory part{move_group.getRobotModel(), "arm_end"};
+            part.setRobotTrajectoryMsg(*current, leg);
+            //the first point of every leg after the first is the last of the one before
+            for (size_t i = path.empty() ? 0 : 1; i < part.getWayPointCount(); i++)
+                path.addSuffixWayPoint(part.getWayPoint(i), 0.0);
+            from = to;
+        }
+
+        if (!retime(path) || !isValid(path))
+        {
+            ROS_WARN("Arm Action Server: couldn't join the route into one trajectory");
+            return false;
+        }
+        path.getRobotTrajectoryMsg(plan);
+        return true;
+    }
+
+    /*
+     * Makes sure the trajectory controllers have the arm, teleop may have
+     * left the jog controller in
+     * */
+    void releaseJog()
+    {
+        std_srvs::SetBool request;
+        request.request.data = false;
+        if (!jog_client.call(request) || !request.response.success)
+            ROS_WARN("Arm Action Server: couldn't switch back from arm jog, %s",
+                    request.response.message.c_str());
+    }
+
+    /*
+     * Resamples a plan and times it as fast as the joint limits allow,
+     * MoveIt's own timing ignores acceleration limits it doesn't have
+     * */
+    bool retime(moveit_msgs::RobotTrajectory &plan)
+    {
+        robot_trajectory::RobotTrajectory trajectory{move_group.getRobotModel(), "arm_end"};
+        trajectory.setRobotTrajectoryMsg(*move_group.getCurrentState(), plan);
+        if (!retime(trajectory))
+            return false;
+        trajectory.getRobotTrajectoryMsg(plan);
+        return true;
+    }
+
+    bool retime(robot_trajectory::RobotTrajectory &trajectory)
+    {
+        if (trajectory.empty())
+            return false;
+        std::vector<std::vector<double>> waypoints(trajectory.getWayPointCount());
+        for (size_t i = 0; i < waypoints.size(); i++)
+            trajectory.getWayPoint(i).copyJointGroupPositions("arm_end", waypoints[i]);
+        std::vector<tfr_utilities::TimeOptimalPath::Point> profile;
+        if (!timing.compute(waypoints, profile))
+            return false;
+
+        const auto &names = trajectory.getGroup()->getVariableNames();
+        robot_state::RobotState state = trajectory.getFirstWayPoint();
+        robot_trajectory::RobotTrajectory timed{trajectory.getRobotModel(), "arm_end"};
+        double last = 0;
+        for (const auto &point : profile)
+        {
+            state.setJointGroupPositions("arm_end", point.position);
+            for (size_t j = 0; j < names.size(); j++)
+            {
+                state.setVariableVelocity(names[j], point.velocity[j]);
+                state.setVariableAcceleration(names[j], point.acceleration[j]);
+            }
+            timed.addSuffixWayPoint(state, point.time - last);
+            last = point.time;
+        }
+        trajectory.swap(timed);
+        return true;
+    }
+
+    /*
+     * The limits MoveIt has for the arm, joints without one get MoveIt's
+     * own default of 1
+     * */
+    static tfr_utilities::TimeOptimalPath::Limits limitsOf(const robot_model::RobotModel &model)
+    {
+        tfr_utilities::TimeOptimalPath::Limits limits;
+        for (const auto &name : model.getJointModelGroup("arm_end")->getVariableNames())
+        {
+            const auto &bounds = model.getVariableBounds(name);
+            limits.velocity.push_back(bounds.velocity_bounded_ ? bounds.max_velocity_ : 1.0);
+            limits.acceleration.push_back(bounds.acceleration_bounded_ ?
+                    bounds.max_acceleration_ : 1.0);
+        }
+        return limits;
+    }
+
+    /*
+     * Loads the cache file, then plans every move between consecutive
+     * templates that isn't cached yet, and saves the cache if it planned
+     * anything
+     * */
+    void preplan(const CacheSettings &settings)
+    {
+        if (!settings.file.empty() && cache.load(settings.file))
+            ROS_INFO("Arm Action Server: loaded %zu plans", cache.size());
+
+        size_t planned = 0;
+        ros::WallTime start = ros::WallTime::now();
+        for (size_t i = 1; i < settings.templates.size() && ros::ok(); i++)
+        {
+            if (planBetween(settings.templates[i - 1], settings.templates[i]))
+                planned++;
+        }
+
+        ROS_INFO("Arm Action Server: preplanned %zu moves in %.2f s", planned,
+                (ros::WallTime::now() - start).toSec());
+        if (planned > 0 && !settings.file.empty())
+            cache.save(settings.file);
+    }
+
+    /*
+     * Plans from one arm position to another and caches it, unless it's
+     * already cached. Returns true only if it planned something.
+     * */
+    bool planBetween(const std::vector<double> &from, const std::vector<double> &to)
+    {
+        moveit_msgs::RobotTrajectory plan;
+        if (cache.find(to, from, plan) || !planLeg(from, to, plan))
+            return false;
+        cache.insert(to, plan);
+        return true;
+    }
+
+    /*
+     * Plans from one arm position to another, as if the arm were at the
+     * first
+     * */
+    bool planLeg(const std::vector<double> &from, const std::vector<double> &to,
+            moveit_msgs::RobotTrajectory &trajectory)
+    {
+        moveit::planning_interface::MoveGroupInterface::Plan plan;
+        robot_state::RobotState state = *move_group.getCurrentState();
+        state.setJointGroupPositions("arm_end", from);
+        move_group.setStartState(state);
+        move_group.setJointValueTarget(to);
+        bool success = (move_group.plan(plan) == MoveItErrorCode::SUCCESS);
+        move_group.setStartStateToCurrentState();
+        if (!success)
+        {
+            ROS_WARN("Arm Action Server: couldn't plan to %f %f %f %f",
+                    to[0], to[1], to[2], to[3]);
+            return false;
+        }
+        trajectory = plan.trajectory_;
+        return true;
     }
 
     moveit::planning_interface::MoveGroupInterface move_group;
     const robot_state::JointModelGroup joint_model_group;
     actionlib::SimpleActionServer<tfr_msgs::ArmMoveAction> server;
     ros::Subscriber result_sub;
+    const double result_timeout;
 
+    // plans we've made, only touched by the goal thread once we've started
+    const bool use_cache;
+    tfr_control::ArmPlanCache cache;
+    planning_scene::PlanningScenePtr scene;
+    ros::ServiceClient scene_client;
+    ros::ServiceClient jog_client;
+    const tfr_utilities::TimeOptimalPath timing;
+
+    // guards everything below, finished is signalled whenever any of it
+    // changes
     std::mutex digging_mutex;
+    std::condition_variable finished;
     // < 0 = in_progress, 0 = successful, > 0 = errored
     int dig_status;
+    bool preempted;
+    bool shutting_down;
 };
 
 int main(int argc, char** argv)
 {
     ros::init(argc, argv, "arm_action_server");
     ros::NodeHandle n;
+    double result_timeout;
+    ros::param::param<double>("~result_timeout", result_timeout, 5.0);
+    double path_resolution;
+    ros::param::param<double>("~path_resolution", path_resolution, 0.01);
+    double path_deviation;
+    ros::param::param<double>("~path_deviation", path_deviation, 0.05);
+
+    ArmActionServer::CacheSettings cache_settings;
+    int cache_size;
+    ros::param::param<bool>("~plan_cache", cache_settings.enabled, true);
+    ros::param::param<double>("~plan_start_tolerance", cache_settings.cache.start_tolerance, 0.02);
+    ros::param::param<int>("~plan_cache_size", cache_size, 512);
+    ros::param::param<std::string>("~plan_cache_file", cache_settings.file, "");
+    cache_settings.cache.capacity = std::max(cache_size, 0);
+    if (cache_settings.cache.start_tolerance <= 0)
+    {
+        ROS_WARN("Arm Action Server: plan_start_tolerance must be positive, not caching");
+        cache_settings.enabled = false;
+    }
+
+    // Same layout as the digging queue, sets of states of which the first
+    // four values are the arm
+    XmlRpc::XmlRpcValue positions;
+    if (ros::param::get("~templates/positions", positions))
+    {
+        for (int i = 0; i < positions.size(); i++)
+        {
+            for (int j = 0; j < positions[i].size(); j++)
+            {
+                std::vector<double> state;
+                for (int angle = 0; angle < 4; angle++)
+                    state.push_back(positions[i][j][angle]);
+                cache_settings.templates.push_back(state);
+            }
+        }
+    }
 
     // An async spinner is required here for the MoveIt setup to connect properly
     ros::AsyncSpinner spinner(1);
     spinner.start();
 
-    ArmActionServer aas(n);
+    ArmActionServer aas(n, result_timeout, path_resolution, path_deviation, cache_settings);
 
-    while (ros::ok()) ;
+    // Everything happens on the spinner and action server threads
+    ros::waitForShutdown();
     return 0;
 }
@@ -0,0 +1,128 @@
+/****************************************************************************************
+ * File:            arm_jog_controller.cpp
+ *
+ * Purpose:         This is the implementation file for the ArmJogController
+ *                  class. See tfr_control/include/tfr_control/arm_jog_controller.h
+ *                  for details.
+ ***************************************************************************************/
+#include "arm_jog_controller.h"
+#include <pluginlib/class_list_macros.h>
+#include <urdf/model.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace tfr_control
+{
+    ArmJogController::ArmJogController() : deadman_timeout{0}, max_lead{0}, jogging{false} {}
+
+    bool ArmJogController::init(hardware_interface::PositionJointInterface *hw,
+            ros::NodeHandle &root, ros::NodeHandle &n)
+    {
+        std::vector<std::string> names;
+        if (!n.getParam("joints", names) || names.empty())
+        {
+            ROS_ERROR("Arm Jog Controller: no joints given");
+            return false;
+        }
+        n.param<double>("deadman_timeout", deadman_timeout, 0.8);
+        n.param<double>("max_lead", max_lead, 0.1);
+        if (deadman_timeout <= 0 || max_lead <= 0)
+        {
+            ROS_ERROR("Arm Jog Controller: deadman_timeout and max_lead must be positive");
+            return false;
+        }
+
+        std::string description;
+        urdf::Model model;
+        if (!root.getParam("robot_description", description) || !model.initString(description))
+        {
+            ROS_ERROR("Arm Jog Controller: couldn't read the robot description");
+            return false;
+        }
+
+        const double infinity = std::numeric_limits<double>::infinity();
+        for (const auto &name : names)
+        {
+            auto joint = model.getJoint(name);
+            if (!joint || !joint->limits)
+            {
+                ROS_ERROR("Arm Jog Controller: %s has no limits in the robot description",
+                        name.c_str());
+                return false;
+            }
+            //continuous joints only have a velocity limit
+            bool bounded = joint->type != urdf::Joint::CONTINUOUS;
+            lower_limits.push_back(bounded ? joint->limits->lower : -infinity);
+            upper_limits.push_back(bounded ? joint->limits->upper : infinity);
+            velocity_limits.push_back(joint->limits->velocity);
+            try
+            {
+                joints.push_back(hw->getHandle(name));
+            }
+            catch (const hardware_interface::HardwareInterfaceException &e)
+            {
+                ROS_ERROR("Arm Jog Controller: %s", e.what());
+                return false;
+            }
+        }
+        targets.resize(joints.size(), 0);
+
+        command.writeFromNonRT(Command{std::vector<double>(joints.size(), 0), ros::Time(0)});
+        jog_subscriber = root.subscribe("arm_jog", 1, &ArmJogController::jogCallback, this,
+                ros::TransportHints().tcpNoDelay());
+        return true;
+    }
+
+    void ArmJogController::starting(const ros::Time &time)
+    {
+        //hold wherever the trajectory controllers left the arm
+        for (size_t i = 0; i < joints.size(); i++)
+            targets[i] = joints[i].getPosition();
+        start_time = time;
+        jogging = false;
+    }
+
+    void ArmJogController::update(const ros::Time &time, const ros::Duration &period)
+    {
+        const Command &latest = *command.readFromRT();
+        bool live = latest.stamp > start_time &&
+            (time - latest.stamp).toSec() < deadman_timeout;
+        bool moving = live && std::any_of(latest.velocity.begin(), latest.velocity.end(),
+                [](double v){ return v != 0; });
+        double dt = period.toSec();
+        for (size_t i = 0; i < joints.size(); i++)
+        {
+            double position = joints[i].getPosition();
+            if (moving)
+            {
+                double velocity = std::max(-velocity_limits[i],
+                        std::min(latest.velocity[i], velocity_limits[i]));
+                double target = std::max(position - max_lead,
+                        std::min(targets[i] + velocity * dt, position + max_lead));
+                targets[i] = std::max(lower_limits[i], std::min(target, upper_limits[i]));
+            }
+            //the jog just ended, stop where the joint is rather than where
+            //the target got to
+            else if (jogging)
+                targets[i] = std::max(lower_limits[i], std::min(position, upper_limits[i]));
+            joints[i].setCommand(targets[i]);
+        }
+        jogging = moving;
+    }
+
+    void ArmJogController::jogCallback(const tfr_msgs::ArmJog::ConstPtr &msg)
+    {
+        if (msg->velocity.size() != joints.size() ||
+                !std::all_of(msg->velocity.begin(), msg->velocity.end(),
+                    [](double v){ return std::isfinite(v); }))
+        {
+            ROS_WARN_THROTTLE(1.0, "Arm Jog Controller: ignoring a jog that isn't %zu finite velocities",
+                    joints.size());
+            return;
+        }
+        command.writeFromNonRT(Command{msg->velocity, ros::Time::now()});
+    }
+}
+
+PLUGINLIB_EXPORT_CLASS(tfr_control::ArmJogController, controller_interface::ControllerBase)
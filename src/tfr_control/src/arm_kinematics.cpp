@@ -0,0 +1,124 @@
+/****************************************************************************************
+ * File:            arm_kinematics.cpp
+ *
+ * Purpose:         This is the implementation file for the ArmKinematics class.
+ *                  See tfr_control/include/tfr_control/arm_kinematics.h for details.
+ ***************************************************************************************/
+#include "arm_kinematics.h"
+#include <algorithm>
+#include <cmath>
+
+namespace tfr_control
+{
+    namespace
+    {
+        //slack for rounding, in meters off the plane and radians past a limit
+        constexpr double EPSILON = 1e-9;
+        constexpr double PLANE_TOLERANCE = 1e-6;
+    }
+
+    ArmKinematics::ArmKinematics(const Geometry &g, const Joints &l, const Joints &u) :
+        geometry(g), lower(l), upper(u),
+        lower_length{std::hypot(g.elbow_x, g.elbow_z)},
+        lower_angle{std::atan2(g.elbow_x, g.elbow_z)},
+        upper_length{std::hypot(g.wrist_x, g.wrist_z)},
+        upper_angle{std::atan2(g.wrist_x, g.wrist_z)} {}
+
+    const ArmKinematics::Geometry& ArmKinematics::getGeometry() const
+    {
+        return geometry;
+    }
+
+    /*
+     * A pitch joint at angle turns its child's (x, z) into
+     * (x cos + z sin, z cos - x sin), so a link of length l at angle a off z
+     * ends up at l (sin(a + angle), cos(a + angle))
+     * */
+    ArmKinematics::Pose ArmKinematics::forward(const Joints &joints) const
+    {
+        double lower_pitch = joints[1];
+        double upper_pitch = lower_pitch + joints[2];
+        double scoop_pitch = upper_pitch + joints[3];
+
+        //reach along the turntable's x axis, and height over its joint
+        double reach = geometry.shoulder_x
+            + lower_length * std::sin(lower_pitch + lower_angle)
+            + upper_length * std::sin(upper_pitch + upper_angle)
+            + geometry.tip_x * std::cos(scoop_pitch) + geometry.tip_z * std::sin(scoop_pitch);
+        double height = geometry.shoulder_z
+            + lower_length * std::cos(lower_pitch + lower_angle)
+            + upper_length * std::cos(upper_pitch + upper_angle)
+            - geometry.tip_x * std::sin(scoop_pitch) + geometry.tip_z * std::cos(scoop_pitch);
+
+        double yaw = geometry.base_yaw + joints[0];
+        return Pose{geometry.base_x + reach * std::cos(yaw),
+            geometry.base_y + reach * std::sin(yaw),
+            geometry.base_z + height,
+            wrap(yaw), wrap(scoop_pitch)};
+    }
+
+    std::vector<ArmKinematics::Joints> ArmKinematics::inverse(const Pose &pose) const
+    {
+        std::vector<Joints> solutions;
+
+        //the target in the arm's plane, reach is negative behind the axis
+        double dx = pose.x - geometry.base_x;
+        double dy = pose.y - geometry.base_y;
+        double heading_x = std::cos(pose.yaw), heading_y = std::sin(pose.yaw);
+        if (std::abs(dy * heading_x - dx * heading_y) > PLANE_TOLERANCE)
+            return solutions;
+        double reach = dx * heading_x + dy * heading_y;
+        double height = pose.z - geometry.base_z;
+
+        //back off the tip to the scoop joint, then measure from the shoulder
+        double sin_pitch = std::sin(pose.pitch), cos_pitch = std::cos(pose.pitch);
+        double wrist_reach = reach - geometry.tip_x * cos_pitch - geometry.tip_z * sin_pitch;
+        double wrist_height = height + geometry.tip_x * sin_pitch - geometry.tip_z * cos_pitch;
+        double qx = wrist_reach - geometry.shoulder_x;
+        double qz = wrist_height - geometry.shoulder_z;
+
+        //law of cosines for the angle between the two links
+        double cos_bend = (qx * qx + qz * qz - lower_length * lower_length
+                - upper_length * upper_length) / (2 * lower_length * upper_length);
+        if (std::abs(cos_bend) > 1 + EPSILON)
+            return solutions;
+        double bend = std::acos(std::max(-1.0, std::min(cos_bend, 1.0)));
+
+        double turntable = wrap(pose.yaw - geometry.base_yaw);
+        for (double elbow : {bend, -bend})
+        {
+            double lower_pitch = std::atan2(qx, qz) - std::atan2(upper_length * std::sin(elbow),
+                    lower_length + upper_length * std::cos(elbow));
+            Joints joints;
+            joints[1] = wrap(lower_pitch - lower_angle);
+            joints[2] = wrap(elbow + lower_angle - upper_angle);
+            joints[3] = wrap(pose.pitch - joints[1] - joints[2]);
+            if (withinLimits(1, joints[1]) && withinLimits(2, joints[2]) &&
+                    withinLimits(3, joints[3]))
+            {
+                //the turntable can go past half a turn either way
+                for (double offset : {-2 * M_PI, 0.0, 2 * M_PI})
+                {
+                    joints[0] = turntable + offset;
+                    if (withinLimits(0, joints[0]))
+                        solutions.push_back(joints);
+                }
+            }
+            //a straight arm only has the one answer
+            if (bend < EPSILON)
+                break;
+        }
+        return solutions;
+    }
+
+    double ArmKinematics::wrap(double angle)
+    {
+        angle = std::remainder(angle, 2 * M_PI);
+        return angle <= -M_PI ? angle + 2 * M_PI : angle;
+    }
+
+    bool ArmKinematics::withinLimits(size_t joint, double angle) const
+    {
+        return angle >= lower[joint] - EPSILON && angle <= upper[joint] + EPSILON;
+    }
+}
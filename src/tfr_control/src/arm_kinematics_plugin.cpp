@@ -0,0 +1,358 @@
+/****************************************************************************************
+ * File:            arm_kinematics_plugin.cpp
+ *
+ * Purpose:         This is the implementation file for the ArmKinematicsPlugin
+ *                  class. See tfr_control/include/tfr_control/arm_kinematics_plugin.h
+ *                  for details.
+ ***************************************************************************************/
+#include "arm_kinematics_plugin.h"
+#include <moveit/rdf_loader/rdf_loader.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_model/revolute_joint_model.h>
+#include <pluginlib/class_list_macros.h>
+#include <algorithm>
+#include <cmath>
+
+namespace tfr_control
+{
+    namespace
+    {
+        //how far the robot description may be from the shape we solve for
+        constexpr double SHAPE_TOLERANCE = 1e-6;
+        const size_t JOINTS = 4;
+
+        bool isAbout(const Eigen::Vector3d &axis, const Eigen::Vector3d &expected)
+        {
+            return (axis - expected).norm() < SHAPE_TOLERANCE;
+        }
+
+        //pitch joints can't be turned or offset out of the arm's plane
+        bool isInPlane(const Eigen::Affine3d &origin)
+        {
+            return origin.linear().isIdentity(SHAPE_TOLERANCE) &&
+                std::abs(origin.translation().y()) < SHAPE_TOLERANCE;
+        }
+
+        Eigen::Matrix3d orientation(double yaw, double pitch)
+        {
+            return (Eigen::AngleAxisd(yaw, Eigen::Vector3d::UnitZ()) *
+                    Eigen::AngleAxisd(pitch, Eigen::Vector3d::UnitY())).toRotationMatrix();
+        }
+
+        double distance(const ArmKinematics::Joints &joints, const std::vector<double> &seed)
+        {
+            double total = 0;
+            for (size_t i = 0; i < JOINTS; i++)
+                total += (joints[i] - seed[i]) * (joints[i] - seed[i]);
+            return total;
+        }
+    }
+
+    ArmKinematicsPlugin::ArmKinematicsPlugin() :
+        position_only_ik{false}, orientation_tolerance{0.001} {}
+
+    bool ArmKinematicsPlugin::initialize(const std::string &robot_description,
+            const std::string &group_name, const std::string &base_frame,
+            const std::string &tip_frame, double search_discretization)
+    {
+        setValues(robot_description, group_name, base_frame, tip_frame, search_discretization);
+        lookupParam("position_only_ik", position_only_ik, false);
+        lookupParam("orientation_tolerance", orientation_tolerance, 0.001);
+
+        rdf_loader::RDFLoader loader(robot_description);
+        if (!loader.getURDF() || !loader.getSRDF())
+        {
+            ROS_ERROR("Arm Kinematics: couldn't load %s", robot_description.c_str());
+            return false;
+        }
+        robot_model::RobotModel model(loader.getURDF(), loader.getSRDF());
+        const robot_model::JointModelGroup *group = model.getJointModelGroup(group_name);
+        if (group == nullptr)
+        {
+            ROS_ERROR("Arm Kinematics: no group %s", group_name.c_str());
+            return false;
+        }
+
+        //the turntable, then three pitch joints, each the child of the last
+        const auto &joints = group->getActiveJointModels();
+        if (joints.size() != JOINTS)
+        {
+            ROS_ERROR("Arm Kinematics: %s has %zu joints, expected %zu",
+                    group_name.c_str(), joints.size(), JOINTS);
+            return false;
+        }
+        std::vector<Eigen::Affine3d> origins;
+        ArmKinematics::Joints lower, upper;
+        for (size_t i = 0; i < JOINTS; i++)
+        {
+            const robot_model::JointModel *joint = joints[i];
+            const std::string &parent = i == 0 ? base_frame :
+                joints[i - 1]->getChildLinkModel()->getName();
+            if (joint->getType() != robot_model::JointModel::REVOLUTE ||
+                    joint->getParentLinkModel()->getName() != parent)
+            {
+                ROS_ERROR("Arm Kinematics: %s isn't a revolute joint on %s",
+                        joint->getName().c_str(), parent.c_str());
+                return false;
+            }
+            const auto &axis =
+                static_cast<const robot_model::RevoluteJointModel*>(joint)->getAxis();
+            const auto &origin = joint->getChildLinkModel()->getJointOriginTransform();
+            bool shaped = i == 0 ?
+                isAbout(axis, Eigen::Vector3d::UnitZ()) &&
+                    std::abs(origin.linear()(2, 2) - 1) < SHAPE_TOLERANCE :
+                isAbout(axis, Eigen::Vector3d::UnitY()) && isInPlane(origin);
+            if (!shaped)
+            {
+                ROS_ERROR("Arm Kinematics: %s isn't shaped like the digging arm",
+                        joint->getName().c_str());
+                return false;
+            }
+            origins.push_back(origin);
+            const auto &bounds = joint->getVariableBounds()[0];
+            lower[i] = bounds.min_position_;
+            upper[i] = bounds.max_position_;
+            joint_names.push_back(joint->getName());
+        }
+
+        //the tip can hang off the last link on fixed joints
+        const robot_model::LinkModel *last = joints.back()->getChildLinkModel();
+        const robot_model::LinkModel *link = model.getLinkModel(tip_frame);
+        Eigen::Affine3d tip = Eigen::Affine3d::Identity();
+        while (link != nullptr && link != last)
+        {
+            if (link->getParentJointModel()->getType() != robot_model::JointModel::FIXED)
+                link = nullptr;
+            else
+            {
+                tip = link->getJointOriginTransform() * tip;
+                link = link->getParentLinkModel();
+            }
+        }
+        if (link == nullptr || std::abs(tip.translation().y()) > SHAPE_TOLERANCE)
+        {
+            ROS_ERROR("Arm Kinematics: %s isn't fixed in the plane of %s",
+                    tip_frame.c_str(), last->getName().c_str());
+            return false;
+        }
+        tip_rotation = tip.linear();
+        link_names = {tip_frame};
+
+        ArmKinematics::Geometry geometry;
+        geometry.base_x = origins[0].translation().x();
+        geometry.base_y = origins[0].translation().y();
+        geometry.base_z = origins[0].translation().z();
+        geometry.base_yaw = std::atan2(origins[0].linear()(1, 0), origins[0].linear()(0, 0));
+        geometry.shoulder_x = origins[1].translation().x();
+        geometry.shoulder_z = origins[1].translation().z();
+        geometry.elbow_x = origins[2].translation().x();
+        geometry.elbow_z = origins[2].translation().z();
+        geometry.wrist_x = origins[3].translation().x();
+        geometry.wrist_z = origins[3].translation().z();
+        geometry.tip_x = tip.translation().x();
+        geometry.tip_z = tip.translation().z();
+        arm.reset(new ArmKinematics(geometry, lower, upper));
+        return true;
+    }
+
+    bool ArmKinematicsPlugin::getPositionIK(const geometry_msgs::Pose &ik_pose,
+            const std::vector<double> &ik_seed_state, std::vector<double> &solution,
+            moveit_msgs::MoveItErrorCodes &error_code,
+            const kinematics::KinematicsQueryOptions &options) const
+    {
+        return searchPositionIK(ik_pose, ik_seed_state, default_timeout_, std::vector<double>(),
+                solution, IKCallbackFn(), error_code, options);
+    }
+
+    bool ArmKinematicsPlugin::getPositionIK(const std::vector<geometry_msgs::Pose> &ik_poses,
+            const std::vector<double> &ik_seed_state,
+            std::vector<std::vector<double>> &solutions,
+            kinematics::KinematicsResult &result,
+            const kinematics::KinematicsQueryOptions &options) const
+    {
+        solutions.clear();
+        result.solution_percentage = 0;
+        if (ik_poses.size() != 1)
+        {
+            result.kinematic_error = kinematics::KinematicErrors::MULTIPLE_TIPS_NOT_SUPPORTED;
+            return false;
+        }
+        for (const auto &joints : solve(ik_poses[0], ik_seed_state, std::vector<double>()))
+            solutions.emplace_back(joints.begin(), joints.end());
+        if (solutions.empty())
+        {
+            result.kinematic_error = kinematics::KinematicErrors::NO_SOLUTION;
+            return false;
+        }
+        result.kinematic_error = kinematics::KinematicErrors::OK;
+        result.solution_percentage = 1;
+        return true;
+    }
+
+    bool ArmKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose &ik_pose,
+            const std::vector<double> &ik_seed_state, double timeout,
+            std::vector<double> &solution, moveit_msgs::MoveItErrorCodes &error_code,
+            const kinematics::KinematicsQueryOptions &options) const
+    {
+        return searchPositionIK(ik_pose, ik_seed_state, timeout, std::vector<double>(),
+                solution, IKCallbackFn(), error_code, options);
+    }
+
+    bool ArmKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose &ik_pose,
+            const std::vector<double> &ik_seed_state, double timeout,
+            const std::vector<double> &consistency_limits, std::vector<double> &solution,
+            moveit_msgs::MoveItErrorCodes &error_code,
+            const kinematics::KinematicsQueryOptions &options) const
+    {
+        return searchPositionIK(ik_pose, ik_seed_state, timeout, consistency_limits,
+                solution, IKCallbackFn(), error_code, options);
+    }
+
+    bool ArmKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose &ik_pose,
+            const std::vector<double> &ik_seed_state, double timeout,
+            std::vector<double> &solution, const IKCallbackFn &solution_callback,
+            moveit_msgs::MoveItErrorCodes &error_code,
+            const kinematics::KinematicsQueryOptions &options) const
+    {
+        return searchPositionIK(ik_pose, ik_seed_state, timeout, std::vector<double>(),
+                solution, solution_callback, error_code, options);
+    }
+
+    /*
+     * There's nothing to search, so the timeout is ignored, we just offer the
+     * callback each solution in turn until it takes one
+     * */
+    bool ArmKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose &ik_pose,
+            const std::vector<double> &ik_seed_state, double timeout,
+            const std::vector<double> &consistency_limits, std::vector<double> &solution,
+            const IKCallbackFn &solution_callback, moveit_msgs::MoveItErrorCodes &error_code,
+            const kinematics::KinematicsQueryOptions &options) const
+    {
+        if (ik_seed_state.size() != JOINTS ||
+                (!consistency_limits.empty() && consistency_limits.size() != JOINTS))
+        {
+            ROS_ERROR_THROTTLE(1.0, "Arm Kinematics: expected %zu joints in the seed and limits",
+                    JOINTS);
+            error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_ROBOT_STATE;
+            return false;
+        }
+        for (const auto &joints : solve(ik_pose, ik_seed_state, consistency_limits))
+        {
+            solution.assign(joints.begin(), joints.end());
+            error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+            if (solution_callback)
+                solution_callback(ik_pose, solution, error_code);
+            if (error_code.val == moveit_msgs::MoveItErrorCodes::SUCCESS)
+                return true;
+        }
+        error_code.val = moveit_msgs::MoveItErrorCodes::NO_IK_SOLUTION;
+        return false;
+    }
+
+    bool ArmKinematicsPlugin::getPositionFK(const std::vector<std::string> &names,
+            const std::vector<double> &joint_angles,
+            std::vector<geometry_msgs::Pose> &poses) const
+    {
+        if (joint_angles.size() != JOINTS)
+            return false;
+        ArmKinematics::Joints joints;
+        std::copy(joint_angles.begin(), joint_angles.end(), joints.begin());
+        ArmKinematics::Pose tip = arm->forward(joints);
+        Eigen::Quaterniond rotation(orientation(tip.yaw, tip.pitch) * tip_rotation);
+
+        poses.clear();
+        for (const auto &name : names)
+        {
+            if (name != tip_frame_)
+            {
+                ROS_ERROR_THROTTLE(1.0, "Arm Kinematics: can only find the pose of %s",
+                        tip_frame_.c_str());
+                return false;
+            }
+            geometry_msgs::Pose pose;
+            pose.position.x = tip.x;
+            pose.position.y = tip.y;
+            pose.position.z = tip.z;
+            pose.orientation.x = rotation.x();
+            pose.orientation.y = rotation.y();
+            pose.orientation.z = rotation.z();
+            pose.orientation.w = rotation.w();
+            poses.push_back(pose);
+        }
+        return true;
+    }
+
+    const std::vector<std::string>& ArmKinematicsPlugin::getJointNames() const
+    {
+        return joint_names;
+    }
+
+    const std::vector<std::string>& ArmKinematicsPlugin::getLinkNames() const
+    {
+        return link_names;
+    }
+
+    std::vector<ArmKinematics::Joints> ArmKinematicsPlugin::solve(
+            const geometry_msgs::Pose &ik_pose, const std::vector<double> &ik_seed_state,
+            const std::vector<double> &consistency_limits) const
+    {
+        std::vector<ArmKinematics::Joints> solutions;
+        if (ik_seed_state.size() != JOINTS)
+            return solutions;
+
+        const ArmKinematics::Geometry &geometry = arm->getGeometry();
+        double dx = ik_pose.position.x - geometry.base_x;
+        double dy = ik_pose.position.y - geometry.base_y;
+        //over the turntable axis any heading works, so keep the seed's
+        bool on_axis = std::hypot(dx, dy) < SHAPE_TOLERANCE;
+        double toward = on_axis ? geometry.base_yaw + ik_seed_state[0] : std::atan2(dy, dx);
+
+        //the tip is either ahead of the turntable, or reached back over it
+        std::vector<ArmKinematics::Pose> poses;
+        ArmKinematics::Pose pose{ik_pose.position.x, ik_pose.position.y, ik_pose.position.z, 0, 0};
+        if (position_only_ik)
+        {
+            pose.pitch = ik_seed_state[1] + ik_seed_state[2] + ik_seed_state[3];
+            for (double yaw : {toward, toward + M_PI})
+            {
+                pose.yaw = yaw;
+                poses.push_back(pose);
+            }
+        }
+        else
+        {
+            const auto &q = ik_pose.orientation;
+            Eigen::Matrix3d target = Eigen::Quaterniond(q.w, q.x, q.y, q.z).normalized()
+                .toRotationMatrix() * tip_rotation.transpose();
+            //the pitch axis is the last link's y, which can't tilt
+            double heading = std::atan2(-target(0, 1), target(1, 1));
+            pose.yaw = on_axis ? heading :
+                std::abs(ArmKinematics::wrap(heading - toward)) < M_PI / 2 ? toward :
+                toward + M_PI;
+            Eigen::Matrix3d pitched =
+                Eigen::AngleAxisd(-pose.yaw, Eigen::Vector3d::UnitZ()) * target;
+            pose.pitch = std::atan2(pitched(0, 2), pitched(0, 0));
+            Eigen::AngleAxisd error(orientation(pose.yaw, pose.pitch).transpose() * target);
+            if (std::abs(error.angle()) <= orientation_tolerance)
+                poses.push_back(pose);
+        }
+
+        for (const auto &candidate : poses)
+        {
+            for (const auto &joints : arm->inverse(candidate))
+            {
+                bool consistent = true;
+                for (size_t i = 0; i < consistency_limits.size(); i++)
+                    consistent &= std::abs(joints[i] - ik_seed_state[i]) <= consistency_limits[i];
+                if (consistent)
+                    solutions.push_back(joints);
+            }
+        }
+        std::sort(solutions.begin(), solutions.end(),
+                [&ik_seed_state](const ArmKinematics::Joints &a, const ArmKinematics::Joints &b)
+                { return distance(a, ik_seed_state) < distance(b, ik_seed_state); });
+        return solutions;
+    }
+}
+
+PLUGINLIB_EXPORT_CLASS(tfr_control::ArmKinematicsPlugin, kinematics::KinematicsBase)
@@ -0,0 +1,144 @@
+/****************************************************************************************
+ * File:            arm_plan_cache.cpp
+ *
+ * Purpose:         This is the implementation file for the ArmPlanCache class.
+ *                  See tfr_control/include/tfr_control/arm_plan_cache.h for details.
+ ***************************************************************************************/
+#include "arm_plan_cache.h"
+#include <ros/ros.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <rosbag/exceptions.h>
+#include <algorithm>
+#include <cmath>
+
+namespace tfr_control
+{
+    constexpr double ArmPlanCache::GOAL_RESOLUTION;
+
+    namespace
+    {
+        const std::string TOPIC = "arm_plans";
+
+        bool startsNear(const moveit_msgs::RobotTrajectory &plan,
+                const std::vector<double> &start, double tolerance)
+        {
+            const auto &first = plan.joint_trajectory.points.front().positions;
+            if (first.size() != start.size())
+                return false;
+            for (size_t i = 0; i < start.size(); i++)
+                if (std::abs(first[i] - start[i]) > tolerance)
+                    return false;
+            return true;
+        }
+    }
+
+    ArmPlanCache::ArmPlanCache(const Settings &s) : settings(s) {}
+
+    bool ArmPlanCache::find(const std::vector<double> &goal, const std::vector<double> &start,
+            moveit_msgs::RobotTrajectory &plan) const
+    {
+        //every plan to this goal sorts right after the goal on its own
+        Key prefix = keyOf(goal, {});
+        for (auto it = plans.lower_bound(prefix);
+                it != plans.end() && std::equal(prefix.begin(), prefix.end(), it->first.begin());
+                ++it)
+        {
+            if (!startsNear(it->second, start, settings.start_tolerance))
+                continue;
+            plan = it->second;
+            plan.joint_trajectory.points.front().positions = start;
+            return true;
+        }
+        return false;
+    }
+
+    void ArmPlanCache::insert(const std::vector<double> &goal, moveit_msgs::RobotTrajectory plan)
+    {
+        auto &points = plan.joint_trajectory.points;
+        if (points.empty() || points.front().positions.size() != goal.size())
+            return;
+        points.back().positions = goal;
+        Key key = keyOf(goal, points.front().positions);
+        if (plans.size() >= settings.capacity && plans.count(key) == 0)
+        {
+            ROS_WARN_ONCE("Arm Plan Cache: full at %zu plans, not adding more", settings.capacity);
+            return;
+        }
+        plans[key] = std::move(plan);
+    }
+
+    void ArmPlanCache::erase(const std::vector<double> &goal, const std::vector<double> &start)
+    {
+        Key prefix = keyOf(goal, {});
+        for (auto it = plans.lower_bound(prefix);
+                it != plans.end() && std::equal(prefix.begin(), prefix.end(), it->first.begin());
+                ++it)
+        {
+            if (startsNear(it->second, start, settings.start_tolerance))
+            {
+                plans.erase(it);
+                return;
+            }
+        }
+    }
+
+    size_t ArmPlanCache::size() const
+    {
+        return plans.size();
+    }
+
+    bool ArmPlanCache::load(const std::string &file)
+    {
+        try
+        {
+            rosbag::Bag bag{file, rosbag::bagmode::Read};
+            rosbag::View view{bag, rosbag::TopicQuery(TOPIC)};
+            for (const auto &message : view)
+            {
+                auto plan = message.instantiate<moveit_msgs::RobotTrajectory>();
+                if (plan != nullptr && !plan->joint_trajectory.points.empty())
+                    insert(plan->joint_trajectory.points.back().positions, *plan);
+            }
+        }
+        catch (const rosbag::BagException &e)
+        {
+            ROS_WARN("Arm Plan Cache: couldn't load %s: %s", file.c_str(), e.what());
+            return false;
+        }
+        return true;
+    }
+
+    bool ArmPlanCache::save(const std::string &file) const
+    {
+        try
+        {
+            rosbag::Bag bag{file, rosbag::bagmode::Write};
+            //the stamps mean nothing, and now is zero until a sim clock starts
+            for (const auto &entry : plans)
+                bag.write(TOPIC, ros::TIME_MIN, entry.second);
+        }
+        catch (const rosbag::BagException &e)
+        {
+            ROS_WARN("Arm Plan Cache: couldn't save %s: %s", file.c_str(), e.what());
+            return false;
+        }
+        return true;
+    }
+
+    /*
+     * The goal quantized finely, then the start quantized to the tolerance,
+     * so plans from about the same start replace each other
+     * */
+    ArmPlanCache::Key ArmPlanCache::keyOf(const std::vector<double> &goal,
+            const std::vector<double> &start) const
+    {
+        Key key;
+        key.reserve(goal.size() + start.size());
+        for (double angle : goal)
+            key.push_back(std::llround(angle / GOAL_RESOLUTION));
+        for (double angle : start)
+            key.push_back(std::llround(angle / settings.start_tolerance));
+        return key;
+    }
+}
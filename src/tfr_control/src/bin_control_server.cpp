@@ -0,0 +1,135 @@
+/****************************************************************************************
+ * File:            bin_control_server.cpp
+ *
+ * Purpose:         This is the implementation file for the BinControlServer class.
+ *                  See tfr_control/include/tfr_control/bin_control_server.h for details.
+ ***************************************************************************************/
+#include "bin_control_server.h"
+#include <tfr_utilities/control_code.h>
+#include <std_msgs/Float64.h>
+#include <chrono>
+#include <cmath>
+
+namespace tfr_control
+{
+    BinControlServer::BinControlServer(ros::NodeHandle& n, const Settings &s) :
+        node{n}, settings(s),
+        server{n, "bin", boost::bind(&BinControlServer::ControlBin, this, _1), false},
+        bin_command_publisher{n.advertise<std_msgs::Float64>(
+                "/bin_position_controller/command", 5)},
+        target{std::nan("")}, goal_tolerance{s.tolerance}, last_position{0},
+        bin_task_completed{false}, preempted{false}, shutting_down{false}
+    {
+        server.registerPreemptCallback(boost::bind(&BinControlServer::Preempt, this));
+        server.start();
+    }
+
+    /*
+     * Wakes up a goal that's waiting so the server's thread can be joined
+     * */
+    BinControlServer::~BinControlServer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(signal_mutex);
+            shutting_down = true;
+        }
+        signal.notify_all();
+        server.shutdown();
+    }
+
+    void BinControlServer::SignalBinController(const double &position)
+    {
+        last_position = position;
+        double goal = target;
+        if (std::isnan(goal) || std::abs(position - goal) > goal_tolerance)
+            return;
+        //only signal once per goal, and never clear a newer one
+        if (!target.compare_exchange_strong(goal, std::nan("")))
+            return;
+        {
+            std::lock_guard<std::mutex> lock(signal_mutex);
+            bin_task_completed = true;
+        }
+        signal.notify_all();
+    }
+
+    void BinControlServer::ControlBin(const tfr_msgs::BinGoalConstPtr& goal)
+    {
+        tfr_msgs::BinResult result;
+        double angle;
+        uint8_t done_code;
+        switch (goal->command_code)
+        {
+            case tfr_msgs::BinGoal::RAISE_BIN:
+                angle = tfr_utilities::JointAngle::BIN_MAX;
+                done_code = tfr_msgs::BinResult::BIN_RAISED;
+                break;
+            case tfr_msgs::BinGoal::LOWER_BIN:
+                angle = tfr_utilities::JointAngle::BIN_MIN;
+                done_code = tfr_msgs::BinResult::BIN_LOWERED;
+                break;
+            default:
+                ROS_WARN("Bin Control Server: unrecognized command %d", goal->command_code);
+                result.return_code = tfr_msgs::BinResult::ERROR_ENCOUNTERED;
+                server.setAborted(result);
+                return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(signal_mutex);
+            bin_task_completed = false;
+            preempted = server.isPreemptRequested();
+        }
+        //set before the target, the control loop reads it after
+        goal_tolerance = goal->tolerance > 0 ? goal->tolerance : settings.tolerance;
+        target = angle;
+        std_msgs::Float64 command;
+        command.data = angle;
+        bin_command_publisher.publish(command);
+
+        bool reached = wait_for_bin();
+        target = std::nan("");
+        if (reached)
+        {
+            result.return_code = done_code;
+            server.setSucceeded(result);
+            return;
+        }
+
+        //stop where it is rather than carry on to a target nobody wants
+        command.data = last_position;
+        bin_command_publisher.publish(command);
+        result.return_code = tfr_msgs::BinResult::ERROR_ENCOUNTERED;
+        std::lock_guard<std::mutex> lock(signal_mutex);
+        if (preempted)
+        {
+            ROS_INFO("Bin Control Server: preempted");
+            server.setPreempted(result);
+        }
+        else
+        {
+            ROS_WARN("Bin Control Server: bin didn't reach %f, at %f",
+                    angle, static_cast<double>(last_position));
+            server.setAborted(result);
+        }
+    }
+
+    void BinControlServer::Preempt()
+    {
+        {
+            std::lock_guard<std::mutex> lock(signal_mutex);
+            preempted = true;
+        }
+        signal.notify_all();
+    }
+
+    bool BinControlServer::wait_for_bin()
+    {
+        auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration<double>(settings.timeout);
+        std::unique_lock<std::mutex> lock(signal_mutex);
+        signal.wait_until(lock, deadline,
+                [this]{ return bin_task_completed || preempted || shutting_down; });
+        return bin_task_completed;
+    }
+}
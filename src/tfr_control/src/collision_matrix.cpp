@@ -0,0 +1,201 @@
+/****************************************************************************************
+ * File:            collision_matrix.cpp
+ *
+ * Purpose:         Regenerates the allowed collision matrix in the SRDF, the
+ *                  list of link pairs MoveIt never checks against each other,
+ *                  and measures what a self collision check costs with it.
+ *
+ *                  Every collision check while planning the arm tests every
+ *                  pair of links that isn't disabled, so pairs that can't ever
+ *                  touch are pure cost. Like the setup assistant, it disables
+ *                  pairs that are adjacent in the tree, touching in the default
+ *                  pose, touching in nearly every random pose, or never touching
+ *                  in any of them. Then it times checks with the matrix
+ *                  currently loaded and with the new one.
+ *
+ *                  It writes the semantic description back out with the new
+ *                  matrix in place of the old. Rerun it whenever the collision
+ *                  geometry changes, with launch/collision_matrix.launch, with
+ *                  and without simple_collision to compare the two models.
+ *
+ * Parameters:      ~samples - random poses to try (int, 10000)
+ *                  ~always - fraction of poses a pair has to touch in to be
+ *                      disabled as always touching (double, 0.95)
+ *                  ~output - file for the new SRDF, stdout if empty (string, "")
+ ***************************************************************************************/
+#include <ros/ros.h>
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace
+{
+    using Pair = std::pair<std::string, std::string>;
+
+    Pair ordered(const std::string &a, const std::string &b)
+    {
+        return a < b ? Pair{a, b} : Pair{b, a};
+    }
+
+    /*
+     * Checks the state against every pair in acm that isn't allowed, and
+     * returns how long it took in microseconds
+     * */
+    double timeCheck(const planning_scene::PlanningScene &scene,
+            const collision_detection::CollisionRequest &request,
+            collision_detection::CollisionResult &result, robot_state::RobotState &state,
+            const collision_detection::AllowedCollisionMatrix &acm)
+    {
+        state.update();
+        result.clear();
+        auto start = std::chrono::steady_clock::now();
+        scene.checkSelfCollision(request, result, state, acm);
+        return std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count();
+    }
+
+    /*
+     * The description with its disable_collisions replaced
+     * */
+    std::string replaceMatrix(const std::string &srdf, const std::map<Pair, std::string> &disabled)
+    {
+        std::istringstream in(srdf);
+        std::ostringstream out;
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (line.find("<disable_collisions") != std::string::npos)
+                continue;
+            if (line.find("</robot>") != std::string::npos)
+            {
+                for (const auto &entry : disabled)
+                {
+                    out << "    <disable_collisions link1=\"" << entry.first.first
+                        << "\" link2=\"" << entry.first.second
+                        << "\" reason=\"" << entry.second << "\" />\n";
+                }
+            }
+            out << line << "\n";
+        }
+        return out.str();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "collision_matrix");
+    ros::NodeHandle n;
+
+    int samples;
+    double always;
+    std::string output, srdf;
+    ros::param::param<int>("~samples", samples, 10000);
+    ros::param::param<double>("~always", always, 0.95);
+    ros::param::param<std::string>("~output", output, "");
+    if (samples <= 0 || !ros::param::get("robot_description_semantic", srdf))
+    {
+        ROS_ERROR("Collision Matrix: needs positive samples and the semantic description");
+        return 1;
+    }
+
+    robot_model_loader::RobotModelLoader model_loader("robot_description", false);
+    robot_model::RobotModelConstPtr model = model_loader.getModel();
+    if (!model)
+    {
+        ROS_ERROR("Collision Matrix: couldn't load the robot description");
+        return 1;
+    }
+    //holds the matrix in the srdf we loaded
+    planning_scene::PlanningScene scene(model);
+    robot_state::RobotState state(model);
+
+    std::map<Pair, std::string> disabled;
+    //adjacent through any links that have nothing to collide
+    for (const auto *link : model->getLinkModelsWithCollisionGeometry())
+    {
+        const robot_model::LinkModel *parent = link->getParentLinkModel();
+        while (parent != nullptr && parent->getShapes().empty())
+            parent = parent->getParentLinkModel();
+        if (parent != nullptr)
+            disabled.emplace(ordered(link->getName(), parent->getName()), "Adjacent");
+    }
+
+    //an empty matrix allows nothing, so checks every pair
+    collision_detection::AllowedCollisionMatrix none;
+    collision_detection::CollisionRequest request;
+    collision_detection::CollisionResult result;
+    request.contacts = true;
+    request.max_contacts = model->getLinkModelsWithCollisionGeometry().size() *
+        model->getLinkModelsWithCollisionGeometry().size();
+    request.max_contacts_per_pair = 1;
+
+    state.setToDefaultValues();
+    timeCheck(scene, request, result, state, none);
+    for (const auto &contact : result.contacts)
+        disabled.emplace(ordered(contact.first.first, contact.first.second), "Default");
+
+    std::map<Pair, int> touching;
+    double unfiltered = 0;
+    for (int i = 0; i < samples && ros::ok(); i++)
+    {
+        state.setToRandomPositions();
+        unfiltered += timeCheck(scene, request, result, state, none);
+        for (const auto &contact : result.contacts)
+            touching[ordered(contact.first.first, contact.first.second)]++;
+    }
+
+    const auto &links = model->getLinkModelNamesWithCollisionGeometry();
+    for (size_t i = 0; i < links.size(); i++)
+    {
+        for (size_t j = i + 1; j < links.size(); j++)
+        {
+            Pair pair = ordered(links[i], links[j]);
+            int count = touching.count(pair) ? touching[pair] : 0;
+            if (count == 0)
+                disabled.emplace(pair, "Never");
+            else if (count >= always * samples)
+                disabled.emplace(pair, "Always");
+        }
+    }
+
+    //now what planning would pay, with the old matrix and the new one
+    collision_detection::AllowedCollisionMatrix generated;
+    for (const auto &entry : disabled)
+        generated.setEntry(entry.first.first, entry.first.second, true);
+    collision_detection::CollisionRequest check;
+    double loaded = 0, replaced = 0;
+    for (int i = 0; i < samples && ros::ok(); i++)
+    {
+        state.setToRandomPositions();
+        loaded += timeCheck(scene, check, result, state, scene.getAllowedCollisionMatrix());
+        replaced += timeCheck(scene, check, result, state, generated);
+    }
+
+    size_t pairs = links.size() * (links.size() - 1) / 2;
+    ROS_INFO("Collision Matrix: %zu links with geometry, disabled %zu of %zu pairs",
+            links.size(), disabled.size(), pairs);
+    ROS_INFO("Collision Matrix: self check %.1f us with every pair, %.1f us with the loaded matrix, %.1f us with the new one",
+            unfiltered / samples, loaded / samples, replaced / samples);
+
+    std::string updated = replaceMatrix(srdf, disabled);
+    if (output.empty())
+        std::cout << updated;
+    else
+    {
+        std::ofstream file(output);
+        file << updated;
+        if (!file)
+        {
+            ROS_ERROR("Collision Matrix: couldn't write %s", output.c_str());
+            return 1;
+        }
+        ROS_INFO("Collision Matrix: wrote %s", output.c_str());
+    }
+    return 0;
+}
@@ -8,13 +8,154 @@
  * control loop for the control package.
  *
  * PARAMETERS:
- *  ~rate: in hz how fast we want to run the control loop (double, default:10)
+ *  ~rate: in hz how fast we want to run the control loop (double, default:30)
+ *  ~realtime: run the control loop on a dedicated thread paced by absolute
+ *  deadlines, with all callbacks on a separate spinner (bool, default: false)
+ *  ~spinner_threads: callback threads used in realtime mode (int, default: 2)
+ *  ~priority: SCHED_FIFO priority of the control thread, 0 to leave the
+ *  default scheduler (int, default: 0)
+ *  ~cpu: cpu to pin the control thread to, -1 for none (int, default: -1)
+ *  ~lock_memory: mlockall the process in realtime mode (bool, default: true)
+ *  ~deadline_tolerance: fraction of the period a cycle may start late before
+ *  it counts as a deadline miss (double, default: 0.2)
+ *  ~diagnostics_period: seconds between loop timing summaries (double,
+ *  default: 1.0)
+ *  ~stale_timeout: seconds without a new arduino reading before that stream
+ *  is treated as stale (double, default: 0.25)
+ *  ~velocity_bandwidth: bandwidth in hz of the arm and bin velocity
+ *  estimators, higher is less lag and more noise (double, default: 5.0)
+ *  ~drivebase_max_vel: tread speed in m/s at full pwm (double, default: 0.5)
+ *  ~drivebase_min_pwm: pwm that just overcomes tread friction (double,
+ *  default: 0.2)
+ *  ~drivebase_deadband: tread commands slower than this in m/s stop the
+ *  treads (double, default: 0.01)
+ *  ~drivebase_max_accel: limit on tread acceleration in m/s^2, the shafts
+ *  snap above 1 (double, default: 1.0)
+ *  ~drivebase_max_jerk: limit on tread jerk in m/s^3 (double, default: 5.0)
+ *  ~bin_average_kp, ~bin_average_ki: gains of the loop moving the bin
+ *  actuators together to the target (double, default: 8.0, 1.0)
+ *  ~bin_differential_kp, ~bin_differential_ki: gains of the loop keeping the
+ *  bin actuators in line with each other (double, default: 10.0, 2.0)
+ *  ~bin_ramp_distance: distance in rad from the target where the bin starts
+ *  slowing down (double, default: 0.1)
+ *  ~bin_min_pwm: slowest pwm that moves the bin actuators (double,
+ *  default: 0.2)
+ *  ~bin_tolerance: error in rad the bin settles within (double,
+ *  default: 0.005)
+ *  ~current_budget: amps all the motors together may draw (double,
+ *  default: 60.0)
+ *  ~tread_current, ~turntable_current, ~arm_current, ~scoop_current,
+ *  ~bin_current: amps each motor draws at full pwm (double, default: 20.0,
+ *  5.0, 10.0, 5.0, 8.0)
+ *  ~tread_priority, ~arm_priority, ~bin_priority: order motors are given
+ *  current in when the budget runs short, lowest first (int, default: 0,
+ *  1, 2)
+ *  ~arm_min_pwm: slowest pwm that moves the arm joints, the budget cuts them
+ *  to zero rather than scale them under it, as it does the treads and bin
+ *  with drivebase_min_pwm and bin_min_pwm (double, default: 0.15)
+ *  ~feedforward/<joint>/pwm, ~feedforward/<joint>/velocity: measured pwm
+ *  curve of each arm joint, written by calibration (double[], default: none)
+ *  ~feedforward_gain: speed in rad/s a calibrated joint moves at per rad of
+ *  error (double, default: 2.0)
+ *  ~feedforward_tolerance: error in rad a calibrated joint stops within
+ *  (double, default: 0.01)
+ *  ~calibrate: sweep the arm actuators and save their pwm curves instead of
+ *  running the controllers, the motors must be enabled (bool, default: false)
+ *  ~calibration_file: where calibration saves the curves, loaded over
+ *  ~feedforward at startup once it exists (string, default: feedforward.yaml)
+ *  ~calibration_steps: pwm levels swept in each direction (int, default: 8)
+ *  ~calibration_max_pwm: highest pwm swept (double, default: 0.8)
+ *  ~calibration_settle_time, ~calibration_measure_time: seconds each level
+ *  gets to come up to speed, then is measured for (double, default: 0.3, 0.5)
+ *  ~calibration_max_travel: furthest in rad a single level may move a joint
+ *  (double, default: 0.3)
+ *  ~calibration_limits_file: where calibration saves the measured velocity
+ *  and acceleration limits of the arm joints, in the format of MoveIt's
+ *  joint_limits.yaml, to load over tfr_moveit's. The file is overwritten,
+ *  empty for nowhere (string, default: "")
+ *  ~autotune_joint: joint to run a relay autotune on instead of running the
+ *  controllers, any tread or arm joint, the motors must be enabled (string,
+ *  default: "" for none)
+ *  ~autotune_file: where the autotune writes the plant model, suggested
+ *  gains, and step response, merged with the results for the other joints
+ *  already in it, and loaded over ~autotune at startup once it exists
+ *  (string, default: autotune.yaml)
+ *  ~autotune/<joint>/pid/p, i, d: gains from the autotune file for an arm
+ *  joint's position loop, in pwm per rad, used in place of its feedforward
+ *  table. The treads' gains are loaded by the skid_steer_controller
+ *  (double, default: none)
+ *  ~autotune_amplitude, ~autotune_bias: the relay drives bias +/- amplitude,
+ *  pwm for arm joints and m/s for treads (double, default: 0.4 and 0 for
+ *  arm joints, 0.1 and 0.2 for treads)
+ *  ~autotune_hysteresis: error the relay ignores (double, default: 0.01)
+ *  ~autotune_setpoint: relay setpoint, an offset in rad from where an arm
+ *  joint starts or a tread velocity in m/s (double, default: 0, 0.2)
+ *  ~autotune_cycles: oscillations measured (int, default: 4)
+ *  ~autotune_step_size, ~autotune_step_time: step used to check the gains
+ *  and seconds it's watched for (double, default: 0.1, 5.0)
+ *  ~autotune_max_excursion: furthest the joint may stray from the setpoint
+ *  before the autotune gives up (double, default: 0.3)
+ *  ~backend: what the hardware layer talks to, "arduino" for the robot,
+ *  "model" for a first order model of the motors, or "playback" to replay
+ *  recorded readings (string, default: arduino)
+ *  ~model_time_constant: seconds for a modeled motor to respond to a pwm
+ *  change (double, default: 0.1)
+ *  ~model_turntable_speed, ~model_arm_speed, ~model_bin_speed: modeled
+ *  joint speeds in rad/s at full pwm (double, default: 0.5, 0.3, 0.1)
+ *  ~model_tread_speed: modeled tread speed in m/s at full pwm (double,
+ *  default: 0.5)
+ *  ~model_bin_skew: fraction slower the right bin actuator runs in the model
+ *  (double, default: 0.05)
+ *  ~model_deadband: pwm below which modeled motors stall (double,
+ *  default: 0.15)
+ *  ~model_reading_rate: how often in hz the modeled arduinos report (double,
+ *  default: 30.0)
+ *  ~playback_bag: bag of /sensors/arduino_a and /sensors/arduino_b to replay
+ *  (string, default: "")
+ *  ~playback_loop: start the bag over when it runs out (bool, default: true)
+ *  ~bin_goal_tolerance: how close in rad the bin action gets the bin to its
+ *  target, for goals that don't give their own (double, default: 0.01)
+ *  ~bin_goal_timeout: seconds a bin action goal may take before it's aborted
+ *  (double, default: 30.0)
+ *  ~kalman_filter: filter the potentiometers with what we drive their joints
+ *  with, instead of smoothing them like the firmware used to (bool,
+ *  default: true)
+ *  ~kalman_arm_speed, ~kalman_bin_speed: joint speeds in rad/s at full pwm
+ *  the filters expect (double, default: 0.3, 0.1)
+ *  ~kalman_time_constant: seconds for a joint to respond to a pwm change
+ *  (double, default: 0.1)
+ *  ~kalman_process_noise: how hard in rad^2/s^3 the joints get pushed around
+ *  by things we don't model, higher follows the readings closer (double,
+ *  default: 1.0)
+ *  ~kalman_measurement_noise: variance in rad^2 of a potentiometer reading
+ *  (double, default: 1e-4)
+ * PUBLISHED TOPICS:
+ *  /diagnostics - p50/p99/max of each loop phase, overrun and deadline miss
+ *  counts, the age and drop counts of each sensor stream, the estimated
+ *  motor current draw, and the innovations of the potentiometer filters
+ *  (diagnostic_msgs/DiagnosticArray)
+ *  /arm_bin_state - latched, every cycle, the position of the bin and the
+ *  arm as read this cycle, read it with tfr_utilities/arm_bin_state_cache.h
+ *  instead of polling the services (tfr_msgs/ArmBinState)
+ *  /drivebase_odom - tread odometry from the skid steer controller, which
+ *  also arbitrates the cmd_vel/* sources and serves /set_drivebase_odometry
+ *  and /reset_drivebase_odometry (nav_msgs/Odometry)
+ *  /cmd_vel_owner - latched, the velocity source that owns the treads
+ *  (std_msgs/String)
+ * ACTIONS:
+ *  /bin - raises or lowers the bin, completes the cycle it gets there
+ *  (tfr_msgs/Bin)
  * SERVICES:
  *  /toggle_control - uses the empty service, needs to be explicitly turned on to work
  *  /toggle_motors - uses the empty service, needs to be explicitly turned on to work
  *  /bin_state - gives the position of the bin
  *  /arm_state - gives the 4d position of the arm
  *  /zero_turntable - zeros the position of the turntable
+ *  /control_loop_samples - dumps the most recent raw loop timings
+ *  /toggle_arm_jog - true swaps the arm trajectory controllers for the
+ *  jog controller, which follows /arm_jog velocities, false swaps back.
+ *  Anything that sends the arm a trajectory asks for false first, it's
+ *  answered right away if that's already the mode
  */
 #include <ros/ros.h>
 #include <std_srvs/SetBool.h>
@@ -22,105 +163,403 @@
 #include <tfr_msgs/QuerySrv.h>
 #include <tfr_msgs/BinStateSrv.h>
 #include <tfr_msgs/ArmStateSrv.h>
+#include <tfr_msgs/LoopSamplesSrv.h>
+#include <tfr_msgs/ArmBinState.h>
+#include <realtime_tools/realtime_publisher.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <urdf/model.h>
 #include <sstream>
+#include <atomic>
+#include <chrono>
 #include <controller_manager/controller_manager.h>
+#include <memory>
+#include <algorithm>
+#include <rosbag/exceptions.h>
 #include "robot_interface.h"
+#include "arduino_backend.h"
+#include "plant_backend.h"
+#include "playback_backend.h"
+#include "actuator_calibration.h"
+#include "relay_autotuner.h"
+#include "realtime_loop.h"
+#include "loop_statistics.h"
 #include "bin_control_server.h"
+#include "param_overlay.h"
 
 
 
-namespace control_test
+/*
+ * The arm joints, and their names in the URDF and feedforward parameters
+ * */
+const std::vector<tfr_control::Joint> ARM_JOINTS{tfr_control::Joint::TURNTABLE,
+    tfr_control::Joint::LOWER_ARM, tfr_control::Joint::UPPER_ARM,
+    tfr_control::Joint::SCOOP};
+const std::vector<std::string> ARM_JOINT_NAMES{"turntable_joint",
+    "lower_arm_joint", "upper_arm_joint", "scoop_joint"};
+
+/*
+ * The potentiometers in tfr_control::Potentiometer order, for diagnostics
+ * */
+const std::vector<std::string> POTENTIOMETER_NAMES{"lower_arm", "upper_arm",
+    "scoop", "bin_left", "bin_right"};
+//mean normalized innovation squared a well tuned filter stays under
+const double MAX_NIS = 3.0;
+
+/*
+ * Feedforward tables saved by calibration, joints without one use the fixed
+ * mapping
+ * */
+void loadFeedforward(tfr_control::RobotInterface::Settings &settings)
 {
-    // ADAM'S TEST CODE
-    // Whether we're running on hardware or using fake values
-    const bool use_fake_values = false;
-    // If we're faking the inputs, we need to know the model constraints on
-    // the arm: load them here.
-    // If not, just use zeroes, the limits don't matter. TEST code
-    double lower_limits[tfr_control::RobotInterface::JOINT_COUNT] = {};
-    double upper_limits[tfr_control::RobotInterface::JOINT_COUNT] = {};
+    std::string file;
+    ros::param::param<std::string>("~calibration_file", file, "feedforward.yaml");
+    tfr_control::loadParamOverlay(file, "~feedforward");
+    ros::param::param<double>("~feedforward_gain", settings.feedforward_gain, 2.0);
+    ros::param::param<double>("~feedforward_tolerance",
+            settings.feedforward_tolerance, 0.01);
+    for (size_t i = 0; i < ARM_JOINTS.size(); i++)
+    {
+        std::vector<double> pwm, velocity;
+        ros::param::get("~feedforward/" + ARM_JOINT_NAMES[i] + "/pwm", pwm);
+        ros::param::get("~feedforward/" + ARM_JOINT_NAMES[i] + "/velocity", velocity);
+        tfr_control::FeedforwardTable table{pwm, velocity};
+        if (!table.isCalibrated())
+            ROS_INFO("Control: %s is not calibrated", ARM_JOINT_NAMES[i].c_str());
+        settings.feedforward[static_cast<int>(ARM_JOINTS[i])] = table;
+    }
 }
 
-using namespace control_test;
+/*
+ * Position loop gains saved by the autotune, joints without them keep their
+ * feedforward table or the fixed mapping
+ * */
+void loadPositionGains(tfr_control::RobotInterface::Settings &settings)
+{
+    std::string file;
+    ros::param::param<std::string>("~autotune_file", file, "autotune.yaml");
+    tfr_control::loadParamOverlay(file, "~autotune");
+    ros::NodeHandle n{"~"};
+    for (size_t i = 0; i < ARM_JOINTS.size(); i++)
+    {
+        tfr_control::TunedPid::Gains &gains =
+            settings.position_gains[static_cast<int>(ARM_JOINTS[i])];
+        if (tfr_control::TunedPid::load(n, ARM_JOINT_NAMES[i], gains))
+            ROS_INFO("Control: %s runs on autotuned gains p %f i %f d %f",
+                    ARM_JOINT_NAMES[i].c_str(), gains.p, gains.i, gains.d);
+    }
+}
 
-//test code
-void initializeTestCode(ros::NodeHandle& n)
+/*
+ * Builds the calibration sweep or autotune asked for by ~calibrate or
+ * ~autotune_joint, null to run the controllers as usual. file is where
+ * the results go.
+ * */
+std::unique_ptr<tfr_control::HardwareExperiment> makeExperiment(std::string &file)
 {
-    // Get the model description 
-    std::string desc;
-    n.param<std::string>("robot_description", desc, "");
+    using tfr_control::Joint;
+    bool calibrate;
+    std::string autotune_joint;
+    ros::param::param<bool>("~calibrate", calibrate, false);
+    ros::param::param<std::string>("~autotune_joint", autotune_joint, "");
 
-    if (desc.length() == 0) 
+    if (calibrate)
     {
-        ROS_WARN("robot_description is empty and controller_launcher is using fake values, quitting.");
+        ros::param::param<std::string>("~calibration_file", file, "feedforward.yaml");
+        tfr_control::ActuatorCalibration::Settings settings{};
+        ros::param::param<int>("~calibration_steps", settings.steps, 8);
+        ros::param::param<double>("~calibration_max_pwm", settings.max_pwm, 0.8);
+        ros::param::param<double>("~calibration_settle_time", settings.settle_time, 0.3);
+        ros::param::param<double>("~calibration_measure_time", settings.measure_time, 0.5);
+        ros::param::param<double>("~calibration_max_travel", settings.max_travel, 0.3);
+        ros::param::param<std::string>("~calibration_limits_file", settings.limits_file, "");
+        return std::unique_ptr<tfr_control::HardwareExperiment>{
+            new tfr_control::ActuatorCalibration{settings, ARM_JOINTS, ARM_JOINT_NAMES}};
     }
 
-    urdf::Model model;
-    if (!model.initString(desc)) 
+    if (!autotune_joint.empty())
     {
-        ROS_WARN("Couldn't load robot_description.");
+        //treads are velocity driven, the arm joints position driven
+        Joint joint;
+        bool integrating = true;
+        if (autotune_joint == "left_tread_joint")
+        {
+            joint = Joint::LEFT_TREAD;
+            integrating = false;
+        }
+        else if (autotune_joint == "right_tread_joint")
+        {
+            joint = Joint::RIGHT_TREAD;
+            integrating = false;
+        }
+        else
+        {
+            auto found = std::find(ARM_JOINT_NAMES.begin(), ARM_JOINT_NAMES.end(),
+                    autotune_joint);
+            if (found == ARM_JOINT_NAMES.end())
+            {
+                ROS_ERROR("Control: can't autotune %s", autotune_joint.c_str());
+                return nullptr;
+            }
+            joint = ARM_JOINTS[found - ARM_JOINT_NAMES.begin()];
+        }
+
+        ros::param::param<std::string>("~autotune_file", file, "autotune.yaml");
+        tfr_control::RelayAutotuner::Settings settings{};
+        ros::param::param<double>("~autotune_amplitude", settings.amplitude,
+                integrating ? 0.4 : 0.1);
+        ros::param::param<double>("~autotune_bias", settings.bias,
+                integrating ? 0.0 : 0.2);
+        ros::param::param<double>("~autotune_hysteresis", settings.hysteresis, 0.01);
+        ros::param::param<double>("~autotune_setpoint", settings.setpoint,
+                integrating ? 0.0 : 0.2);
+        ros::param::param<int>("~autotune_cycles", settings.cycles, 4);
+        ros::param::param<double>("~autotune_step_size", settings.step_size, 0.1);
+        ros::param::param<double>("~autotune_step_time", settings.step_time, 5.0);
+        ros::param::param<double>("~autotune_max_excursion", settings.max_excursion, 0.3);
+        return std::unique_ptr<tfr_control::HardwareExperiment>{
+            new tfr_control::RelayAutotuner{settings, joint, autotune_joint, integrating}};
     }
+    return nullptr;
+}
 
-    ROS_INFO("Model loaded successfully, loading joint limits.");
-    lower_limits[static_cast<int>(tfr_control::Joint::BIN)] 
-        = model.getJoint("bin_joint")->limits->lower;
-    upper_limits[static_cast<int>(tfr_control::Joint::BIN)] 
-        = model.getJoint("bin_joint")->limits->upper;
-    lower_limits[static_cast<int>(tfr_control::Joint::LOWER_ARM)] 
-        = model.getJoint("lower_arm_joint")->limits->lower;
-    upper_limits[static_cast<int>(tfr_control::Joint::LOWER_ARM)] 
-        = model.getJoint("lower_arm_joint")->limits->upper;
-    lower_limits[static_cast<int>(tfr_control::Joint::UPPER_ARM)] 
-        = model.getJoint("upper_arm_joint")->limits->lower;
-    upper_limits[static_cast<int>(tfr_control::Joint::UPPER_ARM)] 
-        = model.getJoint("upper_arm_joint")->limits->upper;
-    lower_limits[static_cast<int>(tfr_control::Joint::SCOOP)] 
-        = model.getJoint("scoop_joint")->limits->lower;
-    upper_limits[static_cast<int>(tfr_control::Joint::SCOOP)] 
-        = model.getJoint("scoop_joint")->limits->upper;
+/*
+ * Current draw of each motor and the order they get current in, motors on the
+ * same joint share a parameter
+ * */
+void loadPowerSettings(tfr_control::CurrentBudget::Settings &power)
+{
+    using tfr_control::CurrentBudget;
+    double tread, turntable, arm, scoop, bin;
+    double tread_min_pwm, arm_min_pwm, bin_min_pwm;
+    int tread_priority, arm_priority, bin_priority;
+    ros::param::param<double>("~current_budget", power.budget, 60.0);
+    ros::param::param<double>("~tread_current", tread, 20.0);
+    ros::param::param<double>("~turntable_current", turntable, 5.0);
+    ros::param::param<double>("~arm_current", arm, 10.0);
+    ros::param::param<double>("~scoop_current", scoop, 5.0);
+    ros::param::param<double>("~bin_current", bin, 8.0);
+    ros::param::param<int>("~tread_priority", tread_priority, 0);
+    ros::param::param<int>("~arm_priority", arm_priority, 1);
+    ros::param::param<int>("~bin_priority", bin_priority, 2);
+    ros::param::param<double>("~drivebase_min_pwm", tread_min_pwm, 0.2);
+    ros::param::param<double>("~arm_min_pwm", arm_min_pwm, 0.15);
+    ros::param::param<double>("~bin_min_pwm", bin_min_pwm, 0.2);
+
+    power.stall_current[CurrentBudget::TREAD_LEFT] = tread;
+    power.stall_current[CurrentBudget::TREAD_RIGHT] = tread;
+    power.stall_current[CurrentBudget::TURNTABLE] = turntable;
+    power.stall_current[CurrentBudget::ARM_LOWER] = arm;
+    power.stall_current[CurrentBudget::ARM_UPPER] = arm;
+    power.stall_current[CurrentBudget::ARM_SCOOP] = scoop;
+    power.stall_current[CurrentBudget::BIN_LEFT] = bin;
+    power.stall_current[CurrentBudget::BIN_RIGHT] = bin;
+
+    power.priority[CurrentBudget::TREAD_LEFT] = tread_priority;
+    power.priority[CurrentBudget::TREAD_RIGHT] = tread_priority;
+    power.priority[CurrentBudget::TURNTABLE] = arm_priority;
+    power.priority[CurrentBudget::ARM_LOWER] = arm_priority;
+    power.priority[CurrentBudget::ARM_UPPER] = arm_priority;
+    power.priority[CurrentBudget::ARM_SCOOP] = arm_priority;
+    power.priority[CurrentBudget::BIN_LEFT] = bin_priority;
+    power.priority[CurrentBudget::BIN_RIGHT] = bin_priority;
+
+    power.min_pwm[CurrentBudget::TREAD_LEFT] = tread_min_pwm;
+    power.min_pwm[CurrentBudget::TREAD_RIGHT] = tread_min_pwm;
+    power.min_pwm[CurrentBudget::TURNTABLE] = arm_min_pwm;
+    power.min_pwm[CurrentBudget::ARM_LOWER] = arm_min_pwm;
+    power.min_pwm[CurrentBudget::ARM_UPPER] = arm_min_pwm;
+    power.min_pwm[CurrentBudget::ARM_SCOOP] = arm_min_pwm;
+    power.min_pwm[CurrentBudget::BIN_LEFT] = bin_min_pwm;
+    power.min_pwm[CurrentBudget::BIN_RIGHT] = bin_min_pwm;
+}
+
+/*
+ * Travel of a joint from the robot description, unlimited if it's missing
+ * */
+tfr_control::PlantBackend::Range loadRange(const urdf::Model &model,
+        const std::string &name)
+{
+    auto joint = model.getJoint(name);
+    if (joint == nullptr || joint->limits == nullptr)
+    {
+        ROS_WARN("Control: no limits for %s in robot_description", name.c_str());
+        return tfr_control::PlantBackend::Range{0, 0};
+    }
+    return tfr_control::PlantBackend::Range{joint->limits->lower, joint->limits->upper};
+}
+
+/*
+ * Builds the hardware backend named by ~backend, null if there is no such
+ * backend or it couldn't be set up
+ * */
+std::unique_ptr<tfr_control::HardwareBackend> makeBackend(ros::NodeHandle &n)
+{
+    std::string backend;
+    ros::param::param<std::string>("~backend", backend, "arduino");
+
+    if (backend == "arduino")
+        return std::unique_ptr<tfr_control::HardwareBackend>{
+            new tfr_control::ArduinoBackend{n}};
+
+    if (backend == "model")
+    {
+        tfr_control::PlantBackend::Settings settings{};
+        ros::param::param<double>("~model_time_constant", settings.time_constant, 0.1);
+        ros::param::param<double>("~model_turntable_speed", settings.turntable_speed, 0.5);
+        ros::param::param<double>("~model_arm_speed", settings.arm_speed, 0.3);
+        ros::param::param<double>("~model_bin_speed", settings.bin_speed, 0.1);
+        ros::param::param<double>("~model_tread_speed", settings.tread_speed, 0.5);
+        ros::param::param<double>("~model_bin_skew", settings.bin_skew, 0.05);
+        ros::param::param<double>("~model_deadband", settings.deadband, 0.15);
+        ros::param::param<double>("~model_reading_rate", settings.reading_rate, 30.0);
+
+        // The model stops the joints at their limits from the URDF
+        std::string desc;
+        n.param<std::string>("robot_description", desc, "");
+        urdf::Model model;
+        if (!model.initString(desc))
+        {
+            ROS_ERROR("Control: couldn't load robot_description for the model backend");
+            return nullptr;
+        }
+        settings.turntable = loadRange(model, "turntable_joint");
+        settings.lower_arm = loadRange(model, "lower_arm_joint");
+        settings.upper_arm = loadRange(model, "upper_arm_joint");
+        settings.scoop = loadRange(model, "scoop_joint");
+        settings.bin = loadRange(model, "bin_joint");
+        return std::unique_ptr<tfr_control::HardwareBackend>{
+            new tfr_control::PlantBackend{settings}};
+    }
+
+    if (backend == "playback")
+    {
+        std::string bag;
+        bool loop;
+        ros::param::param<std::string>("~playback_bag", bag, "");
+        ros::param::param<bool>("~playback_loop", loop, true);
+        try
+        {
+            return std::unique_ptr<tfr_control::HardwareBackend>{
+                new tfr_control::PlaybackBackend{bag, loop}};
+        }
+        catch (rosbag::BagException &e)
+        {
+            ROS_ERROR("Control: couldn't open %s for playback: %s", bag.c_str(), e.what());
+            return nullptr;
+        }
+    }
+
+    ROS_ERROR("Control: unknown backend %s, expected arduino, model or playback",
+            backend.c_str());
+    return nullptr;
 }
-//END TEST CODE
 
 
 class Control
 {
     public:
-        Control(ros::NodeHandle &n, const double& rate):
-            robot_interface{n, use_fake_values, lower_limits, upper_limits},
+        Control(ros::NodeHandle &n,
+                std::unique_ptr<tfr_control::HardwareBackend> backend,
+                const double& rate,
+                const double& deadline_tolerance, const double& diagnostics_period,
+                const tfr_control::RobotInterface::Settings& settings,
+                const tfr_control::BinControlServer::Settings& bin_settings):
+            robot_interface{std::move(backend), settings},
             controller_interface{&robot_interface},
+            statistics{static_cast<uint64_t>(1e9/rate), deadline_tolerance},
             eStopControl{n.advertiseService("toggle_control", &Control::toggleControl,this)},
             eStopMotors{n.advertiseService("toggle_motors", &Control::toggleControl,this)},
             binService{n.advertiseService("bin_state", &Control::getBinState,this)},
             armService{n.advertiseService("arm_state", &Control::getArmState,this)},
             zeroService{n.advertiseService("zero_turntable", &Control::zeroTurntable,this)},
+            jogService{n.advertiseService("toggle_arm_jog", &Control::toggleArmJog,this)},
+            state_publisher{n, "/arm_bin_state", 1, true},
+            bin_server{n, bin_settings},
+            samplesService{n.advertiseService("control_loop_samples", &Control::getLoopSamples,this)},
+            diagnostics_publisher{n.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 5)},
+            diagnostics_timer{n.createTimer(ros::Duration(diagnostics_period),
+                    &Control::publishDiagnostics, this)},
             cycle{1/rate},
-            enabled{false}
+            enabled{false},
+            last_start{},
+            reported_overruns{0},
+            reported_misses{0},
+            reported_limited{0}
         {}
         
         /*
-         * performs one iteration of the control loop
+         * performs one iteration of the control loop and sleeps off the rest
+         * of the cycle
          * */
         void execute()
         {
+            update(cycle);
+            cycle.sleep();
+        }
+
+        /*
+         * performs one iteration of the control loop, period is the time
+         * elapsed since the last iteration
+         * */
+        void update(const ros::Duration &period)
+        {
+            auto start = Clock::now();
             //update from hardware
             robot_interface.read();
+            bin_server.SignalBinController(robot_interface.getBinState());
+            auto read_done = Clock::now();
             //update controllers
-            controller_interface.update(ros::Time::now(), cycle);
+            if (experiment)
+                runExperiment();
+            else
+                controller_interface.update(ros::Time::now(), period);
             if (!enabled)
                 robot_interface.clearCommands();
+            auto update_done = Clock::now();
             //update hardware from controllers
             robot_interface.write();
-            cycle.sleep();
+            auto write_done = Clock::now();
+            publishState();
+
+            //the first cycle has nothing to measure against
+            uint64_t actual_period = (last_start == Clock::time_point{}) ?
+                statistics.getNominalPeriod() : nanoseconds(start - last_start);
+            last_start = start;
+            statistics.record(actual_period,
+                    nanoseconds(read_done - start),
+                    nanoseconds(update_done - read_done),
+                    nanoseconds(write_done - update_done));
+        }
+
+        /*
+         * Runs an experiment on the robot instead of the controllers, the
+         * results are saved to file when it's done. Call before the loop
+         * starts.
+         * */
+        void startExperiment(std::unique_ptr<tfr_control::HardwareExperiment> run,
+                const std::string &file)
+        {
+            experiment = std::move(run);
+            experiment_file = file;
         }
 
     private:
+        using Clock = std::chrono::steady_clock;
+
         //the hardware layer
         tfr_control::RobotInterface robot_interface;
 
         //the controller layer
         controller_manager::ControllerManager controller_interface;
 
+        //replaces the controllers when calibrating or autotuning
+        std::unique_ptr<tfr_control::HardwareExperiment> experiment;
+        std::string experiment_file;
+        bool experiment_done = false;
+
+        //timing of every cycle
+        tfr_control::LoopStatistics statistics;
+
         //emergency stop
         ros::ServiceServer eStopControl;
         ros::ServiceServer eStopMotors;
@@ -132,11 +571,238 @@ class Control
         //reset service
         ros::ServiceServer zeroService;
 
+        //switches between the arm trajectory and jog controllers
+        ros::ServiceServer jogService;
+
+        //state of the bin and arm every cycle
+        realtime_tools::RealtimePublisher<tfr_msgs::ArmBinState> state_publisher;
+
+        //raises and lowers the bin, woken by the control loop
+        tfr_control::BinControlServer bin_server;
+
+        //diagnostics
+        ros::ServiceServer samplesService;
+        ros::Publisher diagnostics_publisher;
+        ros::Timer diagnostics_timer;
+
         //how fast to spin
         ros::Duration cycle;
 
-        //if our motors are enabled
-        bool enabled;
+        //if our motors are enabled, toggled from the service thread
+        std::atomic<bool> enabled;
+
+        //start of the previous cycle, owned by the control thread
+        Clock::time_point last_start;
+
+        //counters at the last diagnostics report, owned by the timer
+        uint64_t reported_overruns;
+        uint64_t reported_misses;
+        uint64_t reported_limited;
+
+        /*
+         * Publishes the positions read this cycle, a cycle is skipped if the
+         * last one is still going out
+         * */
+        void publishState()
+        {
+            if (!state_publisher.trylock())
+                return;
+            tfr_msgs::ArmBinState &msg = state_publisher.msg_;
+            msg.header.stamp = ros::Time::now();
+            msg.bin = robot_interface.getBinState();
+            msg.arm.clear();
+            robot_interface.getArmState(msg.arm);
+            msg.stale = robot_interface.getArduinoAMonitor().isStale();
+            state_publisher.unlockAndPublish();
+        }
+
+        /*
+         * Everything the experiment isn't driving holds position, and it
+         * only runs while the motors are enabled
+         * */
+        void runExperiment()
+        {
+            robot_interface.clearCommands();
+            if (!enabled || experiment_done)
+                return;
+            if (!experiment->update(robot_interface, ros::Time::now().toSec()))
+                return;
+
+            experiment_done = true;
+            if (experiment->save(experiment_file))
+                ROS_INFO("Control: results saved to %s", experiment_file.c_str());
+            else
+                ROS_ERROR("Control: no results saved to %s", experiment_file.c_str());
+        }
+
+        static uint64_t nanoseconds(const Clock::duration &d)
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        }
+
+        /*
+         * Publishes a summary of loop timing since the last report
+         * */
+        void publishDiagnostics(const ros::TimerEvent &event)
+        {
+            using tfr_control::LoopStatistics;
+            static const char *names[LoopStatistics::PHASE_COUNT] =
+                {"period", "read", "update", "write", "cycle"};
+            LoopStatistics::Summary summaries[LoopStatistics::PHASE_COUNT];
+            statistics.summarize(summaries);
+            uint64_t overruns = statistics.getOverruns();
+            uint64_t misses = statistics.getDeadlineMisses();
+
+            diagnostic_msgs::DiagnosticStatus status;
+            status.name = "control: loop timing";
+            status.hardware_id = "control";
+            if (overruns > reported_overruns || misses > reported_misses)
+            {
+                status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+                status.message = "control loop missed deadlines";
+            }
+            else
+            {
+                status.level = diagnostic_msgs::DiagnosticStatus::OK;
+                status.message = "control loop on time";
+            }
+
+            for (int i = 0; i < LoopStatistics::PHASE_COUNT; i++)
+            {
+                std::string name{names[i]};
+                addValue(status, name + " p50 (ms)", summaries[i].p50 * 1e-6);
+                addValue(status, name + " p99 (ms)", summaries[i].p99 * 1e-6);
+                addValue(status, name + " max (ms)", summaries[i].max * 1e-6);
+            }
+            addValue(status, "cycles", summaries[0].samples);
+            addValue(status, "overruns", overruns - reported_overruns);
+            addValue(status, "deadline misses", misses - reported_misses);
+            addValue(status, "total overruns", overruns);
+            addValue(status, "total deadline misses", misses);
+            reported_overruns = overruns;
+            reported_misses = misses;
+
+            diagnostic_msgs::DiagnosticArray array;
+            array.header.stamp = ros::Time::now();
+            array.status.push_back(status);
+            array.status.push_back(streamStatus("control: arduino_a",
+                        robot_interface.getArduinoAMonitor()));
+            array.status.push_back(streamStatus("control: arduino_b",
+                        robot_interface.getArduinoBMonitor()));
+            array.status.push_back(budgetStatus());
+            array.status.push_back(filterStatus());
+            diagnostics_publisher.publish(array);
+        }
+
+        static diagnostic_msgs::DiagnosticStatus streamStatus(const std::string &name,
+                const tfr_utilities::StreamMonitor &monitor)
+        {
+            diagnostic_msgs::DiagnosticStatus status;
+            status.name = name;
+            status.hardware_id = "control";
+            if (monitor.isStale())
+            {
+                status.level = diagnostic_msgs::DiagnosticStatus::ERROR;
+                status.message = "stale";
+            }
+            else
+            {
+                status.level = diagnostic_msgs::DiagnosticStatus::OK;
+                status.message = "fresh";
+            }
+            addValue(status, "age (ms)", monitor.getAge() * 1e3);
+            addValue(status, "received", monitor.getReceived());
+            addValue(status, "dropped", monitor.getDropped());
+            addValue(status, "stale events", monitor.getStaleEvents());
+            return status;
+        }
+
+        /*
+         * Reports how often the motors asked for more current than we have
+         * since the last report
+         * */
+        diagnostic_msgs::DiagnosticStatus budgetStatus()
+        {
+            const tfr_control::CurrentBudget &budget = robot_interface.getCurrentBudget();
+            uint64_t limited = budget.getLimitedCycles();
+
+            diagnostic_msgs::DiagnosticStatus status;
+            status.name = "control: current budget";
+            status.hardware_id = "control";
+            status.level = diagnostic_msgs::DiagnosticStatus::OK;
+            status.message = (limited > reported_limited) ?
+                "motors scaled down to fit the budget" : "within budget";
+            addValue(status, "demand (A)", budget.getDemand());
+            addValue(status, "allocated (A)", budget.getAllocated());
+            addValue(status, "limited cycles", limited - reported_limited);
+            addValue(status, "total limited cycles", limited);
+            reported_limited = limited;
+            return status;
+        }
+
+        /*
+         * Reports how well the potentiometer filters predict each reading
+         * since the last report. A normalized innovation squared well away
+         * from 1 means the kalman noise parameters need tuning.
+         * */
+        diagnostic_msgs::DiagnosticStatus filterStatus()
+        {
+            diagnostic_msgs::DiagnosticStatus status;
+            status.name = "control: potentiometer filters";
+            status.hardware_id = "control";
+            status.level = diagnostic_msgs::DiagnosticStatus::OK;
+            status.message = "ok";
+            for (int i = 0; i < tfr_control::RobotInterface::POTENTIOMETER_COUNT; i++)
+            {
+                auto innovations = robot_interface.takeInnovations(
+                        static_cast<tfr_control::Potentiometer>(i));
+                const std::string &name = POTENTIOMETER_NAMES[i];
+                addValue(status, name + " readings", innovations.count);
+                addValue(status, name + " innovation mean (rad)", innovations.mean);
+                addValue(status, name + " innovation rms (rad)", innovations.rms);
+                addValue(status, name + " nis", innovations.nis);
+                if (innovations.count > 0 && innovations.nis > MAX_NIS)
+                {
+                    status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+                    status.message = "readings disagree with the motor model";
+                }
+            }
+            return status;
+        }
+
+        template <typename T>
+        static void addValue(diagnostic_msgs::DiagnosticStatus &status,
+                const std::string &key, const T &value)
+        {
+            diagnostic_msgs::KeyValue pair;
+            pair.key = key;
+            std::ostringstream stream;
+            stream << value;
+            pair.value = stream.str();
+            status.values.push_back(pair);
+        }
+
+        /*
+         * Dumps the most recent raw timing samples
+         * */
+        bool getLoopSamples(tfr_msgs::LoopSamplesSrv::Request& request,
+                tfr_msgs::LoopSamplesSrv::Response& response)
+        {
+            std::vector<tfr_control::LoopStatistics::Sample> samples;
+            statistics.recentSamples(samples);
+            response.nominal_period = statistics.getNominalPeriod() * 1e-9;
+            for (const auto &sample : samples)
+            {
+                response.period.push_back(sample.period * 1e-9);
+                response.read.push_back(sample.read * 1e-9);
+                response.update.push_back(sample.update * 1e-9);
+                response.write.push_back(sample.write * 1e-9);
+            }
+            response.cycles = statistics.getCycles();
+            response.overruns = statistics.getOverruns();
+            response.deadline_misses = statistics.getDeadlineMisses();
+            return true;
+        }
 
         /*
          * Toggles the emergency stop on and off
@@ -193,6 +859,49 @@ class Control
             return true;
         }
 
+        /*
+         * Swaps the arm trajectory controllers for the jog controller or
+         * back. Blocks until the control loop has made the switch, so it's
+         * refused while an experiment has the loop.
+         * */
+        bool toggleArmJog(std_srvs::SetBool::Request& request,
+                std_srvs::SetBool::Response& response)
+        {
+            const std::vector<std::string> jog{"arm_jog_controller"};
+            const std::vector<std::string> trajectory{"arm_controller", "arm_end_controller"};
+            if (experiment)
+            {
+                response.message = "the controllers aren't running";
+                return true;
+            }
+            for (const auto &name : {jog[0], trajectory[0], trajectory[1]})
+            {
+                if (controller_interface.getControllerByName(name) == nullptr)
+                {
+                    response.message = name + " isn't loaded";
+                    return true;
+                }
+            }
+            auto &start = request.data ? jog : trajectory;
+            auto &stop = request.data ? trajectory : jog;
+            //asked for every time the arm moves, don't wait on the loop
+            //if we're already there
+            bool there = true;
+            for (const auto &name : start)
+                there = there && controller_interface.getControllerByName(name)->isRunning();
+            for (const auto &name : stop)
+                there = there && !controller_interface.getControllerByName(name)->isRunning();
+            if (there)
+            {
+                response.success = true;
+                return true;
+            }
+            //best effort so a half switched mode still switches
+            response.success = controller_interface.switchController(start, stop,
+                    controller_manager_msgs::SwitchController::Request::BEST_EFFORT);
+            return true;
+        }
+
 
 };
 
@@ -203,17 +912,96 @@ int main(int argc, char **argv)
 
     double rate;
     ros::param::param<double>("~rate", rate, 30.0);
+    bool realtime;
+    ros::param::param<bool>("~realtime", realtime, false);
+    double deadline_tolerance, diagnostics_period;
+    ros::param::param<double>("~deadline_tolerance", deadline_tolerance, 0.2);
+    ros::param::param<double>("~diagnostics_period", diagnostics_period, 1.0);
+    tfr_control::RobotInterface::Settings interface_settings{};
+    ros::param::param<double>("~stale_timeout", interface_settings.stale_timeout, 0.25);
+    ros::param::param<double>("~velocity_bandwidth",
+            interface_settings.velocity_bandwidth, 5.0);
+    ros::param::param<double>("~drivebase_max_vel",
+            interface_settings.drivebase_max_vel, 0.5);
+    ros::param::param<double>("~drivebase_min_pwm",
+            interface_settings.drivebase_min_pwm, 0.2);
+    ros::param::param<double>("~drivebase_deadband",
+            interface_settings.drivebase_deadband, 0.01);
+    ros::param::param<double>("~drivebase_max_accel",
+            interface_settings.drivebase_max_accel, 1.0);
+    ros::param::param<double>("~drivebase_max_jerk",
+            interface_settings.drivebase_max_jerk, 5.0);
+    ros::param::param<double>("~bin_average_kp", interface_settings.bin.average_kp, 8.0);
+    ros::param::param<double>("~bin_average_ki", interface_settings.bin.average_ki, 1.0);
+    ros::param::param<double>("~bin_differential_kp",
+            interface_settings.bin.differential_kp, 10.0);
+    ros::param::param<double>("~bin_differential_ki",
+            interface_settings.bin.differential_ki, 2.0);
+    ros::param::param<double>("~bin_ramp_distance", interface_settings.bin.ramp_distance, 0.1);
+    ros::param::param<double>("~bin_min_pwm", interface_settings.bin.min_pwm, 0.2);
+    ros::param::param<double>("~bin_tolerance", interface_settings.bin.tolerance, 0.005);
+    ros::param::param<bool>("~kalman_filter", interface_settings.filter_potentiometers, true);
+    ros::param::param<double>("~kalman_arm_speed", interface_settings.arm_filter.input_gain, 0.3);
+    ros::param::param<double>("~kalman_bin_speed", interface_settings.bin_filter.input_gain, 0.1);
+    double time_constant, process_noise, measurement_noise;
+    ros::param::param<double>("~kalman_time_constant", time_constant, 0.1);
+    ros::param::param<double>("~kalman_process_noise", process_noise, 1.0);
+    ros::param::param<double>("~kalman_measurement_noise", measurement_noise, 1e-4);
+    for (auto filter : {&interface_settings.arm_filter, &interface_settings.bin_filter})
+    {
+        filter->time_constant = time_constant;
+        filter->process_noise = process_noise;
+        filter->measurement_noise = measurement_noise;
+    }
+    loadPowerSettings(interface_settings.power);
+    tfr_control::BinControlServer::Settings bin_settings{};
+    ros::param::param<double>("~bin_goal_tolerance", bin_settings.tolerance, 0.01);
+    ros::param::param<double>("~bin_goal_timeout", bin_settings.timeout, 30.0);
+    loadFeedforward(interface_settings);
+    loadPositionGains(interface_settings);
+
+    std::string experiment_file;
+    auto experiment = makeExperiment(experiment_file);
 
-    //test code
-    if (use_fake_values)
-        initializeTestCode(n);
+    auto backend = makeBackend(n);
+    if (backend == nullptr)
+        return 1;
+
+    if (realtime)
+    {
+        int spinner_threads;
+        ros::param::param<int>("~spinner_threads", spinner_threads, 2);
+        tfr_control::RealtimeLoop::Settings settings{};
+        ros::param::param<int>("~priority", settings.priority, 0);
+        ros::param::param<int>("~cpu", settings.cpu, -1);
+        ros::param::param<bool>("~lock_memory", settings.lock_memory, true);
+
+        // All callbacks are serviced here, the control thread never touches
+        // the callback queue
+        ros::AsyncSpinner spinner(spinner_threads);
+        spinner.start();
+
+        Control control{n, std::move(backend), rate, deadline_tolerance, diagnostics_period,
+            interface_settings, bin_settings};
+        if (experiment)
+            control.startExperiment(std::move(experiment), experiment_file);
+        tfr_control::RealtimeLoop loop{rate, settings,
+            [&control](const ros::Duration &period) { control.update(period); }};
+        loop.start();
+        ros::waitForShutdown();
+        loop.stop();
+        return 0;
+    }
 
     // Start a spinner for ros node in the background, seperate from this thread
     // that manages the control loop
     ros::AsyncSpinner spinner(1);
     spinner.start();
 
-    Control control{n, rate};
+    Control control{n, std::move(backend), rate, deadline_tolerance, diagnostics_period,
+        interface_settings, bin_settings};
+    if (experiment)
+        control.startExperiment(std::move(experiment), experiment_file);
 
     while (ros::ok())
     {
@@ -0,0 +1,157 @@
+/****************************************************************************************
+ * File:            current_budget.cpp
+ *
+ * Purpose:         This is the implementation file for the CurrentBudget class.
+ *                  See tfr_control/include/tfr_control/current_budget.h for details.
+ ***************************************************************************************/
+#include "current_budget.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace tfr_control
+{
+    CurrentBudget::CurrentBudget(const Settings &s) :
+        settings(s), demand{0}, allocated{0}, limited_cycles{0}
+    {}
+
+    void CurrentBudget::limit(tfr_msgs::PwmCommand &command)
+    {
+        double draw[MOTOR_COUNT];
+        double total = 0;
+        for (int i = 0; i < MOTOR_COUNT; i++)
+        {
+            draw[i] = settings.stall_current[i] *
+                std::min(std::abs(static_cast<double>(channel(command, i))), 1.0);
+            total += draw[i];
+        }
+        demand.store(total, std::memory_order_relaxed);
+
+        if (!command.enabled || total <= settings.budget)
+        {
+            allocated.store(command.enabled ? total : 0, std::memory_order_relaxed);
+            return;
+        }
+
+        //serve each priority group in turn out of what's left
+        double remaining = settings.budget;
+        int group = INT_MIN;
+        while (true)
+        {
+            int next = INT_MAX;
+            for (int i = 0; i < MOTOR_COUNT; i++)
+                if (settings.priority[i] > group)
+                    next = std::min(next, settings.priority[i]);
+            if (next == INT_MAX)
+                break;
+            group = next;
+
+            double wanted = 0;
+            for (int i = 0; i < MOTOR_COUNT; i++)
+                if (settings.priority[i] == group)
+                    wanted += draw[i];
+            if (wanted <= remaining)
+            {
+                remaining -= wanted;
+                continue;
+            }
+
+            //cut the slowest motor that would stall at the group's scale,
+            //along with its twin, which speeds up the rest, until none would
+            bool running[MOTOR_COUNT];
+            for (int i = 0; i < MOTOR_COUNT; i++)
+                running[i] = settings.priority[i] == group && draw[i] > 0;
+            double scale = 0;
+            double running_draw = 0;
+            while (true)
+            {
+                running_draw = 0;
+                for (int i = 0; i < MOTOR_COUNT; i++)
+                    if (running[i])
+                        running_draw += draw[i];
+                if (running_draw <= 0)
+                    break;
+                scale = std::min(std::max(remaining, 0.0) / running_draw, 1.0);
+
+                int slowest = -1;
+                for (int i = 0; i < MOTOR_COUNT; i++)
+                {
+                    double pwm = std::abs(static_cast<double>(channel(command, i)));
+                    if (running[i] && pwm * scale < settings.min_pwm[i] &&
+                            (slowest < 0 ||
+                             pwm < std::abs(static_cast<double>(channel(command, slowest)))))
+                        slowest = i;
+                }
+                if (slowest < 0)
+                    break;
+                running[slowest] = false;
+                int paired = twin(slowest);
+                if (paired >= 0 && settings.priority[paired] == group)
+                    running[paired] = false;
+            }
+
+            for (int i = 0; i < MOTOR_COUNT; i++)
+                if (settings.priority[i] == group)
+                    channel(command, i) *= running[i] ? scale : 0;
+            remaining = std::max(remaining - running_draw * scale, 0.0);
+        }
+
+        allocated.store(settings.budget - remaining, std::memory_order_relaxed);
+        limited_cycles.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    double CurrentBudget::getDemand() const
+    {
+        return demand.load(std::memory_order_relaxed);
+    }
+
+    double CurrentBudget::getAllocated() const
+    {
+        return allocated.load(std::memory_order_relaxed);
+    }
+
+    uint64_t CurrentBudget::getLimitedCycles() const
+    {
+        return limited_cycles.load(std::memory_order_relaxed);
+    }
+
+    float& CurrentBudget::channel(tfr_msgs::PwmCommand &command, int motor)
+    {
+        switch (motor)
+        {
+            case TREAD_LEFT:
+                return command.tread_left;
+            case TREAD_RIGHT:
+                return command.tread_right;
+            case TURNTABLE:
+                return command.arm_turntable;
+            case ARM_LOWER:
+                return command.arm_lower;
+            case ARM_UPPER:
+                return command.arm_upper;
+            case ARM_SCOOP:
+                return command.arm_scoop;
+            case BIN_LEFT:
+                return command.bin_left;
+            default:
+                return command.bin_right;
+        }
+    }
+
+    int CurrentBudget::twin(int motor)
+    {
+        switch (motor)
+        {
+            case TREAD_LEFT:
+                return TREAD_RIGHT;
+            case TREAD_RIGHT:
+                return TREAD_LEFT;
+            case BIN_LEFT:
+                return BIN_RIGHT;
+            case BIN_RIGHT:
+                return BIN_LEFT;
+            default:
+                return -1;
+        }
+    }
+}
@@ -0,0 +1,69 @@
+/****************************************************************************************
+ * File:            feedforward_table.cpp
+ *
+ * Purpose:         This is the implementation file for the FeedforwardTable class.
+ *                  See tfr_control/include/tfr_control/feedforward_table.h for details.
+ ***************************************************************************************/
+#include "feedforward_table.h"
+#include <algorithm>
+#include <cmath>
+
+namespace tfr_control
+{
+    constexpr double FeedforwardTable::STALL_VELOCITY;
+
+    FeedforwardTable::FeedforwardTable(const std::vector<double> &pwm,
+            const std::vector<double> &velocity)
+    {
+        size_t count = std::min(pwm.size(), velocity.size());
+        for (size_t i = 0; i < count; i++)
+        {
+            if (std::abs(velocity[i]) < STALL_VELOCITY)
+                continue;
+            Point point{std::abs(velocity[i]), pwm[i]};
+            if (velocity[i] > 0)
+                forward.push_back(point);
+            else
+                reverse.push_back(point);
+        }
+        auto slower = [](const Point &a, const Point &b) { return a.speed < b.speed; };
+        std::sort(forward.begin(), forward.end(), slower);
+        std::sort(reverse.begin(), reverse.end(), slower);
+    }
+
+    double FeedforwardTable::pwmFor(const double &velocity) const
+    {
+        if (velocity > 0)
+            return interpolate(forward, velocity);
+        if (velocity < 0)
+            return interpolate(reverse, -velocity);
+        return 0;
+    }
+
+    bool FeedforwardTable::isCalibrated() const
+    {
+        return !forward.empty() && !reverse.empty();
+    }
+
+    /*
+     * Linear between points, held at the ends
+     * */
+    double FeedforwardTable::interpolate(const std::vector<Point> &points,
+            const double &speed)
+    {
+        if (points.empty())
+            return 0;
+        if (speed <= points.front().speed)
+            return points.front().pwm;
+        for (size_t i = 1; i < points.size(); i++)
+        {
+            if (speed <= points[i].speed)
+            {
+                const Point &low = points[i - 1], &high = points[i];
+                double t = (speed - low.speed) / (high.speed - low.speed);
+                return low.pwm + t * (high.pwm - low.pwm);
+            }
+        }
+        return points.back().pwm;
+    }
+}
@@ -0,0 +1,143 @@
+/****************************************************************************************
+ * File:            ik_benchmark.cpp
+ *
+ * Purpose:         Compares MoveIt kinematics plugins on the arm, to check the
+ *                  closed form ArmKinematicsPlugin against the solver it
+ *                  replaced, or any other.
+ *
+ *                  Random reachable tip poses are made by setting the group to
+ *                  random joints, and each solver is asked for each of them
+ *                  from a different random seed. A solve only counts if the
+ *                  answer really puts the tip at the pose. It logs the mean and
+ *                  worst solve time and how many poses each solver got.
+ *
+ *                  Needs the robot description and semantic description
+ *                  loaded, run it with launch/ik_benchmark.launch.
+ *
+ * Parameters:      ~group - the group to solve for (string, "arm_end")
+ *                  ~solvers - the plugins to compare (string[], the KDL plugin
+ *                      MoveIt defaults to and tfr_control/ArmKinematicsPlugin)
+ *                  ~samples - how many poses to try (int, 10000)
+ *                  ~timeout - how long (s) a solver may search (double, 0.005)
+ *                  ~tolerance - how far (m) a solution may leave the tip from
+ *                      the pose (double, 0.0001)
+ ***************************************************************************************/
+#include <ros/ros.h>
+#include <moveit/kinematics_base/kinematics_base.h>
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/robot_state/robot_state.h>
+#include <pluginlib/class_loader.h>
+#include <eigen_conversions/eigen_msg.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Sample
+    {
+        geometry_msgs::Pose pose;
+        std::vector<double> seed;
+    };
+}
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "ik_benchmark");
+    ros::NodeHandle n;
+
+    std::string group_name;
+    std::vector<std::string> solvers;
+    int samples;
+    double timeout, tolerance;
+    ros::param::param<std::string>("~group", group_name, "arm_end");
+    ros::param::param<std::vector<std::string>>("~solvers", solvers,
+            {"kdl_kinematics_plugin/KDLKinematicsPlugin", "tfr_control/ArmKinematicsPlugin"});
+    ros::param::param<int>("~samples", samples, 10000);
+    ros::param::param<double>("~timeout", timeout, 0.005);
+    ros::param::param<double>("~tolerance", tolerance, 0.0001);
+    if (samples <= 0)
+    {
+        ROS_ERROR("IK Benchmark: samples must be positive");
+        return 1;
+    }
+
+    //don't load the configured solvers, we load our own
+    robot_model_loader::RobotModelLoader model_loader("robot_description", false);
+    robot_model::RobotModelConstPtr model = model_loader.getModel();
+    const robot_model::JointModelGroup *group =
+        model ? model->getJointModelGroup(group_name) : nullptr;
+    if (group == nullptr)
+    {
+        ROS_ERROR("IK Benchmark: no group %s in the robot description", group_name.c_str());
+        return 1;
+    }
+    const std::string &base = group->getJointModels().front()->getParentLinkModel()->getName();
+    const std::string &tip = group->getLinkModelNames().back();
+
+    //the same poses for every solver
+    robot_state::RobotState state(model);
+    state.setToDefaultValues();
+    std::vector<Sample> set(samples);
+    for (auto &sample : set)
+    {
+        state.setToRandomPositions(group);
+        state.copyJointGroupPositions(group, sample.seed);
+        state.setToRandomPositions(group);
+        state.update();
+        tf::poseEigenToMsg(state.getGlobalLinkTransform(base).inverse() *
+                state.getGlobalLinkTransform(tip), sample.pose);
+    }
+
+    pluginlib::ClassLoader<kinematics::KinematicsBase> loader("moveit_core",
+            "kinematics::KinematicsBase");
+    for (const auto &name : solvers)
+    {
+        boost::shared_ptr<kinematics::KinematicsBase> solver;
+        try
+        {
+            solver = loader.createInstance(name);
+        }
+        catch (const pluginlib::PluginlibException &e)
+        {
+            ROS_ERROR("IK Benchmark: couldn't load %s: %s", name.c_str(), e.what());
+            continue;
+        }
+        if (!solver->initialize("robot_description", group_name, base, tip, 0.005))
+        {
+            ROS_ERROR("IK Benchmark: couldn't initialize %s", name.c_str());
+            continue;
+        }
+
+        int solved = 0;
+        double total = 0, worst = 0;
+        for (const auto &sample : set)
+        {
+            std::vector<double> solution;
+            moveit_msgs::MoveItErrorCodes error_code;
+            auto start = std::chrono::steady_clock::now();
+            bool found = solver->searchPositionIK(sample.pose, sample.seed, timeout,
+                    solution, error_code);
+            double elapsed = std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - start).count();
+            total += elapsed;
+            worst = std::max(worst, elapsed);
+            if (!found)
+                continue;
+
+            state.setJointGroupPositions(group, solution);
+            state.update();
+            Eigen::Vector3d reached = (state.getGlobalLinkTransform(base).inverse() *
+                    state.getGlobalLinkTransform(tip)).translation();
+            Eigen::Vector3d wanted;
+            tf::pointMsgToEigen(sample.pose.position, wanted);
+            if ((reached - wanted).norm() <= tolerance)
+                solved++;
+        }
+        ROS_INFO("IK Benchmark: %s: %.1f us mean, %.1f us worst, solved %d of %d (%.1f%%)",
+                name.c_str(), total / set.size(), worst, solved, samples,
+                100.0 * solved / samples);
+    }
+    return 0;
+}
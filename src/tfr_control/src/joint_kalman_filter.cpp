@@ -0,0 +1,122 @@
+/****************************************************************************************
+ * File:            joint_kalman_filter.cpp
+ *
+ * Purpose:         This is the implementation file for the JointKalmanFilter
+ *                  class. See tfr_control/include/tfr_control/joint_kalman_filter.h
+ *                  for details.
+ ***************************************************************************************/
+#include "joint_kalman_filter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace tfr_control
+{
+    constexpr double JointKalmanFilter::MAX_GAP;
+
+    JointKalmanFilter::JointKalmanFilter(const Settings &s) :
+        settings(s), initialized{false}, last_stamp{0},
+        position{0}, velocity{0}, p00{0}, p01{0}, p11{0},
+        innovation_count{0}, innovation_sum{0}, innovation_squares{0},
+        nis_sum{0}, reported_count{0}, reported_sum{0},
+        reported_squares{0}, reported_nis{0}
+    {}
+
+    void JointKalmanFilter::update(const double &measured, const double &stamp,
+            const double &pwm)
+    {
+        double dt = stamp - last_stamp;
+        if (!initialized || dt < 0 || dt > MAX_GAP)
+        {
+            //we know where it is as well as the pot does, and only that it's
+            //no faster than full pwm would drive it
+            position = measured;
+            velocity = 0;
+            p00 = settings.measurement_noise;
+            p01 = 0;
+            p11 = settings.input_gain * settings.input_gain;
+            last_stamp = stamp;
+            initialized = true;
+            return;
+        }
+        last_stamp = stamp;
+
+        //predict, the speed relaxes toward what the pwm asks for
+        double decay = std::exp(-dt / std::max(settings.time_constant, 1e-3));
+        double lag = settings.time_constant * (1 - decay);
+        double target = settings.input_gain * pwm;
+        position += target * dt + (velocity - target) * lag;
+        velocity = target + (velocity - target) * decay;
+
+        //P = F P F' + Q with F = [1 lag; 0 decay], Q from white acceleration
+        double q = settings.process_noise;
+        double f00 = p00 + 2 * lag * p01 + lag * lag * p11;
+        double f01 = decay * (p01 + lag * p11);
+        double f11 = decay * decay * p11;
+        p00 = f00 + q * dt * dt * dt / 3;
+        p01 = f01 + q * dt * dt / 2;
+        p11 = f11 + q * dt;
+
+        //update with the reading
+        double innovation = measured - position;
+        double variance = p00 + settings.measurement_noise;
+        double k0 = p00 / variance;
+        double k1 = p01 / variance;
+        position += k0 * innovation;
+        velocity += k1 * innovation;
+        double u00 = (1 - k0) * p00;
+        double u01 = (1 - k0) * p01;
+        double u11 = p11 - k1 * p01;
+        p00 = u00;
+        p01 = u01;
+        p11 = u11;
+
+        //only this thread writes them, so plain loads and stores will do
+        innovation_sum.store(innovation_sum.load() + innovation);
+        innovation_squares.store(innovation_squares.load() + innovation * innovation);
+        nis_sum.store(nis_sum.load() + innovation * innovation / variance);
+        innovation_count.store(innovation_count.load() + 1);
+    }
+
+    void JointKalmanFilter::reset()
+    {
+        initialized = false;
+    }
+
+    double JointKalmanFilter::getPosition() const
+    {
+        return position;
+    }
+
+    double JointKalmanFilter::getVelocity() const
+    {
+        return velocity;
+    }
+
+    double JointKalmanFilter::predictPosition(const double &time) const
+    {
+        double ahead = std::max(0.0, std::min(time - last_stamp, MAX_GAP));
+        return position + velocity * ahead;
+    }
+
+    JointKalmanFilter::Innovations JointKalmanFilter::takeInnovations()
+    {
+        //a reading landing between these loads only skews this window a hair
+        uint64_t count = innovation_count.load();
+        double sum = innovation_sum.load();
+        double squares = innovation_squares.load();
+        double nis = nis_sum.load();
+
+        Innovations result{count - reported_count, 0, 0, 0};
+        if (result.count > 0)
+        {
+            result.mean = (sum - reported_sum) / result.count;
+            result.rms = std::sqrt(std::max(squares - reported_squares, 0.0) / result.count);
+            result.nis = (nis - reported_nis) / result.count;
+        }
+        reported_count = count;
+        reported_sum = sum;
+        reported_squares = squares;
+        reported_nis = nis;
+        return result;
+    }
+}
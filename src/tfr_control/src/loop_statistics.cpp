@@ -0,0 +1,197 @@
+/****************************************************************************************
+ * File:            loop_statistics.cpp
+ *
+ * Purpose:         This is the implementation file for the LoopStatistics class.
+ *                  See tfr_control/include/tfr_control/loop_statistics.h for details.
+ ***************************************************************************************/
+#include "loop_statistics.h"
+#include <algorithm>
+#include <limits>
+
+namespace tfr_control
+{
+    //values below this get a bucket each
+    static const int LINEAR_BUCKETS = 16;
+    //sub buckets per power of two
+    static const int SUB_BITS = 3;
+
+    LatencyHistogram::LatencyHistogram() : max{0}
+    {
+        for (auto &count : counts)
+            count.store(0, std::memory_order_relaxed);
+    }
+
+    int LatencyHistogram::bucketOf(uint64_t ns)
+    {
+        if (ns < LINEAR_BUCKETS)
+            return static_cast<int>(ns);
+        int exponent = 63 - __builtin_clzll(ns);
+        int sub = static_cast<int>((ns >> (exponent - SUB_BITS)) & ((1 << SUB_BITS) - 1));
+        int bucket = LINEAR_BUCKETS + ((exponent - 4) << SUB_BITS) + sub;
+        return std::min(bucket, BUCKETS - 1);
+    }
+
+    uint64_t LatencyHistogram::bucketLowerBound(int bucket)
+    {
+        if (bucket < LINEAR_BUCKETS)
+            return static_cast<uint64_t>(bucket);
+        int exponent = ((bucket - LINEAR_BUCKETS) >> SUB_BITS) + 4;
+        uint64_t sub = (bucket - LINEAR_BUCKETS) & ((1 << SUB_BITS) - 1);
+        return ((1ULL << SUB_BITS) + sub) << (exponent - SUB_BITS);
+    }
+
+    void LatencyHistogram::record(uint64_t ns)
+    {
+        counts[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        //only raises the value that's actually there, a takeMax() in
+        //between fails the exchange and ns is compared against its reset
+        uint64_t seen = max.load(std::memory_order_relaxed);
+        while (ns > seen && !max.compare_exchange_weak(seen, ns, std::memory_order_relaxed))
+            ;
+    }
+
+    void LatencyHistogram::snapshot(Snapshot &out) const
+    {
+        for (int i = 0; i < BUCKETS; i++)
+            out.counts[i] = counts[i].load(std::memory_order_relaxed);
+    }
+
+    uint64_t LatencyHistogram::takeMax()
+    {
+        return max.exchange(0, std::memory_order_relaxed);
+    }
+
+    /*
+     * Reports the midpoint of the bucket the percentile falls in
+     * */
+    uint64_t LatencyHistogram::percentile(const Snapshot &now,
+            const Snapshot &before, double p)
+    {
+        uint64_t total = 0;
+        for (int i = 0; i < BUCKETS; i++)
+            total += now.counts[i] - before.counts[i];
+        if (total == 0)
+            return 0;
+
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * total + 0.5));
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++)
+        {
+            seen += now.counts[i] - before.counts[i];
+            if (seen >= rank)
+            {
+                if (i == BUCKETS - 1)
+                    return bucketLowerBound(i);
+                return (bucketLowerBound(i) + bucketLowerBound(i + 1)) / 2;
+            }
+        }
+        return bucketLowerBound(BUCKETS - 1);
+    }
+
+    LoopStatistics::LoopStatistics(uint64_t nominal, double tolerance) :
+        nominal_period{nominal},
+        late_threshold{static_cast<uint64_t>(nominal * (1 + tolerance))},
+        last_reported{}, cycles{0}, overruns{0}, deadline_misses{0}, head{0}
+    {
+        for (auto &sample : ring)
+            for (auto &field : sample)
+                field.store(0, std::memory_order_relaxed);
+    }
+
+    void LoopStatistics::record(uint64_t period, uint64_t read,
+            uint64_t update, uint64_t write)
+    {
+        uint64_t cycle = read + update + write;
+        histograms[static_cast<int>(LoopPhase::PERIOD)].record(period);
+        histograms[static_cast<int>(LoopPhase::READ)].record(read);
+        histograms[static_cast<int>(LoopPhase::UPDATE)].record(update);
+        histograms[static_cast<int>(LoopPhase::WRITE)].record(write);
+        histograms[static_cast<int>(LoopPhase::CYCLE)].record(cycle);
+
+        cycles.fetch_add(1, std::memory_order_relaxed);
+        if (cycle > nominal_period)
+            overruns.fetch_add(1, std::memory_order_relaxed);
+        if (period > late_threshold)
+            deadline_misses.fetch_add(1, std::memory_order_relaxed);
+
+        const uint64_t clamp = std::numeric_limits<uint32_t>::max();
+        uint64_t index = head.load(std::memory_order_relaxed);
+        auto &slot = ring[index % SAMPLE_COUNT];
+        //pairs with the fence in recentSamples, anyone who sees these stores
+        //also sees the head from before them
+        std::atomic_thread_fence(std::memory_order_release);
+        slot[0].store(std::min(period, clamp), std::memory_order_relaxed);
+        slot[1].store(std::min(read, clamp), std::memory_order_relaxed);
+        slot[2].store(std::min(update, clamp), std::memory_order_relaxed);
+        slot[3].store(std::min(write, clamp), std::memory_order_relaxed);
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    void LoopStatistics::summarize(Summary (&summaries)[PHASE_COUNT])
+    {
+        for (int i = 0; i < PHASE_COUNT; i++)
+        {
+            LatencyHistogram::Snapshot now;
+            histograms[i].snapshot(now);
+            uint64_t samples = 0;
+            for (int j = 0; j < LatencyHistogram::BUCKETS; j++)
+                samples += now.counts[j] - last_reported[i].counts[j];
+
+            summaries[i].samples = samples;
+            summaries[i].p50 = LatencyHistogram::percentile(now, last_reported[i], 0.50);
+            summaries[i].p99 = LatencyHistogram::percentile(now, last_reported[i], 0.99);
+            summaries[i].max = histograms[i].takeMax();
+            last_reported[i] = now;
+        }
+    }
+
+    uint64_t LoopStatistics::getCycles() const
+    {
+        return cycles.load(std::memory_order_relaxed);
+    }
+
+    uint64_t LoopStatistics::getOverruns() const
+    {
+        return overruns.load(std::memory_order_relaxed);
+    }
+
+    uint64_t LoopStatistics::getDeadlineMisses() const
+    {
+        return deadline_misses.load(std::memory_order_relaxed);
+    }
+
+    uint64_t LoopStatistics::getNominalPeriod() const
+    {
+        return nominal_period;
+    }
+
+    /*
+     * The loop keeps writing while we copy, so once we are done we throw away
+     * anything that may have been lapped by the writer in the meantime.
+     * */
+    void LoopStatistics::recentSamples(std::vector<Sample> &out) const
+    {
+        out.clear();
+        uint64_t end = head.load(std::memory_order_acquire);
+        uint64_t begin = (end > SAMPLE_COUNT) ? end - SAMPLE_COUNT : 0;
+        std::vector<Sample> copied;
+        copied.reserve(end - begin);
+        for (uint64_t i = begin; i < end; i++)
+        {
+            auto &slot = ring[i % SAMPLE_COUNT];
+            Sample sample{};
+            sample.period = slot[0].load(std::memory_order_relaxed);
+            sample.read = slot[1].load(std::memory_order_relaxed);
+            sample.update = slot[2].load(std::memory_order_relaxed);
+            sample.write = slot[3].load(std::memory_order_relaxed);
+            copied.push_back(sample);
+        }
+
+        //the writer may be part way through the slot at the new head
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t lapped = head.load(std::memory_order_acquire) + 1;
+        uint64_t valid = (lapped > SAMPLE_COUNT) ? lapped - SAMPLE_COUNT : 0;
+        uint64_t skip = (valid > begin) ? std::min(valid - begin, end - begin) : 0;
+        out.assign(copied.begin() + skip, copied.end());
+    }
+}
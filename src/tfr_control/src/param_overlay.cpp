@@ -0,0 +1,88 @@
+/****************************************************************************************
+ * File:            param_overlay.cpp
+ *
+ * Purpose:         This is the implementation file for loadParamOverlay.
+ *                  See tfr_control/include/tfr_control/param_overlay.h for details.
+ ***************************************************************************************/
+#include "param_overlay.h"
+#include <ros/ros.h>
+#include <yaml-cpp/yaml.h>
+#include <fstream>
+
+namespace tfr_control
+{
+    namespace
+    {
+        //same types rosparam gives a value, lists and maps inside lists included
+        XmlRpc::XmlRpcValue toXmlRpc(const YAML::Node &node)
+        {
+            XmlRpc::XmlRpcValue value;
+            if (node.IsSequence())
+            {
+                value.setSize(node.size());
+                for (size_t i = 0; i < node.size(); i++)
+                    value[i] = toXmlRpc(node[i]);
+                return value;
+            }
+            if (node.IsMap())
+            {
+                for (const auto &entry : node)
+                    value[entry.first.as<std::string>()] = toXmlRpc(entry.second);
+                return value;
+            }
+            if (!node.IsScalar())
+                return value;
+
+            int integer;
+            double real;
+            bool boolean;
+            if (YAML::convert<int>::decode(node, integer))
+                return XmlRpc::XmlRpcValue(integer);
+            if (YAML::convert<double>::decode(node, real))
+                return XmlRpc::XmlRpcValue(real);
+            if (YAML::convert<bool>::decode(node, boolean))
+                return XmlRpc::XmlRpcValue(boolean);
+            return XmlRpc::XmlRpcValue(node.Scalar());
+        }
+
+        //maps are walked down to their values, so siblings keep their defaults
+        void overlay(const YAML::Node &node, const std::string &name)
+        {
+            if (!node.IsMap())
+            {
+                ros::param::set(name, toXmlRpc(node));
+                return;
+            }
+            for (const auto &entry : node)
+                overlay(entry.second, name + "/" + entry.first.as<std::string>());
+        }
+    }
+
+    bool loadParamOverlay(const std::string &file, const std::string &ns)
+    {
+        if (file.empty() || !std::ifstream{file})
+            return true;
+
+        YAML::Node root;
+        try
+        {
+            root = YAML::LoadFile(file);
+        }
+        catch (const YAML::Exception &e)
+        {
+            ROS_ERROR("Param Overlay: couldn't read %s, %s", file.c_str(), e.what());
+            return false;
+        }
+        //only comments so far
+        if (root.IsNull())
+            return true;
+        if (!root.IsMap())
+        {
+            ROS_ERROR("Param Overlay: %s isn't a map of parameters", file.c_str());
+            return false;
+        }
+        overlay(root, ns);
+        ROS_INFO("Param Overlay: loaded %s over %s", file.c_str(), ns.c_str());
+        return true;
+    }
+}
@@ -0,0 +1,123 @@
+/****************************************************************************************
+ * File:            plant_backend.cpp
+ *
+ * Purpose:         This is the implementation file for the PlantBackend class.
+ *                  See tfr_control/include/tfr_control/plant_backend.h for details.
+ ***************************************************************************************/
+#include "plant_backend.h"
+#include <algorithm>
+#include <cmath>
+
+namespace tfr_control
+{
+    PlantBackend::PlantBackend(const Settings &s) :
+        settings(s), pwm{}, velocity{}, position{}, enabled{false},
+        last_step{ros::Time::now()}, last_reading{}, sequence{0},
+        pending_a{false}, pending_b{false}
+    {
+        //NOTE the signs follow how each motor is mounted, see RobotInterface::write
+        gains[TREAD_LEFT] = settings.tread_speed;
+        gains[TREAD_RIGHT] = settings.tread_speed;
+        gains[TURNTABLE] = -settings.turntable_speed;
+        gains[ARM_LOWER] = -settings.arm_speed;
+        gains[ARM_UPPER] = settings.arm_speed;
+        gains[ARM_SCOOP] = settings.arm_speed;
+        gains[BIN_LEFT] = -settings.bin_speed;
+        gains[BIN_RIGHT] = -settings.bin_speed * (1 - settings.bin_skew);
+
+        ranges[TREAD_LEFT] = Range{0, 0};
+        ranges[TREAD_RIGHT] = Range{0, 0};
+        ranges[TURNTABLE] = settings.turntable;
+        ranges[ARM_LOWER] = settings.lower_arm;
+        ranges[ARM_UPPER] = settings.upper_arm;
+        ranges[ARM_SCOOP] = settings.scoop;
+        ranges[BIN_LEFT] = settings.bin;
+        ranges[BIN_RIGHT] = settings.bin;
+
+        //start at rest with the joints at zero, or as close as they go
+        for (int i = 0; i < MOTOR_COUNT; i++)
+            if (ranges[i].lower < ranges[i].upper)
+                position[i] = std::max(ranges[i].lower, std::min(0.0, ranges[i].upper));
+    }
+
+    bool PlantBackend::readArduinoA(ArduinoAData &data)
+    {
+        step(ros::Time::now());
+        if (!pending_a)
+            return false;
+        pending_a = false;
+        data.stamp = last_reading.toSec();
+        data.seq = sequence;
+        data.tread_left_vel = velocity[TREAD_LEFT];
+        data.arm_turntable_pos = position[TURNTABLE];
+        data.arm_lower_pos = position[ARM_LOWER];
+        data.arm_upper_pos = position[ARM_UPPER];
+        data.arm_scoop_pos = position[ARM_SCOOP];
+        data.bin_left_pos = position[BIN_LEFT];
+        data.bin_right_pos = position[BIN_RIGHT];
+        return true;
+    }
+
+    bool PlantBackend::readArduinoB(ArduinoBData &data)
+    {
+        step(ros::Time::now());
+        if (!pending_b)
+            return false;
+        pending_b = false;
+        data.stamp = last_reading.toSec();
+        data.seq = sequence;
+        data.tread_right_vel = velocity[TREAD_RIGHT];
+        return true;
+    }
+
+    /*
+     * The command holds until the next write, like the motor controllers
+     * */
+    void PlantBackend::write(const tfr_msgs::PwmCommand &command)
+    {
+        pwm[TREAD_LEFT] = command.tread_left;
+        pwm[TREAD_RIGHT] = command.tread_right;
+        pwm[TURNTABLE] = command.arm_turntable;
+        pwm[ARM_LOWER] = command.arm_lower;
+        pwm[ARM_UPPER] = command.arm_upper;
+        pwm[ARM_SCOOP] = command.arm_scoop;
+        pwm[BIN_LEFT] = command.bin_left;
+        pwm[BIN_RIGHT] = command.bin_right;
+        enabled = command.enabled;
+    }
+
+    void PlantBackend::step(const ros::Time &now)
+    {
+        double dt = (now - last_step).toSec();
+        if (dt <= 0)
+            return;
+        last_step = now;
+
+        //exact response of a first order lag over dt
+        double lag = 1 - std::exp(-dt / settings.time_constant);
+        for (int i = 0; i < MOTOR_COUNT; i++)
+        {
+            double input = std::max(-1.0, std::min(pwm[i], 1.0));
+            double target = (enabled && std::abs(input) >= settings.deadband) ?
+                gains[i] * input : 0;
+            velocity[i] += (target - velocity[i]) * lag;
+            position[i] += velocity[i] * dt;
+
+            const Range &range = ranges[i];
+            if (range.lower < range.upper &&
+                    (position[i] <= range.lower || position[i] >= range.upper))
+            {
+                position[i] = std::max(range.lower, std::min(position[i], range.upper));
+                velocity[i] = 0;
+            }
+        }
+
+        if ((now - last_reading).toSec() >= 1 / settings.reading_rate)
+        {
+            last_reading = now;
+            sequence++;
+            pending_a = true;
+            pending_b = true;
+        }
+    }
+}
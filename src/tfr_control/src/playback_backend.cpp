@@ -0,0 +1,109 @@
+/****************************************************************************************
+ * File:            playback_backend.cpp
+ *
+ * Purpose:         This is the implementation file for the PlaybackBackend class.
+ *                  See tfr_control/include/tfr_control/playback_backend.h for details.
+ ***************************************************************************************/
+#include "playback_backend.h"
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <tfr_msgs/ArduinoAReading.h>
+#include <tfr_msgs/ArduinoBReading.h>
+
+namespace tfr_control
+{
+    PlaybackBackend::PlaybackBackend(const std::string &path, bool loop_playback) :
+        readings_a{}, readings_b{}, cursor_a{0}, cursor_b{0},
+        loop{loop_playback}, start{ros::Time::now()}, duration{0}
+    {
+        rosbag::Bag bag{path, rosbag::bagmode::Read};
+        rosbag::View view{bag, rosbag::TopicQuery(
+                std::vector<std::string>{"/sensors/arduino_a", "/sensors/arduino_b"})};
+        ros::Time begin = view.getBeginTime();
+
+        //stamps are kept relative to the start of the bag as well
+        for (const rosbag::MessageInstance &message : view)
+        {
+            double offset = (message.getTime() - begin).toSec();
+            auto a = message.instantiate<tfr_msgs::ArduinoAReading>();
+            if (a != nullptr)
+            {
+                ArduinoAData data{};
+                data.stamp = a->header.stamp.isZero() ? offset :
+                    (a->header.stamp - begin).toSec();
+                data.seq = a->header.seq;
+                data.tread_left_vel = a->tread_left_vel;
+                data.arm_turntable_pos = a->arm_turntable_pos;
+                data.arm_lower_pos = a->arm_lower_pos;
+                data.arm_upper_pos = a->arm_upper_pos;
+                data.arm_scoop_pos = a->arm_scoop_pos;
+                data.bin_left_pos = a->bin_left_pos;
+                data.bin_right_pos = a->bin_right_pos;
+                readings_a.push_back(Recorded<ArduinoAData>{offset, data});
+            }
+            auto b = message.instantiate<tfr_msgs::ArduinoBReading>();
+            if (b != nullptr)
+            {
+                ArduinoBData data{};
+                data.stamp = b->header.stamp.isZero() ? offset :
+                    (b->header.stamp - begin).toSec();
+                data.seq = b->header.seq;
+                data.tread_right_vel = b->tread_right_vel;
+                readings_b.push_back(Recorded<ArduinoBData>{offset, data});
+            }
+            duration = offset;
+        }
+        bag.close();
+
+        if (readings_a.empty() || readings_b.empty())
+            ROS_WARN("Playback Backend: %s is missing arduino readings", path.c_str());
+        ROS_INFO("Playback Backend: loaded %zu arduino_a and %zu arduino_b readings, %f s",
+                readings_a.size(), readings_b.size(), duration);
+    }
+
+    bool PlaybackBackend::readArduinoA(ArduinoAData &data)
+    {
+        return next(readings_a, cursor_a, data);
+    }
+
+    bool PlaybackBackend::readArduinoB(ArduinoBData &data)
+    {
+        return next(readings_b, cursor_b, data);
+    }
+
+    void PlaybackBackend::write(const tfr_msgs::PwmCommand &command)
+    {
+        //nothing is listening
+    }
+
+    void PlaybackBackend::rewind(const ros::Time &now)
+    {
+        start = now;
+        cursor_a = 0;
+        cursor_b = 0;
+    }
+
+    /*
+     * Hands out the newest reading recorded by this point in playback, any
+     * that were skipped over show up as drops
+     * */
+    template <typename Data>
+    bool PlaybackBackend::next(const std::vector<Recorded<Data>> &readings,
+            size_t &cursor, Data &data)
+    {
+        ros::Time now = ros::Time::now();
+        if (loop && duration > 0 && (now - start).toSec() > duration)
+            rewind(now);
+
+        double elapsed = (now - start).toSec();
+        size_t previous = cursor;
+        while (cursor < readings.size() && readings[cursor].offset <= elapsed)
+            cursor++;
+        if (cursor == previous)
+            return false;
+
+        data = readings[cursor - 1].data;
+        data.stamp += start.toSec();
+        return true;
+    }
+}
@@ -0,0 +1,127 @@
+/****************************************************************************************
+ * File:            realtime_loop.cpp
+ *
+ * Purpose:         This is the implementation file for the RealtimeLoop class.
+ *                  See tfr_control/include/tfr_control/realtime_loop.h for details.
+ ***************************************************************************************/
+#include "realtime_loop.h"
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <cerrno>
+#include <cstring>
+
+namespace
+{
+    const long NS_PER_S = 1000000000L;
+
+    void addNanoseconds(timespec &t, long ns)
+    {
+        t.tv_nsec += ns;
+        while (t.tv_nsec >= NS_PER_S)
+        {
+            t.tv_nsec -= NS_PER_S;
+            t.tv_sec++;
+        }
+    }
+
+    long differenceNanoseconds(const timespec &t_1, const timespec &t_0)
+    {
+        return (t_1.tv_sec - t_0.tv_sec) * NS_PER_S + (t_1.tv_nsec - t_0.tv_nsec);
+    }
+}
+
+namespace tfr_control
+{
+    RealtimeLoop::RealtimeLoop(double rate, const Settings &s, Task t) :
+        period_ns{static_cast<long>(NS_PER_S / rate)}, settings(s),
+        task{t}, running{false}, thread{}
+    { }
+
+    RealtimeLoop::~RealtimeLoop()
+    {
+        stop();
+    }
+
+    void RealtimeLoop::start()
+    {
+        if (running)
+            return;
+        if (settings.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+            ROS_WARN("Realtime Loop: mlockall failed (%s), continuing unlocked",
+                    std::strerror(errno));
+        running = true;
+        thread = std::thread(&RealtimeLoop::run, this);
+    }
+
+    void RealtimeLoop::stop()
+    {
+        running = false;
+        if (thread.joinable())
+            thread.join();
+    }
+
+    /*
+     * Applies the cpu pinning and scheduling policy to the calling thread
+     * */
+    void RealtimeLoop::configureThread()
+    {
+        if (settings.cpu >= 0)
+        {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(settings.cpu, &cpus);
+            int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+            if (err != 0)
+                ROS_WARN("Realtime Loop: could not pin to cpu %d (%s)",
+                        settings.cpu, std::strerror(err));
+        }
+
+        if (settings.priority > 0)
+        {
+            sched_param param{};
+            param.sched_priority = settings.priority;
+            int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+            if (err != 0)
+                ROS_WARN("Realtime Loop: could not set SCHED_FIFO priority %d (%s)",
+                        settings.priority, std::strerror(err));
+        }
+    }
+
+    /*
+     * The control thread. Deadlines are absolute, so time spent in the task
+     * comes out of the sleep rather than being added to the period. If we
+     * fall more than a full period behind we drop the missed cycles and
+     * resynchronize instead of bursting to catch up.
+     * */
+    void RealtimeLoop::run()
+    {
+        configureThread();
+
+        timespec deadline{}, last{}, now{};
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        last = deadline;
+        //the first cycle has nothing to measure against, use the nominal period
+        long elapsed = period_ns;
+
+        while (running && ros::ok())
+        {
+            ros::Duration period{};
+            period.fromNSec(elapsed);
+            task(period);
+
+            addNanoseconds(deadline, period_ns);
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (differenceNanoseconds(now, deadline) > period_ns)
+                deadline = now;
+
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline,
+                        nullptr) == EINTR);
+
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            elapsed = differenceNanoseconds(now, last);
+            last = now;
+        }
+    }
+}
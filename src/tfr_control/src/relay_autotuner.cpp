@@ -0,0 +1,323 @@
+/****************************************************************************************
+ * File:            relay_autotuner.cpp
+ *
+ * Purpose:         This is the implementation file for the RelayAutotuner class.
+ *                  See tfr_control/include/tfr_control/relay_autotuner.h for details.
+ ***************************************************************************************/
+#include "relay_autotuner.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <yaml-cpp/yaml.h>
+
+namespace tfr_control
+{
+    //oscillations thrown away while the relay settles in
+    static const int SETTLING_CYCLES = 2;
+    //longest we wait for the joint to respond to the relay at all
+    static const double PROBE_TIMEOUT = 2.0;
+
+    RelayAutotuner::RelayAutotuner(const Settings &s, const Joint &j,
+            const std::string &n, bool integrating_joint) :
+        settings(s), joint{j}, name{n}, integrating{integrating_joint},
+        phase{Phase::START}, success{false}, result{},
+        direction{1}, probe_start{0}, probe_from{0},
+        setpoint{0}, high{false}, highest{0}, lowest{0},
+        output_sum{0}, measured_sum{0}, samples{0},
+        switch_times{}, amplitudes{},
+        step_start{0}, step_from{0}, last_time{0}, last_error{0},
+        integral{0}, peak{0}, rise_low{-1}, rise_high{-1}
+    {}
+
+    bool RelayAutotuner::update(RobotInterface &robot, const double &now)
+    {
+        double measured = measure(robot);
+        switch (phase)
+        {
+            case Phase::START:
+                ROS_INFO("Relay Autotuner: probing %s", name.c_str());
+                probe_start = now;
+                probe_from = measured;
+                actuate(robot, settings.bias + settings.amplitude);
+                phase = Phase::PROBE;
+                break;
+            case Phase::PROBE:
+                probe(robot, now, measured);
+                break;
+            case Phase::RELAY:
+                relay(robot, now, measured);
+                break;
+            case Phase::STEP:
+                step(robot, now, measured);
+                break;
+            case Phase::DONE:
+                break;
+        }
+        return phase == Phase::DONE;
+    }
+
+    bool RelayAutotuner::succeeded() const
+    {
+        return success;
+    }
+
+    const RelayAutotuner::Result& RelayAutotuner::getResult() const
+    {
+        return result;
+    }
+
+    bool RelayAutotuner::save(const std::string &path) const
+    {
+        if (!success)
+            return false;
+
+        //keep what's there for the other joints
+        YAML::Node kept;
+        if (std::ifstream{path})
+        {
+            try
+            {
+                kept = YAML::LoadFile(path);
+            }
+            catch (const YAML::Exception &e)
+            {
+                ROS_ERROR("Relay Autotuner: won't overwrite %s, it isn't valid YAML, %s",
+                        path.c_str(), e.what());
+                return false;
+            }
+        }
+
+        YAML::Emitter emitter;
+        emitter.SetDoublePrecision(6);
+        emitter << YAML::Comment("relay autotune results, suggested gains are Tyreus-Luyben");
+        emitter << YAML::BeginMap;
+        if (kept.IsMap())
+            for (const auto &entry : kept)
+                if (entry.first.as<std::string>() != name)
+                    emitter << YAML::Key << entry.first << YAML::Value << entry.second;
+        emitter << YAML::Key << name << YAML::Value << YAML::BeginMap;
+        emitter << YAML::Key << "model" << YAML::Value << YAML::Flow << YAML::BeginMap
+            << YAML::Key << "type" << YAML::Value
+            << (integrating ? "integrating" : "first_order")
+            << YAML::Key << "gain" << YAML::Value << result.plant_gain
+            << YAML::Key << "time_constant" << YAML::Value << result.time_constant
+            << YAML::Key << "dead_time" << YAML::Value << result.dead_time
+            << YAML::EndMap;
+        emitter << YAML::Key << "ultimate" << YAML::Value << YAML::Flow << YAML::BeginMap
+            << YAML::Key << "gain" << YAML::Value << result.ultimate_gain
+            << YAML::Key << "period" << YAML::Value << result.ultimate_period
+            << YAML::EndMap;
+        emitter << YAML::Key << "pid" << YAML::Value << YAML::Flow << YAML::BeginMap
+            << YAML::Key << "p" << YAML::Value << result.p
+            << YAML::Key << "i" << YAML::Value << result.i
+            << YAML::Key << "d" << YAML::Value << result.d
+            << YAML::EndMap;
+        emitter << YAML::Key << "step" << YAML::Value << YAML::Flow << YAML::BeginMap
+            << YAML::Key << "size" << YAML::Value << settings.step_size
+            << YAML::Key << "rise_time" << YAML::Value << result.rise_time
+            << YAML::Key << "overshoot" << YAML::Value << result.overshoot
+            << YAML::EndMap;
+        emitter << YAML::EndMap << YAML::EndMap;
+        if (!emitter.good())
+            return false;
+
+        std::ofstream out{path};
+        if (!out)
+            return false;
+        out << emitter.c_str() << "\n";
+        return static_cast<bool>(out);
+    }
+
+    double RelayAutotuner::measure(RobotInterface &robot) const
+    {
+        if (integrating)
+            return robot.getJointPosition(joint);
+        return robot.getJointVelocity(joint);
+    }
+
+    void RelayAutotuner::actuate(RobotInterface &robot, const double &value) const
+    {
+        if (integrating)
+            robot.overridePWM(joint, value);
+        else
+            robot.setCommand(joint, value);
+    }
+
+    /*
+     * Pushes the joint one way to learn which way the relay has to switch
+     * */
+    void RelayAutotuner::probe(RobotInterface &robot, const double &now,
+            const double &measured)
+    {
+        actuate(robot, settings.bias + settings.amplitude);
+        double moved = measured - probe_from;
+        if (std::abs(moved) > 2 * settings.hysteresis)
+        {
+            direction = (moved < 0) ? -1 : 1;
+            setpoint = integrating ? probe_from + settings.setpoint : settings.setpoint;
+            high = true;
+            highest = lowest = measured;
+            ROS_INFO("Relay Autotuner: relay on %s around %f", name.c_str(), setpoint);
+            phase = Phase::RELAY;
+        }
+        else if (now - probe_start > PROBE_TIMEOUT)
+        {
+            ROS_ERROR("Relay Autotuner: %s didn't move, giving up", name.c_str());
+            finish(robot, false);
+        }
+    }
+
+    void RelayAutotuner::relay(RobotInterface &robot, const double &now,
+            const double &measured)
+    {
+        double error = setpoint - measured;
+        if (std::abs(error) > settings.max_excursion)
+        {
+            ROS_ERROR("Relay Autotuner: %s strayed %f from the setpoint, giving up",
+                    name.c_str(), error);
+            finish(robot, false);
+            return;
+        }
+        highest = std::max(highest, measured);
+        lowest = std::min(lowest, measured);
+
+        //switching up starts a new oscillation
+        if (high && error < -settings.hysteresis)
+            high = false;
+        else if (!high && error > settings.hysteresis)
+        {
+            high = true;
+            if (!switch_times.empty())
+                amplitudes.push_back((highest - lowest) / 2);
+            switch_times.push_back(now);
+            highest = lowest = measured;
+        }
+
+        double output = settings.bias +
+            (high ? direction : -direction) * settings.amplitude;
+        actuate(robot, output);
+        if (static_cast<int>(switch_times.size()) > SETTLING_CYCLES)
+        {
+            output_sum += output;
+            measured_sum += measured;
+            samples++;
+        }
+
+        if (static_cast<int>(switch_times.size()) > SETTLING_CYCLES + settings.cycles)
+        {
+            identify();
+            ROS_INFO("Relay Autotuner: %s ultimate gain %f period %f, stepping",
+                    name.c_str(), result.ultimate_gain, result.ultimate_period);
+            step_start = last_time = now;
+            //velocity joints step from where they were oscillating around
+            step_from = integrating ? measured : measured_sum / samples;
+            last_error = step_from + settings.step_size - measured;
+            //start the integrator where the relay left off, so the step
+            //isn't spent winding it up
+            integral = (result.i != 0) ? (output_sum / samples) / result.i : 0;
+            peak = 0;
+            phase = Phase::STEP;
+        }
+    }
+
+    /*
+     * Relay results to a plant model and gains, see Astrom and Hagglund
+     * */
+    void RelayAutotuner::identify()
+    {
+        double period = 0, amplitude = 0;
+        int cycles = 0;
+        for (size_t k = SETTLING_CYCLES; k + 1 < switch_times.size(); k++)
+        {
+            period += switch_times[k + 1] - switch_times[k];
+            amplitude += amplitudes[k];
+            cycles++;
+        }
+        period /= cycles;
+        amplitude /= cycles;
+
+        result.ultimate_period = period;
+        result.ultimate_gain = 4 * settings.amplitude /
+            (M_PI * std::max(amplitude, std::numeric_limits<double>::epsilon()));
+        double omega = 2 * M_PI / period;
+
+        if (integrating)
+        {
+            //a relay on an integrator with dead time gives a triangle wave
+            //with period 4L and amplitude K*d*L
+            result.dead_time = period / 4;
+            result.plant_gain = direction * amplitude /
+                (settings.amplitude * result.dead_time);
+            result.time_constant = 0;
+        }
+        else
+        {
+            //static gain from the averages, then the time constant and dead
+            //time that put the ultimate point where we measured it
+            double mean_output = output_sum / samples;
+            double gain = (std::abs(mean_output) > 1e-6) ?
+                (measured_sum / samples) / mean_output : direction;
+            double kk = std::abs(gain) * result.ultimate_gain;
+            result.plant_gain = gain;
+            result.time_constant = std::sqrt(std::max(kk * kk - 1, 0.0)) / omega;
+            result.dead_time = (M_PI - std::atan(omega * result.time_constant)) / omega;
+        }
+
+        //Tyreus-Luyben
+        double kp = result.ultimate_gain / 2.2;
+        double ti = 2.2 * period;
+        double td = period / 6.3;
+        result.p = direction * kp;
+        result.i = direction * kp / ti;
+        result.d = direction * kp * td;
+    }
+
+    /*
+     * Closes the loop with the suggested gains and times the response
+     * */
+    void RelayAutotuner::step(RobotInterface &robot, const double &now,
+            const double &measured)
+    {
+        double target = step_from + settings.step_size;
+        double error = target - measured;
+        double dt = now - last_time;
+        double derivative = (dt > 0) ? (error - last_error) / dt : 0;
+        integral += error * dt;
+        last_time = now;
+        last_error = error;
+
+        double output = result.p * error + result.i * integral + result.d * derivative;
+        if (integrating)
+            output = std::max(-1.0, std::min(output, 1.0));
+        actuate(robot, output);
+
+        double progress = (measured - step_from) / settings.step_size;
+        peak = std::max(peak, progress);
+        if (rise_low < 0 && progress >= 0.1)
+            rise_low = now;
+        if (rise_high < 0 && progress >= 0.9)
+            rise_high = now;
+
+        if (now - step_start >= settings.step_time)
+        {
+            result.rise_time = (rise_low >= 0 && rise_high >= 0) ?
+                rise_high - rise_low : std::numeric_limits<double>::infinity();
+            result.overshoot = std::max(peak - 1, 0.0) * 100;
+            ROS_INFO("Relay Autotuner: %s p %f i %f d %f rise time %f overshoot %f%%",
+                    name.c_str(), result.p, result.i, result.d,
+                    result.rise_time, result.overshoot);
+            finish(robot, true);
+        }
+    }
+
+    void RelayAutotuner::finish(RobotInterface &robot, bool succeeded)
+    {
+        if (integrating)
+            robot.clearOverrides();
+        else
+            robot.setCommand(joint, 0);
+        success = succeeded;
+        phase = Phase::DONE;
+    }
+}
@@ -3,6 +3,7 @@
  * the robot itself, and is started by the controller_launcher node.
  */
 #include "robot_interface.h"
+#include <cmath>
 
 using hardware_interface::JointStateHandle;
 using hardware_interface::JointHandle;
@@ -13,19 +14,50 @@ namespace tfr_control
      * Creates the robot interfaces spins up all the joints and registers them
      * with their relevant interfaces
      * */
-    RobotInterface::RobotInterface(ros::NodeHandle &n, bool fakes, 
-            const double *lower_lim, const double *upper_lim) :
-        arduino_a{n.subscribe("/sensors/arduino_a", 5,
-                &RobotInterface::readArduinoA, this)},
-        arduino_b{n.subscribe("/sensors/arduino_b", 5,
-                &RobotInterface::readArduinoB, this)},
-        pwm_publisher{n.advertise<tfr_msgs::PwmCommand>("/motor_output", 15)},
-        use_fake_values{fakes}, lower_limits{lower_lim},
-        upper_limits{upper_lim}, drivebase_v0{std::make_pair(0,0)},
+    RobotInterface::RobotInterface(std::unique_ptr<HardwareBackend> hardware,
+            const Settings &settings) :
+        enabled{true}, zero_turntable_requested{false},
+        backend{std::move(hardware)},
+        arduino_a_monitor{settings.stale_timeout},
+        arduino_b_monitor{settings.stale_timeout},
+        left_tread_limiter{settings.drivebase_max_accel, settings.drivebase_max_jerk},
+        right_tread_limiter{settings.drivebase_max_accel, settings.drivebase_max_jerk},
         last_update{ros::Time::now()},
-        enabled{true}
+        drivebase_max_vel{settings.drivebase_max_vel},
+        drivebase_min_pwm{settings.drivebase_min_pwm},
+        drivebase_deadband{settings.drivebase_deadband},
+        bin_controller{settings.bin},
+        current_budget{settings.power},
+        feedforward_gain{settings.feedforward_gain},
+        feedforward_tolerance{settings.feedforward_tolerance},
+        filter_potentiometers{settings.filter_potentiometers},
+        bin_left_position{0}, bin_right_position{0},
+        turntable_offset{0}
 
     {
+        for (auto &estimator : velocity_estimators)
+            estimator.setBandwidth(settings.velocity_bandwidth);
+        //NOTE the signs follow how each actuator is mounted, see write()
+        const std::pair<JointKalmanFilter::Settings, double> mounts[POTENTIOMETER_COUNT]{
+            {settings.arm_filter, -1}, {settings.arm_filter, 1},
+            {settings.arm_filter, 1}, {settings.bin_filter, -1},
+            {settings.bin_filter, -1}};
+        for (int i = 0; i < POTENTIOMETER_COUNT; i++)
+        {
+            JointKalmanFilter::Settings mounted = mounts[i].first;
+            mounted.input_gain *= mounts[i].second;
+            potentiometer_filters[i] = std::unique_ptr<JointKalmanFilter>{
+                new JointKalmanFilter{mounted}};
+        }
+        for (int i = 0; i < JOINT_COUNT; i++)
+        {
+            feedforward[i] = settings.feedforward[i];
+            position_loops[i].setGains(settings.position_gains[i], 1.0);
+            pwm_overrides[i] = std::nan("");
+        }
+        for (auto &smoothed : smoothed_potentiometers)
+            smoothed = std::nan("");
+
         // Note: the string parameters in these constructors must match the
         // joint names from the URDF, and yaml controller description. 
 
@@ -42,6 +74,7 @@ namespace tfr_control
         registerInterface(&joint_state_interface);
         registerInterface(&joint_effort_interface);
         registerInterface(&joint_position_interface);
+        registerInterface(&stream_health_interface);
     }
 
 
@@ -57,52 +90,120 @@ namespace tfr_control
      * */
     void RobotInterface::read() 
     {
-        //Grab the neccessary data
-        tfr_msgs::ArduinoAReading reading_a;
-        tfr_msgs::ArduinoBReading reading_b;
-        if (latest_arduino_a != nullptr)
-            reading_a = *latest_arduino_a;
-        if (latest_arduino_b != nullptr)
-            reading_b = *latest_arduino_b;
+        //Grab the neccessary data, this snapshot is held for write() as well
+        bool fresh_a = backend->readArduinoA(reading_a);
+        bool fresh_b = backend->readArduinoB(reading_b);
+
+        double now = ros::Time::now().toSec();
+        bool stale_a = arduino_a_monitor.update(fresh_a, reading_a.seq,
+                reading_a.stamp, now);
+        bool stale_b = arduino_b_monitor.update(fresh_b, reading_b.seq,
+                reading_b.stamp, now);
+        if (stale_a)
+            ROS_WARN_THROTTLE(5.0, "Robot Interface: arduino_a is stale (%f s), holding arm",
+                    arduino_a_monitor.getAge());
+        if (stale_b)
+            ROS_WARN_THROTTLE(5.0, "Robot Interface: arduino_b is stale (%f s)",
+                    arduino_b_monitor.getAge());
+
+        if (zero_turntable_requested.exchange(false))
+            turntable_offset = -reading_a.arm_turntable_pos;
+
+        //the potentiometer driven joints only move when a new reading comes
+        //in, so that's the only time we step their velocity estimates
+        if (stale_a)
+        {
+            for (auto &estimator : velocity_estimators)
+                estimator.reset();
+            for (auto &filter : potentiometer_filters)
+                filter->reset();
+            for (auto &smoothed : smoothed_potentiometers)
+                smoothed = std::nan("");
+        }
+        else if (fresh_a)
+        {
+            if (!filter_potentiometers)
+                smoothPotentiometers();
+            //turntable is estimated before the offset so zeroing it is not a jump
+            estimateVelocity(Joint::TURNTABLE, reading_a.arm_turntable_pos, reading_a.stamp);
+            estimateVelocity(Joint::LOWER_ARM, reading_a.arm_lower_pos, reading_a.stamp);
+            estimateVelocity(Joint::UPPER_ARM, reading_a.arm_upper_pos, reading_a.stamp);
+            estimateVelocity(Joint::SCOOP, reading_a.arm_scoop_pos, reading_a.stamp);
+            estimateVelocity(Joint::BIN,
+                    (reading_a.bin_left_pos + reading_a.bin_right_pos)/2, reading_a.stamp);
+        }
+
+        //the filters know what we drove the joints with since the last
+        //reading, so they can be trusted to carry the position up to now
+        double lower_position = reading_a.arm_lower_pos;
+        double upper_position = reading_a.arm_upper_pos;
+        double scoop_position = reading_a.arm_scoop_pos;
+        bin_left_position = reading_a.bin_left_pos;
+        bin_right_position = reading_a.bin_right_pos;
+        bool filtered = filter_potentiometers && !stale_a;
+        if (filtered)
+        {
+            lower_position = filterPotentiometer(Potentiometer::LOWER_ARM,
+                    reading_a.arm_lower_pos, last_command.arm_lower, fresh_a, now);
+            upper_position = filterPotentiometer(Potentiometer::UPPER_ARM,
+                    reading_a.arm_upper_pos, last_command.arm_upper, fresh_a, now);
+            scoop_position = filterPotentiometer(Potentiometer::SCOOP,
+                    reading_a.arm_scoop_pos, last_command.arm_scoop, fresh_a, now);
+            bin_left_position = filterPotentiometer(Potentiometer::BIN_LEFT,
+                    reading_a.bin_left_pos, last_command.bin_left, fresh_a, now);
+            bin_right_position = filterPotentiometer(Potentiometer::BIN_RIGHT,
+                    reading_a.bin_right_pos, last_command.bin_right, fresh_a, now);
+        }
 
         //LEFT_TREAD
         position_values[static_cast<int>(Joint::LEFT_TREAD)] = 0;
-        velocity_values[static_cast<int>(Joint::LEFT_TREAD)] = -reading_a.tread_left_vel;
+        velocity_values[static_cast<int>(Joint::LEFT_TREAD)] =
+            stale_a ? 0 : -reading_a.tread_left_vel;
         effort_values[static_cast<int>(Joint::LEFT_TREAD)] = 0;
+        stale_values[static_cast<int>(Joint::LEFT_TREAD)] = stale_a;
 
         //RIGHT_TREAD
         position_values[static_cast<int>(Joint::RIGHT_TREAD)] = 0;
-        velocity_values[static_cast<int>(Joint::RIGHT_TREAD)] = reading_b.tread_right_vel;
+        velocity_values[static_cast<int>(Joint::RIGHT_TREAD)] =
+            stale_b ? 0 : reading_b.tread_right_vel;
         effort_values[static_cast<int>(Joint::RIGHT_TREAD)] = 0;
+        stale_values[static_cast<int>(Joint::RIGHT_TREAD)] = stale_b;
+
+        //TURNTABLE
+        position_values[static_cast<int>(Joint::TURNTABLE)] =
+            reading_a.arm_turntable_pos + turntable_offset;
+        velocity_values[static_cast<int>(Joint::TURNTABLE)] =
+            velocity_estimators[static_cast<int>(Joint::TURNTABLE)].getVelocity();
+        effort_values[static_cast<int>(Joint::TURNTABLE)] = 0;
+
+        //LOWER_ARM
+        position_values[static_cast<int>(Joint::LOWER_ARM)] = lower_position;
+        velocity_values[static_cast<int>(Joint::LOWER_ARM)] = filtered ?
+            potentiometer_filters[static_cast<int>(Potentiometer::LOWER_ARM)]->getVelocity() :
+            velocity_estimators[static_cast<int>(Joint::LOWER_ARM)].getVelocity();
+        effort_values[static_cast<int>(Joint::LOWER_ARM)] = 0;
+
+        //UPPER_ARM
+        position_values[static_cast<int>(Joint::UPPER_ARM)] = upper_position;
+        velocity_values[static_cast<int>(Joint::UPPER_ARM)] = filtered ?
+            potentiometer_filters[static_cast<int>(Potentiometer::UPPER_ARM)]->getVelocity() :
+            velocity_estimators[static_cast<int>(Joint::UPPER_ARM)].getVelocity();
+        effort_values[static_cast<int>(Joint::UPPER_ARM)] = 0;
+
+        //SCOOP
+        position_values[static_cast<int>(Joint::SCOOP)] = scoop_position;
+        velocity_values[static_cast<int>(Joint::SCOOP)] = filtered ?
+            potentiometer_filters[static_cast<int>(Potentiometer::SCOOP)]->getVelocity() :
+            velocity_estimators[static_cast<int>(Joint::SCOOP)].getVelocity();
+        effort_values[static_cast<int>(Joint::SCOOP)] = 0;
 
-        if (!use_fake_values)
-        {
-            //TURNTABLE
-            position_values[static_cast<int>(Joint::TURNTABLE)] =
-                reading_a.arm_turntable_pos + turntable_offset;
-            velocity_values[static_cast<int>(Joint::TURNTABLE)] = 0; 
-            effort_values[static_cast<int>(Joint::TURNTABLE)] = 0;
-
-            //LOWER_ARM
-            position_values[static_cast<int>(Joint::LOWER_ARM)] = reading_a.arm_lower_pos;
-            velocity_values[static_cast<int>(Joint::LOWER_ARM)] = 0;
-            effort_values[static_cast<int>(Joint::LOWER_ARM)] = 0;
-
-            //UPPER_ARM
-            position_values[static_cast<int>(Joint::UPPER_ARM)] = reading_a.arm_upper_pos;
-            velocity_values[static_cast<int>(Joint::UPPER_ARM)] = 0;
-            effort_values[static_cast<int>(Joint::UPPER_ARM)] = 0;
-
-            //SCOOP
-            position_values[static_cast<int>(Joint::SCOOP)] = reading_a.arm_scoop_pos;
-            velocity_values[static_cast<int>(Joint::SCOOP)] = 0;
-            effort_values[static_cast<int>(Joint::SCOOP)] = 0;
-        }
- 
         //BIN
         position_values[static_cast<int>(Joint::BIN)] = 
-            (reading_a.bin_left_pos + reading_a.bin_right_pos)/2;
-        velocity_values[static_cast<int>(Joint::BIN)] = 0;
+            (bin_left_position + bin_right_position)/2;
+        velocity_values[static_cast<int>(Joint::BIN)] = filtered ?
+            (potentiometer_filters[static_cast<int>(Potentiometer::BIN_LEFT)]->getVelocity() +
+             potentiometer_filters[static_cast<int>(Potentiometer::BIN_RIGHT)]->getVelocity())/2 :
+            velocity_estimators[static_cast<int>(Joint::BIN)].getVelocity();
         effort_values[static_cast<int>(Joint::BIN)] = 0;
 
     }
@@ -119,77 +220,93 @@ namespace tfr_control
      * */
     void RobotInterface::write() 
     {
-        //Grab the neccessary data
-        tfr_msgs::ArduinoAReading reading_a;
-        tfr_msgs::ArduinoBReading reading_b;
-
         //package for outgoing data
         tfr_msgs::PwmCommand command;
-        if (latest_arduino_a != nullptr)
-            reading_a = *latest_arduino_a;
 
         double signal;
-        if (use_fake_values) //test code  for working with rviz simulator
-        {
-            adjustFakeJoint(Joint::TURNTABLE);
-            adjustFakeJoint(Joint::LOWER_ARM);
-            adjustFakeJoint(Joint::UPPER_ARM);
-            adjustFakeJoint(Joint::SCOOP);
+        ros::Time now = ros::Time::now();
+        double dt = std::min(std::max((now - last_update).toSec(), 0.0), 0.1);
 
-        }
-        else  // we are working with the real arm
-        {
-            //TURNTABLE
-            signal = turntableAngleToPWM(command_values[static_cast<int>(Joint::TURNTABLE)],
-                        position_values[static_cast<int>(Joint::TURNTABLE)]);
-            command.arm_turntable = signal;
+        //the arm integrators can't do anything useful while the arm can't move
+        if (!enabled || arduino_a_monitor.isStale())
+            for (auto &loop : position_loops)
+                loop.reset();
 
+        //TURNTABLE
+        signal = jointToPWM(Joint::TURNTABLE,
+                    command_values[static_cast<int>(Joint::TURNTABLE)],
+                    position_values[static_cast<int>(Joint::TURNTABLE)], dt);
+        command.arm_turntable = signal;
 
+        //LOWER_ARM
+        signal = jointToPWM(Joint::LOWER_ARM,
+                    command_values[static_cast<int>(Joint::LOWER_ARM)],
+                    position_values[static_cast<int>(Joint::LOWER_ARM)], dt);
+        command.arm_lower = signal;
 
-            //LOWER_ARM
-            //NOTE we reverse these because actuator is mounted backwards
-            signal = -angleToPWM(command_values[static_cast<int>(Joint::LOWER_ARM)],
-                        position_values[static_cast<int>(Joint::LOWER_ARM)]);
-            command.arm_lower = signal;
-
-
-            //UPPER_ARM
-            signal = angleToPWM(command_values[static_cast<int>(Joint::UPPER_ARM)],
-                        position_values[static_cast<int>(Joint::UPPER_ARM)]);
-            command.arm_upper = signal;
-
-
-            //SCOOP
-            signal = angleToPWM(command_values[static_cast<int>(Joint::SCOOP)],
-                        position_values[static_cast<int>(Joint::SCOOP)]);
-            command.arm_scoop = signal;
+        //UPPER_ARM
+        signal = jointToPWM(Joint::UPPER_ARM,
+                    command_values[static_cast<int>(Joint::UPPER_ARM)],
+                    position_values[static_cast<int>(Joint::UPPER_ARM)], dt);
+        command.arm_upper = signal;
 
-         }
+        //SCOOP
+        signal = jointToPWM(Joint::SCOOP,
+                    command_values[static_cast<int>(Joint::SCOOP)],
+                    position_values[static_cast<int>(Joint::SCOOP)], dt);
+        command.arm_scoop = signal;
+
+        //the treads are open loop, so we shape the velocity we ask for
+        //instead, a disabled drivebase starts again from rest
+        if (!enabled)
+        {
+            left_tread_limiter.reset();
+            right_tread_limiter.reset();
+        }
+        //the bin integrators can't do anything useful while the bin can't move
+        if (!enabled || arduino_a_monitor.isStale())
+            bin_controller.reset();
 
         //LEFT_TREAD
-        signal = -drivebaseVelocityToPWM(command_values[static_cast<int>(Joint::LEFT_TREAD)], drivebase_v0.first);
+        signal = -drivebaseVelocityToPWM(left_tread_limiter.update(
+                    command_values[static_cast<int>(Joint::LEFT_TREAD)], dt));
         command.tread_left = signal;
 
         //RIGHT_TREAD
-        signal = drivebaseVelocityToPWM(command_values[static_cast<int>(Joint::RIGHT_TREAD)],
-                    drivebase_v0.second);
+        signal = drivebaseVelocityToPWM(right_tread_limiter.update(
+                    command_values[static_cast<int>(Joint::RIGHT_TREAD)], dt));
         command.tread_right = signal;
 
 
         //BIN
         auto twin_signal = twinAngleToPWM(command_values[static_cast<int>(Joint::BIN)],
-                    reading_a.bin_left_pos,
-                    reading_a.bin_right_pos);
+                    bin_left_position,
+                    bin_right_position, dt);
         command.bin_left = twin_signal.first;
         command.bin_right = twin_signal.second;
 
+        //without fresh feedback the position loops would drive blind
+        if (arduino_a_monitor.isStale())
+        {
+            command.arm_turntable = 0;
+            command.arm_lower = 0;
+            command.arm_upper = 0;
+            command.arm_scoop = 0;
+            command.bin_left = 0;
+            command.bin_right = 0;
+        }
+
         command.enabled = enabled;
-        pwm_publisher.publish(command);
+        //everything is commanded on its own, here's where we make it all fit
+        current_budget.limit(command);
+        backend->write(command);
+        //the filters need to know what the motors actually ran on
+        last_command = command;
+        if (!enabled)
+            last_command = tfr_msgs::PwmCommand{};
         
         //UPKEEP
-        last_update = ros::Time::now();
-        drivebase_v0.first = velocity_values[static_cast<int>(Joint::LEFT_TREAD)];
-        drivebase_v0.second = velocity_values[static_cast<int>(Joint::RIGHT_TREAD)];
+        last_update = now;
     }
 
     void RobotInterface::setEnabled(bool val)
@@ -197,19 +314,6 @@ namespace tfr_control
         enabled = val;
     }
 
-    void RobotInterface::adjustFakeJoint(const Joint &j)
-    {
-        int i = static_cast<int>(j);
-        position_values[i] = command_values[i];
-        // If this joint has limits, clamp the range down
-        if (std::abs(lower_limits[i]) >= 1E-3 || std::abs(upper_limits[i]) >= 1E-3) 
-        {
-            position_values[i] =
-                std::max(std::min(position_values[i],
-                            upper_limits[i]), lower_limits[i]);
-        }
-    }
-
     /*
      * Resets the commands to a safe neutral state
      * Tells the treads to stop moving, and the arm to hold position
@@ -248,6 +352,35 @@ namespace tfr_control
         return position_values[static_cast<int>(Joint::BIN)];
     }
 
+    /*
+     * Retrieves the state of a joint
+     * */
+    double RobotInterface::getJointPosition(const Joint &joint)
+    {
+        return position_values[static_cast<int>(joint)];
+    }
+
+    double RobotInterface::getJointVelocity(const Joint &joint)
+    {
+        return velocity_values[static_cast<int>(joint)];
+    }
+
+    void RobotInterface::setCommand(const Joint &joint, const double &value)
+    {
+        command_values[static_cast<int>(joint)] = value;
+    }
+
+    void RobotInterface::overridePWM(const Joint &joint, const double &pwm)
+    {
+        pwm_overrides[static_cast<int>(joint)] = pwm;
+    }
+
+    void RobotInterface::clearOverrides()
+    {
+        for (auto &pwm : pwm_overrides)
+            pwm = std::nan("");
+    }
+
     /*
      * Retrieved the state of the arm
      * */
@@ -274,6 +407,10 @@ namespace tfr_control
         //allow the joint to be commanded
         JointHandle handle(state_handle, &command_values[idx]);
         joint_effort_interface.registerHandle(handle);
+
+        //and say when its velocity can't be trusted
+        stream_health_interface.registerHandle(
+                StreamHealthHandle(name, &stale_values[idx]));
     }
 
     /*
@@ -309,6 +446,49 @@ namespace tfr_control
         joint_position_interface.registerHandle(handle);
     }
 
+    /*
+     * Autotuned joints run the PID loop their gains were checked with. The
+     * autotune found which way the pwm moves the joint, so the gains are
+     * already signed for how the actuator is mounted.
+     *
+     * Calibrated joints are driven at a velocity proportional to their
+     * error, through the pwm the table says gives that velocity. The table
+     * already accounts for the dead band and which way the actuator is
+     * mounted. Overrides from calibration win over everything.
+     * */
+    double RobotInterface::jointToPWM(const Joint &joint, const double &desired,
+            const double &actual, const double &dt)
+    {
+        int idx = static_cast<int>(joint);
+        if (!std::isnan(pwm_overrides[idx]))
+        {
+            position_loops[idx].reset();
+            return pwm_overrides[idx];
+        }
+
+        if (position_loops[idx].isTuned())
+            return position_loops[idx].update(desired - actual, dt);
+
+        if (feedforward[idx].isCalibrated())
+        {
+            double difference = desired - actual;
+            if (std::abs(difference) < feedforward_tolerance)
+                return 0;
+            return feedforward[idx].pwmFor(feedforward_gain * difference);
+        }
+
+        switch (joint)
+        {
+            case Joint::TURNTABLE:
+                return turntableAngleToPWM(desired, actual);
+            case Joint::LOWER_ARM:
+                //NOTE we reverse these because actuator is mounted backwards
+                return -angleToPWM(desired, actual);
+            default:
+                return angleToPWM(desired, actual);
+        }
+    }
+
     /*
      * Input is angle desired/measured and output is in raw pwm frequency.
      * */
@@ -331,44 +511,15 @@ namespace tfr_control
 
     /*
      * Input is angle desired/measured of a twin acutuator joint and output is
-     * in raw pwm frequency for both of them. The actuator further ahead get's
-     * scaled down.
+     * in raw pwm frequency for both of them. The synchronization itself is
+     * handled by the TwinActuatorController, see twin_actuator_controller.h
      * */
     std::pair<double,double> RobotInterface::twinAngleToPWM(const double &desired, 
-            const double &actual_left, const double &actual_right)
+            const double &actual_left, const double &actual_right, const double &dt)
     {
-        //we don't anticipate these changing very much keep at method level
-        double  total_angle_tolerance = 0.005,
-                individual_angle_tolerance = 0.01,
-                scaling_factor = .6, 
-                difference = desired - (actual_left + actual_right)/2;
-        if (std::abs(difference) > total_angle_tolerance)
-        {
-            int direction = (difference < 0) ? 1 : -1;
-            double delta = actual_left - actual_right;
-            double cmd_left = direction, cmd_right = direction;
-            if (std::abs(delta) > individual_angle_tolerance)
-            {
-                if (direction < 0)
-                {
-                    //extending
-                    if (actual_left > actual_right)
-                        cmd_left *= scaling_factor;
-                    else
-                        cmd_right *= scaling_factor;
-                }
-                else
-                {
-                    //retracting
-                    if (actual_left > actual_right)
-                        cmd_right *= scaling_factor;
-                    else
-                        cmd_left *= scaling_factor;
-                }
-            }
-            return std::make_pair(cmd_left, cmd_right);
-        }
-        return std::make_pair(0,0);
+        auto effort = bin_controller.update(desired, actual_left, actual_right, dt);
+        //NOTE negative pwm extends the actuators
+        return std::make_pair(-effort.first, -effort.second);
     }
     
     /*
@@ -393,60 +544,85 @@ namespace tfr_control
      * Takes in a velocity, and converts it to pwm for the drivebase.
      * Velocity is in meters per second, and output is in raw pwm frequency.
      * Scaled to match the values expected by pwm interface
-     * NOTE we have a safety limit here of 1 m/s^2 any more and it will snap a
-     * shaft
+     *
+     * The motors don't turn until the pwm overcomes friction, so the curve is
+     * linear from drivebase_min_pwm at rest to full pwm at drivebase_max_vel.
+     * NOTE the velocity passed in is already acceleration limited, any more
+     * than 1 m/s^2 and it will snap a shaft
      * */
-    double RobotInterface::drivebaseVelocityToPWM(const double& v_1, const double& v_0)
+    double RobotInterface::drivebaseVelocityToPWM(const double& velocity)
     {
-        //limit for max velocity
-        //we don't anticipate this changing very much keep at method level
-        double max_vel = 0.5;
-        if (v_1 > 0.05 || v_1 < -0.05)
-        {
-            int sign = (v_1 < 0) ? -1 : 1;
-            //double magnitude = std::min(std::abs(v_1)/max_vel, 0.9);
-            double magnitude = 1;
-            return sign * magnitude;
-        }
-        return 0;
+        if (std::abs(velocity) < drivebase_deadband)
+            return 0;
+        int sign = (velocity < 0) ? -1 : 1;
+        double magnitude = drivebase_min_pwm +
+            (1 - drivebase_min_pwm) * std::abs(velocity) / drivebase_max_vel;
+        return sign * std::min(magnitude, 1.0);
     }
 
-    /*
-     * Prevents large pwm changes to avoid brown out
-     * */
-    double RobotInterface::scalePWM(const double& pwm_1, const double& pwm_0)
+    double RobotInterface::estimateVelocity(const Joint &joint,
+            const double &position, const double &stamp)
     {
-        double sign = ((pwm_1 - pwm_0) > 0) ? 1 : -1;
-        double magnitude = std::min(std::abs(pwm_1-pwm_0), 0.01);
-        return pwm_0 + sign * magnitude;
+        return velocity_estimators[static_cast<int>(joint)].update(position, stamp);
     }
 
     /*
-     * Callback for our encoder subscriber
+     * The same exponential smoothing the firmware did before the filters,
+     * the reading held between fresh ones keeps the smoothed values
      * */
-    void RobotInterface::readArduinoA(const tfr_msgs::ArduinoAReadingConstPtr &msg)
+    void RobotInterface::smoothPotentiometers()
     {
-        latest_arduino_a = msg;
+        //how much we trust the estimate vs the newest reading, 4 was the
+        //firmware's middle ground between noise and lag
+        const double trust = 4;
+        double *readings[POTENTIOMETER_COUNT]{&reading_a.arm_lower_pos,
+            &reading_a.arm_upper_pos, &reading_a.arm_scoop_pos,
+            &reading_a.bin_left_pos, &reading_a.bin_right_pos};
+        for (int i = 0; i < POTENTIOMETER_COUNT; i++)
+        {
+            double &smoothed = smoothed_potentiometers[i];
+            smoothed = std::isnan(smoothed) ? *readings[i] :
+                smoothed + (*readings[i] - smoothed) / trust;
+            *readings[i] = smoothed;
+        }
+    }
+
+    double RobotInterface::filterPotentiometer(const Potentiometer &pot,
+            const double &measured, const double &pwm, bool fresh, const double &now)
+    {
+        JointKalmanFilter &filter = *potentiometer_filters[static_cast<int>(pot)];
+        if (fresh)
+            filter.update(measured, reading_a.stamp, pwm);
+        return filter.predictPosition(now);
+    }
+
+    const tfr_utilities::StreamMonitor& RobotInterface::getArduinoAMonitor() const
+    {
+        return arduino_a_monitor;
+    }
+
+    const tfr_utilities::StreamMonitor& RobotInterface::getArduinoBMonitor() const
+    {
+        return arduino_b_monitor;
     }
 
     /*
-     * Callback for our encoder subscriber
+     * The offset is owned by the control loop, so we just flag it here and
+     * let read() apply it to the next snapshot
      * */
-    void RobotInterface::readArduinoB(const tfr_msgs::ArduinoBReadingConstPtr &msg)
+    void RobotInterface::zeroTurntable()
     {
-        latest_arduino_b = msg;
+        zero_turntable_requested = true;
     }
 
-    void RobotInterface::zeroTurntable()
+
+    const CurrentBudget& RobotInterface::getCurrentBudget() const
     {
-        //Grab the neccessary data
-        tfr_msgs::ArduinoAReading reading_a;
-        if (latest_arduino_a != nullptr)
-            reading_a = *latest_arduino_a;
-        else 
-            return;
-
-        turntable_offset = -reading_a.arm_turntable_pos; 
+        return current_budget;
     }
 
+    JointKalmanFilter::Innovations RobotInterface::takeInnovations(const Potentiometer &pot)
+    {
+        return potentiometer_filters[static_cast<int>(pot)]->takeInnovations();
+    }
 }
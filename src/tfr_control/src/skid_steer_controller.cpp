@@ -0,0 +1,401 @@
+/****************************************************************************************
+ * File:            skid_steer_controller.cpp
+ *
+ * Purpose:         This is the implementation file for the SkidSteerController
+ *                  class. See tfr_control/include/tfr_control/skid_steer_controller.h
+ *                  for details.
+ ***************************************************************************************/
+#include "skid_steer_controller.h"
+#include "param_overlay.h"
+#include <pluginlib/class_list_macros.h>
+#include <algorithm>
+#include <set>
+#include <cmath>
+
+namespace tfr_control
+{
+    constexpr double SkidSteerController::MAX_XY_DELTA;
+    constexpr double SkidSteerController::MAX_YAW_DELTA;
+
+    SkidSteerController::SkidSteerController() :
+        wheel_span{0}, odometry_wheel_span{0}, stop_hold{0}, max_tuned_velocity{0},
+        x{0}, y{0}, yaw{0}, owner{-1}, published_owner{-1}
+    {}
+
+    bool SkidSteerController::init(hardware_interface::RobotHW *hw,
+            ros::NodeHandle &root, ros::NodeHandle &n)
+    {
+        std::string left_joint, right_joint;
+        n.param<std::string>("left_joint", left_joint, "left_tread_joint");
+        n.param<std::string>("right_joint", right_joint, "right_tread_joint");
+        n.param<double>("wheel_span", wheel_span, 0.55);
+        n.param<double>("odometry_wheel_span", odometry_wheel_span, wheel_span);
+        n.param<double>("stop_hold", stop_hold, 0.5);
+        n.param<double>("max_tuned_velocity", max_tuned_velocity, 0.5);
+        n.param<std::string>("parent_frame", parent_frame, "odom");
+        n.param<std::string>("child_frame", child_frame, "base_footprint");
+        double publish_rate;
+        n.param<double>("publish_rate", publish_rate, 50.0);
+        if (wheel_span <= 0 || odometry_wheel_span <= 0 || publish_rate <= 0)
+        {
+            ROS_ERROR("Skid Steer Controller: wheel spans and publish_rate must be positive");
+            return false;
+        }
+        if (stop_hold < 0)
+        {
+            ROS_ERROR("Skid Steer Controller: stop_hold can't be negative");
+            return false;
+        }
+        if (max_tuned_velocity <= 0)
+        {
+            ROS_ERROR("Skid Steer Controller: max_tuned_velocity must be positive");
+            return false;
+        }
+        //gains saved by the autotune go over the shipped ones
+        std::string autotune_file;
+        if (n.getParam("autotune_file", autotune_file))
+            loadParamOverlay(autotune_file, n.resolveName("autotune"));
+        for (auto tread : {std::make_pair(left_joint, &left_loop),
+                std::make_pair(right_joint, &right_loop)})
+        {
+            TunedPid::Gains gains;
+            if (!TunedPid::load(n, tread.first, gains))
+                continue;
+            tread.second->setGains(gains, max_tuned_velocity);
+            ROS_INFO("Skid Steer Controller: %s runs on autotuned gains p %f i %f d %f",
+                    tread.first.c_str(), gains.p, gains.i, gains.d);
+        }
+        publish_period = ros::Duration(1 / publish_rate);
+
+        try
+        {
+            auto *treads = hw->get<hardware_interface::EffortJointInterface>();
+            auto *health = hw->get<StreamHealthInterface>();
+            left_tread = treads->getHandle(left_joint);
+            right_tread = treads->getHandle(right_joint);
+            left_health = health->getHandle(left_joint);
+            right_health = health->getHandle(right_joint);
+        }
+        catch (const hardware_interface::HardwareInterfaceException &e)
+        {
+            ROS_ERROR("Skid Steer Controller: %s", e.what());
+            return false;
+        }
+
+        if (!loadSources(root, n))
+            return false;
+        pose_request.writeFromNonRT(PoseRequest{0, 0, 0, false, false});
+        odometry_publisher.reset(new realtime_tools::RealtimePublisher<nav_msgs::Odometry>(
+                    root, "drivebase_odom", 15));
+        owner_publisher.reset(new realtime_tools::RealtimePublisher<std_msgs::String>(
+                    root, "cmd_vel_owner", 1, true));
+        set_odometry = root.advertiseService("set_drivebase_odometry",
+                &SkidSteerController::setOdometry, this);
+        reset_odometry = root.advertiseService("reset_drivebase_odometry",
+                &SkidSteerController::resetOdometry, this);
+        return true;
+    }
+
+    void SkidSteerController::starting(const ros::Time &time)
+    {
+        //don't drive off on a twist from before we were started
+        for (auto &source : sources)
+            source->command.initRT(Command{0, 0, ros::Time(0)});
+        owner = -1;
+        owned_since = time;
+        left_loop.reset();
+        right_loop.reset();
+        //make sure the first update says who owns the treads
+        published_owner = -2;
+        last_publish = time;
+    }
+
+    void SkidSteerController::update(const ros::Time &time, const ros::Duration &period)
+    {
+        applyPoseRequest();
+
+        //odometry from what the treads did since the last read, a stale
+        //tread reads as still
+        bool stale = left_health.isStale() || right_health.isStale();
+        if (stale)
+            ROS_WARN_THROTTLE(5.0, "Skid Steer Controller: stale tread velocity, left %s right %s",
+                    left_health.isStale() ? "stale" : "ok",
+                    right_health.isStale() ? "stale" : "ok");
+        double v_left = left_tread.getVelocity();
+        double v_right = right_tread.getVelocity();
+        double linear = (v_right + v_left) / 2;
+        double angular = (v_right - v_left) / odometry_wheel_span;
+        double dt = period.toSec();
+        //integrate along the heading halfway through the turn
+        double heading = yaw + angular * dt / 2;
+        x += linear * std::cos(heading) * dt;
+        y += linear * std::sin(heading) * dt;
+        yaw = std::remainder(yaw + angular * dt, 2 * M_PI);
+        if (time - last_publish >= publish_period)
+        {
+            publishOdometry(time, linear, angular, stale);
+            last_publish = time;
+        }
+
+        //then drive the treads with the highest priority live command
+        Command twist{0, 0, ros::Time(0)};
+        int live = -1;
+        for (size_t i = 0; i < sources.size(); i++)
+        {
+            const Command &latest = *sources[i]->command.readFromRT();
+            if (isLive(*sources[i], latest, time))
+            {
+                twist = latest;
+                live = i;
+                break;
+            }
+        }
+        if (live != owner)
+        {
+            owner = live;
+            owned_since = time;
+        }
+        dropMasked();
+        publishOwner();
+        bool stopped = owner < 0;
+        driveTread(left_tread, left_loop, twist.linear - wheel_span * twist.angular / 2,
+                stopped, left_health.isStale(), dt);
+        driveTread(right_tread, right_loop, twist.linear + wheel_span * twist.angular / 2,
+                stopped, right_health.isStale(), dt);
+    }
+
+    void SkidSteerController::stopping(const ros::Time &time)
+    {
+        left_tread.setCommand(0);
+        right_tread.setCommand(0);
+    }
+
+    /*
+     * Untuned treads are commanded the velocity they should go, tuned ones
+     * what their loop asks for to get there. With nobody driving, the loops
+     * let go instead of holding the treads at zero, and without a current
+     * velocity to close the loop on they're driven like untuned ones.
+     * */
+    void SkidSteerController::driveTread(hardware_interface::JointHandle &tread,
+            TunedPid &loop, const double &velocity, bool stopped, bool stale,
+            const double &dt)
+    {
+        if (!loop.isTuned() || stale)
+        {
+            loop.reset();
+            tread.setCommand(velocity);
+            return;
+        }
+        if (stopped)
+        {
+            loop.reset();
+            tread.setCommand(0);
+            return;
+        }
+        tread.setCommand(loop.update(velocity - tread.getVelocity(), dt));
+    }
+
+    /*
+     * Reads the sources map, each entry needs a topic, a unique priority and
+     * a timeout
+     * */
+    bool SkidSteerController::loadSources(ros::NodeHandle &root, ros::NodeHandle &n)
+    {
+        XmlRpc::XmlRpcValue config;
+        if (!n.getParam("sources", config) ||
+                config.getType() != XmlRpc::XmlRpcValue::TypeStruct || config.size() == 0)
+        {
+            ROS_ERROR("Skid Steer Controller: sources must map source names to their settings");
+            return false;
+        }
+
+        std::set<int> priorities;
+        for (auto entry = config.begin(); entry != config.end(); ++entry)
+        {
+            std::unique_ptr<Source> source{new Source};
+            source->name = entry->first;
+            ros::NodeHandle settings{n, "sources/" + source->name};
+            std::string topic;
+            if (!settings.getParam("topic", topic) ||
+                    !settings.getParam("priority", source->priority))
+            {
+                ROS_ERROR("Skid Steer Controller: source %s needs a topic and a priority",
+                        source->name.c_str());
+                return false;
+            }
+            if (!settings.getParam("timeout", source->timeout) || source->timeout <= 0)
+            {
+                ROS_ERROR("Skid Steer Controller: source %s needs a positive timeout",
+                        source->name.c_str());
+                return false;
+            }
+            if (!priorities.insert(source->priority).second)
+            {
+                ROS_ERROR("Skid Steer Controller: source %s shares its priority",
+                        source->name.c_str());
+                return false;
+            }
+
+            source->command.writeFromNonRT(Command{0, 0, ros::Time(0)});
+            //only the latest twist matters, never let old ones queue up
+            source->subscriber = root.subscribe<geometry_msgs::Twist>(topic, 1,
+                    boost::bind(&SkidSteerController::cmdVelCallback, this, _1, source.get()),
+                    ros::VoidConstPtr(), ros::TransportHints().tcpNoDelay());
+            sources.push_back(std::move(source));
+        }
+        std::sort(sources.begin(), sources.end(),
+                [](const std::unique_ptr<Source> &a, const std::unique_ptr<Source> &b)
+                {
+                    return a->priority > b->priority;
+                });
+        return true;
+    }
+
+    void SkidSteerController::cmdVelCallback(const geometry_msgs::Twist::ConstPtr &msg,
+            Source *source)
+    {
+        if (!std::isfinite(msg->linear.x) || !std::isfinite(msg->angular.z))
+        {
+            ROS_WARN_THROTTLE(1.0, "Skid Steer Controller: ignoring a non finite twist from %s",
+                    source->name.c_str());
+            return;
+        }
+        source->command.writeFromNonRT(Command{msg->linear.x, msg->angular.z, ros::Time::now()});
+    }
+
+    bool SkidSteerController::isLive(const Source &source, const Command &twist,
+            const ros::Time &time) const
+    {
+        if (twist.stamp.isZero())
+            return false;
+        double age = (time - twist.stamp).toSec();
+        if (twist.linear == 0 && twist.angular == 0)
+            return age < stop_hold;
+        return age < source.timeout;
+    }
+
+    /*
+     * A command a lower priority source sent before the owner took over was
+     * meant for before, it mustn't come back once the owner lets go. Only
+     * commands sent since then may.
+     * */
+    void SkidSteerController::dropMasked()
+    {
+        if (owner < 0)
+            return;
+        for (size_t i = owner + 1; i < sources.size(); i++)
+        {
+            Command *masked = sources[i]->command.readFromRT();
+            if (!masked->stamp.isZero() && masked->stamp < owned_since)
+                masked->stamp = ros::Time(0);
+        }
+    }
+
+    /*
+     * Only when the owner changes, if the publisher is busy we try again
+     * next update
+     * */
+    void SkidSteerController::publishOwner()
+    {
+        if (owner == published_owner || !owner_publisher->trylock())
+            return;
+        owner_publisher->msg_.data = owner < 0 ? "none" : sources[owner]->name;
+        owner_publisher->unlockAndPublish();
+        published_owner = owner;
+    }
+
+    bool SkidSteerController::setOdometry(tfr_msgs::SetOdometry::Request &request,
+            tfr_msgs::SetOdometry::Response &response)
+    {
+        pose_request.writeFromNonRT(PoseRequest{request.pose.position.x,
+                request.pose.position.y, yawOf(request.pose.orientation), true, true});
+        return true;
+    }
+
+    bool SkidSteerController::resetOdometry(tfr_msgs::SetOdometry::Request &request,
+            tfr_msgs::SetOdometry::Response &response)
+    {
+        ROS_INFO("Skid Steer Controller: resetting drivebase odometry");
+        pose_request.writeFromNonRT(PoseRequest{request.pose.position.x,
+                request.pose.position.y, yawOf(request.pose.orientation), false, true});
+        return true;
+    }
+
+    double SkidSteerController::yawOf(const geometry_msgs::Quaternion &q)
+    {
+        return std::atan2(2 * (q.w * q.z + q.x * q.y), 1 - 2 * (q.y * q.y + q.z * q.z));
+    }
+
+    /*
+     * Service callbacks only leave a request, the pose itself belongs to the
+     * control thread
+     * */
+    void SkidSteerController::applyPoseRequest()
+    {
+        PoseRequest *request = pose_request.readFromRT();
+        if (!request->pending)
+            return;
+        request->pending = false;
+
+        if (!request->smooth)
+        {
+            x = request->x;
+            y = request->y;
+            yaw = request->yaw;
+            return;
+        }
+        auto clamp = [](double value, double limit)
+        {
+            return std::max(-limit, std::min(value, limit));
+        };
+        x += clamp(request->x - x, MAX_XY_DELTA);
+        y += clamp(request->y - y, MAX_XY_DELTA);
+        yaw = std::remainder(yaw +
+                clamp(std::remainder(request->yaw - yaw, 2 * M_PI), MAX_YAW_DELTA),
+                2 * M_PI);
+    }
+
+    void SkidSteerController::publishOdometry(const ros::Time &time,
+            const double &linear, const double &angular, bool stale)
+    {
+        if (!odometry_publisher->trylock())
+            return;
+        nav_msgs::Odometry &msg = odometry_publisher->msg_;
+        msg.header.stamp = time;
+        msg.header.frame_id = parent_frame;
+        msg.child_frame_id = child_frame;
+
+        msg.pose.pose.position.x = x;
+        msg.pose.pose.position.y = y;
+        msg.pose.pose.position.z = 0;
+        msg.pose.pose.orientation.x = 0;
+        msg.pose.pose.orientation.y = 0;
+        msg.pose.pose.orientation.z = std::sin(yaw / 2);
+        msg.pose.pose.orientation.w = std::cos(yaw / 2);
+        msg.pose.covariance = { 1e-1,    0,    0,    0,    0,    0,
+            0, 1e-1,    0,    0,    0,    0,
+            0,    0, 1e-1,    0,    0,    0,
+            0,    0,    0, 1e-1,    0,    0,
+            0,    0,    0,    0, 1e-1,    0,
+            0,    0,    0,    0,    0, 1e-1 };
+
+        //same as the odometry node this replaces, twist in the parent frame,
+        //and when a tread is stale we don't really know how fast we're going
+        msg.twist.twist.linear.x = linear * std::cos(yaw);
+        msg.twist.twist.linear.y = linear * std::sin(yaw);
+        msg.twist.twist.linear.z = 0;
+        msg.twist.twist.angular.x = 0;
+        msg.twist.twist.angular.y = 0;
+        msg.twist.twist.angular.z = angular;
+        double twist_variance = stale ? 1e3 : 5e-2;
+        msg.twist.covariance = { twist_variance,    0,    0,    0,    0,    0,
+            0, twist_variance,    0,    0,    0,    0,
+            0,    0, twist_variance,    0,    0,    0,
+            0,    0,    0, twist_variance,    0,    0,
+            0,    0,    0,    0, twist_variance,    0,
+            0,    0,    0,    0,    0, twist_variance };
+        odometry_publisher->unlockAndPublish();
+    }
+}
+
+PLUGINLIB_EXPORT_CLASS(tfr_control::SkidSteerController, controller_interface::ControllerBase)
@@ -0,0 +1,74 @@
+/****************************************************************************************
+ * File:            twin_actuator_controller.cpp
+ *
+ * Purpose:         This is the implementation file for the TwinActuatorController
+ *                  class. See tfr_control/include/tfr_control/twin_actuator_controller.h
+ *                  for details.
+ ***************************************************************************************/
+#include "twin_actuator_controller.h"
+#include <algorithm>
+#include <cmath>
+
+namespace tfr_control
+{
+    TwinActuatorController::TwinActuatorController(const Settings &s) :
+        settings(s), average_integral{0}, differential_integral{0}
+    {}
+
+    std::pair<double, double> TwinActuatorController::update(const double &desired,
+            const double &left, const double &right, const double &dt)
+    {
+        double average_error = desired - (left + right) / 2;
+        double differential_error = left - right;
+        bool at_target = std::abs(average_error) < settings.tolerance;
+        bool in_sync = std::abs(differential_error) < settings.tolerance;
+        if (at_target && in_sync)
+        {
+            reset();
+            return std::make_pair(0.0, 0.0);
+        }
+
+        //the differential loop gets first call on the pwm
+        double differential = settings.differential_kp * differential_error +
+            settings.differential_ki * differential_integral;
+        double differential_limit = 1 - settings.min_pwm;
+        if (std::abs(differential) < differential_limit)
+            differential_integral += differential_error * dt;
+        differential = clamp(differential, differential_limit);
+        //holding at the target nothing else overcomes friction for us
+        if (at_target && std::abs(differential) < settings.min_pwm)
+            differential = (differential_error < 0) ? -settings.min_pwm : settings.min_pwm;
+
+        double average = 0;
+        if (!at_target)
+        {
+            //full speed far away, slowing linearly to min_pwm at the target
+            double ramp = settings.min_pwm + (1 - settings.min_pwm) *
+                std::abs(average_error) / settings.ramp_distance;
+            double limit = std::min({ramp, 1.0, 1 - std::abs(differential)});
+
+            average = settings.average_kp * average_error +
+                settings.average_ki * average_integral;
+            //only integrate while the output can still respond, no windup
+            if (std::abs(average) < limit)
+                average_integral += average_error * dt;
+            average = clamp(average, limit);
+        }
+        else
+            average_integral = 0;
+
+        //whichever side is ahead gets slowed down
+        return std::make_pair(average - differential, average + differential);
+    }
+
+    void TwinActuatorController::reset()
+    {
+        average_integral = 0;
+        differential_integral = 0;
+    }
+
+    double TwinActuatorController::clamp(const double &value, const double &limit)
+    {
+        return std::max(-limit, std::min(value, limit));
+    }
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "arm_kinematics.h"
+
+using tfr_control::ArmKinematics;
+
+namespace
+{
+    const double INCH = 0.0254;
+    const double SLACK = 1e-6;
+
+    //the arm in tfr_description, the tip out on the scoop's lip
+    ArmKinematics makeArm()
+    {
+        ArmKinematics::Geometry geometry{};
+        geometry.base_x = 25 * INCH - 4.92 * INCH;
+        geometry.base_z = 2 * INCH;
+        geometry.base_yaw = M_PI;
+        geometry.shoulder_x = -2.165 * INCH;
+        geometry.shoulder_z = 2.25 * INCH;
+        geometry.elbow_z = 22 * INCH;
+        geometry.wrist_x = 1.5 * INCH;
+        geometry.wrist_z = 20 * INCH - 0.875 * INCH;
+        geometry.tip_x = 12 * INCH;
+        geometry.tip_z = 3 * INCH;
+        return ArmKinematics{geometry, {-1.1 * M_PI, 0.104, 0.98, -1.16614},
+            {1.1 * M_PI, 1.55, 2.4, 1.62}};
+    }
+
+    void expectPose(const ArmKinematics::Pose &actual, const ArmKinematics::Pose &expected)
+    {
+        EXPECT_NEAR(actual.x, expected.x, SLACK);
+        EXPECT_NEAR(actual.y, expected.y, SLACK);
+        EXPECT_NEAR(actual.z, expected.z, SLACK);
+        EXPECT_NEAR(ArmKinematics::wrap(actual.yaw - expected.yaw), 0, SLACK);
+        EXPECT_NEAR(ArmKinematics::wrap(actual.pitch - expected.pitch), 0, SLACK);
+    }
+}
+
+/*
+ * Every pose forward() reaches comes back from inverse(), with the joints
+ * that reached it among the answers
+ * */
+TEST(ArmKinematics, RoundTrip)
+{
+    ArmKinematics arm = makeArm();
+    const int STEPS = 6;
+    int poses = 0;
+    for (int a = 0; a <= STEPS; a++)
+    for (int b = 0; b <= STEPS; b++)
+    for (int c = 0; c <= STEPS; c++)
+    for (int d = 0; d <= STEPS; d++)
+    {
+        ArmKinematics::Joints joints{
+            -1.1 * M_PI + 2.2 * M_PI * a / STEPS,
+            0.104 + (1.55 - 0.104) * b / STEPS,
+            0.98 + (2.4 - 0.98) * c / STEPS,
+            -1.16614 + (1.62 + 1.16614) * d / STEPS};
+        ArmKinematics::Pose pose = arm.forward(joints);
+        std::vector<ArmKinematics::Joints> solutions = arm.inverse(pose);
+        ASSERT_FALSE(solutions.empty());
+
+        bool found = false;
+        for (const auto &solution : solutions)
+        {
+            expectPose(arm.forward(solution), pose);
+            bool same = std::abs(solution[0] - joints[0]) < SLACK;
+            for (size_t j = 1; j < joints.size(); j++)
+                same = same && std::abs(solution[j] - joints[j]) < SLACK;
+            found = found || same;
+        }
+        EXPECT_TRUE(found) << joints[0] << " " << joints[1] << " "
+            << joints[2] << " " << joints[3];
+        poses++;
+    }
+    EXPECT_EQ(poses, 7 * 7 * 7 * 7);
+}
+
+TEST(ArmKinematics, OutOfReach)
+{
+    ArmKinematics arm = makeArm();
+    ArmKinematics::Pose pose = arm.forward({0, 0.8, 1.5, 0});
+    double heading = std::atan2(pose.y - arm.getGeometry().base_y,
+            pose.x - arm.getGeometry().base_x);
+    //pushed three meters further out along the arm's plane
+    pose.x += 3 * std::cos(heading);
+    pose.y += 3 * std::sin(heading);
+    EXPECT_TRUE(arm.inverse(pose).empty());
+}
+
+TEST(ArmKinematics, OffPlane)
+{
+    ArmKinematics arm = makeArm();
+    ArmKinematics::Pose pose = arm.forward({0.3, 0.8, 1.5, 0});
+    //the arm can't reach sideways out of its plane
+    pose.x += 0.05 * std::sin(pose.yaw);
+    pose.y -= 0.05 * std::cos(pose.yaw);
+    EXPECT_TRUE(arm.inverse(pose).empty());
+}
+
+TEST(ArmKinematics, Wrap)
+{
+    EXPECT_NEAR(ArmKinematics::wrap(3 * M_PI), M_PI, SLACK);
+    EXPECT_NEAR(ArmKinematics::wrap(-M_PI / 2 - 4 * M_PI), -M_PI / 2, SLACK);
+    EXPECT_NEAR(ArmKinematics::wrap(0.5), 0.5, SLACK);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "current_budget.h"
+
+using tfr_control::CurrentBudget;
+
+namespace
+{
+    //treads first, then the arm, then the bin, 10 A each at full pwm
+    CurrentBudget::Settings settings(double budget)
+    {
+        CurrentBudget::Settings power{};
+        power.budget = budget;
+        for (int i = 0; i < CurrentBudget::MOTOR_COUNT; i++)
+        {
+            power.stall_current[i] = 10;
+            power.min_pwm[i] = 0.2;
+        }
+        power.priority[CurrentBudget::TREAD_LEFT] = 0;
+        power.priority[CurrentBudget::TREAD_RIGHT] = 0;
+        power.priority[CurrentBudget::TURNTABLE] = 1;
+        power.priority[CurrentBudget::ARM_LOWER] = 1;
+        power.priority[CurrentBudget::ARM_UPPER] = 1;
+        power.priority[CurrentBudget::ARM_SCOOP] = 1;
+        power.priority[CurrentBudget::BIN_LEFT] = 2;
+        power.priority[CurrentBudget::BIN_RIGHT] = 2;
+        return power;
+    }
+
+    tfr_msgs::PwmCommand enabled()
+    {
+        tfr_msgs::PwmCommand command{};
+        command.enabled = true;
+        return command;
+    }
+}
+
+TEST(CurrentBudget, Fits)
+{
+    CurrentBudget budget{settings(100)};
+    tfr_msgs::PwmCommand command = enabled();
+    command.tread_left = -1;
+    command.tread_right = 1;
+    command.arm_lower = 0.5;
+    budget.limit(command);
+    EXPECT_FLOAT_EQ(command.tread_left, -1);
+    EXPECT_FLOAT_EQ(command.tread_right, 1);
+    EXPECT_FLOAT_EQ(command.arm_lower, 0.5);
+    EXPECT_DOUBLE_EQ(budget.getDemand(), 25);
+    EXPECT_EQ(budget.getLimitedCycles(), 0u);
+}
+
+TEST(CurrentBudget, ScalesGroupTogether)
+{
+    CurrentBudget budget{settings(25)};
+    tfr_msgs::PwmCommand command = enabled();
+    command.tread_left = 1;
+    command.tread_right = 1;
+    command.arm_lower = 0.5;
+    command.arm_upper = -0.5;
+    budget.limit(command);
+    EXPECT_FLOAT_EQ(command.tread_left, 1);
+    EXPECT_FLOAT_EQ(command.tread_right, 1);
+    //5 A left for 10 A asked
+    EXPECT_FLOAT_EQ(command.arm_lower, 0.25);
+    EXPECT_FLOAT_EQ(command.arm_upper, -0.25);
+    EXPECT_EQ(budget.getLimitedCycles(), 1u);
+}
+
+TEST(CurrentBudget, CutsStalledMotors)
+{
+    CurrentBudget budget{settings(23)};
+    tfr_msgs::PwmCommand command = enabled();
+    command.tread_left = 1;
+    command.tread_right = 1;
+    command.arm_lower = 0.5;
+    command.arm_scoop = 0.3;
+    budget.limit(command);
+    //3 A for 8 A would put the scoop at 0.11, under what moves it, so it's
+    //cut and the lower arm gets all of it
+    EXPECT_FLOAT_EQ(command.arm_scoop, 0);
+    EXPECT_FLOAT_EQ(command.arm_lower, 0.3);
+    EXPECT_DOUBLE_EQ(budget.getAllocated(), 23);
+}
+
+TEST(CurrentBudget, FreedCurrentGoesOn)
+{
+    CurrentBudget::Settings power = settings(21.5);
+    power.stall_current[CurrentBudget::BIN_LEFT] = 2;
+    power.stall_current[CurrentBudget::BIN_RIGHT] = 2;
+    CurrentBudget budget{power};
+    tfr_msgs::PwmCommand command = enabled();
+    command.tread_left = 1;
+    command.tread_right = 1;
+    command.arm_lower = 0.5;
+    command.bin_left = 0.3;
+    command.bin_right = 0.3;
+    budget.limit(command);
+    //1.5 A can't move the lower arm, but it's enough for the bin
+    EXPECT_FLOAT_EQ(command.arm_lower, 0);
+    EXPECT_FLOAT_EQ(command.bin_left, 0.3);
+    EXPECT_FLOAT_EQ(command.bin_right, 0.3);
+}
+
+TEST(CurrentBudget, NeverUnderMinimum)
+{
+    for (double amps : {2.0, 6.0, 9.0, 11.0})
+    {
+        CurrentBudget budget{settings(amps)};
+        tfr_msgs::PwmCommand command = enabled();
+        command.tread_left = 0.9;
+        command.tread_right = 0.3;
+        command.bin_left = 0.5;
+        command.bin_right = 0.25;
+        budget.limit(command);
+        for (float pwm : {command.tread_left, command.tread_right,
+                command.bin_left, command.bin_right})
+            EXPECT_TRUE(pwm == 0 || std::abs(pwm) >= 0.2) << amps << " A: " << pwm;
+        //a twin is never left running on its own
+        EXPECT_EQ(command.tread_left == 0, command.tread_right == 0) << amps << " A";
+        EXPECT_EQ(command.bin_left == 0, command.bin_right == 0) << amps << " A";
+        double drawn = 10 * (std::abs(command.tread_left) + std::abs(command.tread_right) +
+                std::abs(command.bin_left) + std::abs(command.bin_right));
+        EXPECT_LE(drawn, amps + 1e-6) << amps << " A";
+    }
+}
+
+TEST(CurrentBudget, Disabled)
+{
+    CurrentBudget budget{settings(1)};
+    tfr_msgs::PwmCommand command{};
+    command.tread_left = 1;
+    budget.limit(command);
+    EXPECT_FLOAT_EQ(command.tread_left, 1);
+    EXPECT_DOUBLE_EQ(budget.getAllocated(), 0);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
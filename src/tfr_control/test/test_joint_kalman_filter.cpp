@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include "joint_kalman_filter.h"
+
+using tfr_control::JointKalmanFilter;
+
+namespace
+{
+    //readings come in at 30 hz
+    const double PERIOD = 1.0 / 30;
+    const double NOISE = 0.01;
+
+    JointKalmanFilter::Settings settings(double process_noise)
+    {
+        return JointKalmanFilter::Settings{0.3, 0.1, process_noise, NOISE * NOISE};
+    }
+
+    /*
+     * A joint that moves exactly the way the filter models it, step it
+     * before each reading with the pwm passed along with that reading
+     * */
+    struct Joint
+    {
+        double position;
+        double velocity;
+
+        void step(double pwm, const JointKalmanFilter::Settings &model)
+        {
+            double decay = std::exp(-PERIOD / model.time_constant);
+            double target = model.input_gain * pwm;
+            position += target * PERIOD + (velocity - target) *
+                model.time_constant * (1 - decay);
+            velocity = target + (velocity - target) * decay;
+        }
+    };
+}
+
+TEST(JointKalmanFilter, FirstReading)
+{
+    JointKalmanFilter filter{settings(1.0)};
+    filter.update(0.7, 10.0, 0.5);
+    EXPECT_EQ(filter.getPosition(), 0.7);
+    EXPECT_EQ(filter.getVelocity(), 0);
+    EXPECT_EQ(filter.predictPosition(11.0), 0.7);
+}
+
+TEST(JointKalmanFilter, SmoothsStillJoint)
+{
+    JointKalmanFilter filter{settings(0.01)};
+    std::mt19937 random{1};
+    std::normal_distribution<double> noise{0, NOISE};
+    double squares = 0;
+    int samples = 0;
+    for (int i = 0; i < 600; i++)
+    {
+        filter.update(1 + noise(random), i * PERIOD, 0);
+        if (i >= 100)
+        {
+            squares += std::pow(filter.getPosition() - 1, 2);
+            samples++;
+        }
+    }
+    //well under the noise of a single reading
+    EXPECT_LT(std::sqrt(squares / samples), NOISE / 3);
+    EXPECT_NEAR(filter.getVelocity(), 0, 0.01);
+}
+
+TEST(JointKalmanFilter, FollowsPwm)
+{
+    JointKalmanFilter::Settings model = settings(0.01);
+    JointKalmanFilter filter{model};
+    Joint joint{0, 0};
+    std::mt19937 random{2};
+    std::normal_distribution<double> noise{0, NOISE};
+    for (int i = 0; i < 300; i++)
+    {
+        double pwm = (i < 150) ? 0.8 : -0.5;
+        joint.step(pwm, model);
+        filter.update(joint.position + noise(random), i * PERIOD, pwm);
+    }
+    //the pwm tells it the speed without waiting on the readings
+    EXPECT_NEAR(filter.getVelocity(), -0.5 * model.input_gain, 0.02);
+    EXPECT_NEAR(filter.getPosition(), joint.position, NOISE);
+}
+
+TEST(JointKalmanFilter, ConsistentWhenTuned)
+{
+    JointKalmanFilter::Settings model = settings(1e-6);
+    JointKalmanFilter filter{model};
+    Joint joint{0, 0};
+    std::mt19937 random{3};
+    std::normal_distribution<double> noise{0, NOISE};
+    for (int i = 0; i < 3000; i++)
+    {
+        double pwm = std::sin(i * PERIOD);
+        joint.step(pwm, model);
+        filter.update(joint.position + noise(random), i * PERIOD, pwm);
+    }
+    JointKalmanFilter::Innovations innovations = filter.takeInnovations();
+    EXPECT_EQ(innovations.count, 2999u);
+    EXPECT_NEAR(innovations.nis, 1, 0.15);
+    EXPECT_NEAR(innovations.mean, 0, NOISE / 5);
+
+    //a new window
+    filter.update(joint.position, 3000 * PERIOD, 0);
+    EXPECT_EQ(filter.takeInnovations().count, 1u);
+    EXPECT_EQ(filter.takeInnovations().count, 0u);
+}
+
+TEST(JointKalmanFilter, StartsOverAfterGap)
+{
+    JointKalmanFilter filter{settings(1.0)};
+    for (int i = 0; i < 30; i++)
+        filter.update(0.2, i * PERIOD, 0.5);
+    filter.update(1.5, 30 * PERIOD + 1.0, 0.5);
+    EXPECT_EQ(filter.getPosition(), 1.5);
+    EXPECT_EQ(filter.getVelocity(), 0);
+
+    filter.reset();
+    filter.update(-0.4, 40.0, 0);
+    EXPECT_EQ(filter.getPosition(), -0.4);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "slew_limiter.h"
+
+using tfr_control::SlewLimiter;
+
+namespace
+{
+    const double DT = 0.01;
+    const double ACCEL = 1.0;
+    const double JERK = 5.0;
+    const double SLACK = 1e-9;
+
+    /*
+     * Runs the limiter toward target, checking it never breaks its limits
+     * or passes the target, and returns how many steps it took to land
+     * */
+    int runTo(SlewLimiter &limiter, double target, int max_steps)
+    {
+        double start = limiter.getValue();
+        double last = start, last_rate = 0;
+        for (int i = 1; i <= max_steps; i++)
+        {
+            double value = limiter.update(target, DT);
+            double rate = (value - last) / DT;
+            EXPECT_LE(std::abs(rate), ACCEL + SLACK);
+            EXPECT_LE((value - start) * (value - target), SLACK);
+            //the step that lands drops what's left of the taper at once
+            if (value == target)
+                return i;
+            EXPECT_LE(std::abs(rate - last_rate) / DT, JERK + SLACK);
+            last = value;
+            last_rate = rate;
+        }
+        return -1;
+    }
+}
+
+TEST(SlewLimiter, LandsOnTarget)
+{
+    SlewLimiter limiter{ACCEL, JERK};
+    int steps = runTo(limiter, 0.5, 1000);
+    ASSERT_GT(steps, 0);
+    //a jerk limited ramp up to 0.5 takes at least 2 sqrt(0.5 / 5) s
+    EXPECT_GE(steps * DT, 2 * std::sqrt(0.5 / JERK) - DT);
+    EXPECT_EQ(limiter.update(0.5, DT), 0.5);
+}
+
+TEST(SlewLimiter, Reverses)
+{
+    SlewLimiter limiter{ACCEL, JERK};
+    ASSERT_GT(runTo(limiter, 0.4, 1000), 0);
+    ASSERT_GT(runTo(limiter, -0.4, 1000), 0);
+    EXPECT_EQ(limiter.getValue(), -0.4);
+}
+
+TEST(SlewLimiter, Reset)
+{
+    SlewLimiter limiter{ACCEL, JERK};
+    limiter.update(1.0, DT);
+    limiter.reset(0.3);
+    EXPECT_EQ(limiter.getValue(), 0.3);
+    //at rest, so the next step only moves by the jerk limit
+    double value = limiter.update(1.0, DT);
+    EXPECT_NEAR(value, 0.3 + JERK * DT * DT, SLACK);
+    EXPECT_EQ(limiter.update(1.0, 0), value);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "triple_buffer.h"
+
+struct Pair
+{
+    long first;
+    long second;
+};
+
+TEST(TripleBuffer, Basic)
+{
+    tfr_control::TripleBuffer<Pair> buffer;
+    Pair value{};
+    ASSERT_FALSE(buffer.read(value));
+    ASSERT_EQ(value.first, 0);
+
+    buffer.write(Pair{1, 1});
+    buffer.write(Pair{2, 2});
+    ASSERT_TRUE(buffer.read(value));
+    ASSERT_EQ(value.first, 2);
+
+    //nothing new, we hold the last value
+    ASSERT_FALSE(buffer.read(value));
+    ASSERT_EQ(value.second, 2);
+}
+
+TEST(TripleBuffer, Consistent)
+{
+    tfr_control::TripleBuffer<Pair> buffer;
+    const long count = 200000;
+    std::thread producer([&buffer, count]()
+            {
+                for (long i = 1; i <= count; i++)
+                    buffer.write(Pair{i, -i});
+            });
+
+    Pair value{};
+    long last = 0;
+    while (last < count)
+    {
+        buffer.read(value);
+        ASSERT_EQ(value.first, -value.second);
+        ASSERT_GE(value.first, last);
+        last = value.first;
+    }
+    producer.join();
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,10 +1,9 @@
 #include <ros/ros.h>
 #include <geometry_msgs/Twist.h>
-#include <std_msgs/Float64.h>
 #include <tfr_msgs/EmptyAction.h>
 #include <tfr_msgs/ArucoAction.h>
 #include <tfr_msgs/WrappedImage.h>
-#include <tfr_msgs/BinStateSrv.h>
+#include <tfr_msgs/BinAction.h>
 #include <tfr_utilities/control_code.h>
 #include <tfr_utilities/arm_manipulator.h>
 #include <sensor_msgs/Image.h>
@@ -29,8 +28,7 @@
  * This is currently filled by the camera_topic_wrapper in sensors
  *
  * published topics:
- *   -/cmd_vel geometry_msgs/Twist the drivebase velocity
- *   -/bin_position_controller/command std_msgs/Float64 the position of the bin
+ *   -/cmd_vel/dumping geometry_msgs/Twist the drivebase velocity
  *
  * */
 class Dumper
@@ -58,16 +56,17 @@ class Dumper
                 const DumpingConstraints &c) :
             server{node, "dump", boost::bind(&Dumper::dump, this, _1), false},
             image_client{node.serviceClient<tfr_msgs::WrappedImage>(service_name)},
-            velocity_publisher{node.advertise<geometry_msgs::Twist>("cmd_vel", 10)},
-            bin_publisher{node.advertise<std_msgs::Float64>("/bin_position_controller/command", 10)},
+            velocity_publisher{node.advertise<geometry_msgs::Twist>("cmd_vel/dumping", 1)},
             detector{"light_detection"},
             aruco{"aruco_action_server",true},
             constraints{c},
-            arm_manipulator{node}
+            arm_manipulator{node},
+            bin_client{node, "bin"}
         {
             ROS_INFO("dumping action server initializing");
             detector.waitForServer();
             aruco.waitForServer();
+            bin_client.waitForServer();
             server.start();
             ROS_INFO("dumping action server initialized");
         }
@@ -85,9 +84,10 @@ class Dumper
 
         ros::ServiceClient image_client;
         ros::Publisher velocity_publisher;
-        ros::Publisher bin_publisher;
 
         ArmManipulator arm_manipulator;
+        //raises the bin through the control node
+        actionlib::SimpleActionClient<tfr_msgs::BinAction> bin_client;
 
         const DumpingConstraints &constraints; 
 
@@ -159,27 +159,27 @@ class Dumper
             ros::Duration(3.0).sleep();
             arm_manipulator.moveArm(0.87, 0.1, 1.07, 1.5);
             ros::Duration(3.0).sleep();
-            std_msgs::Float64 bin_cmd;
-            bin_cmd.data = tfr_utilities::JointAngle::BIN_MAX;
-            tfr_msgs::BinStateSrv query;
-            while (!server.isPreemptRequested() && ros::ok())
+            tfr_msgs::BinGoal bin_goal;
+            bin_goal.command_code = tfr_msgs::BinGoal::RAISE_BIN;
+            //raised enough to dump, the twin actuators can stall short of
+            //the tight default at min pwm
+            bin_goal.tolerance = 0.1;
+            bin_client.sendGoal(bin_goal);
+            //wakes as soon as the bin gets there, the timeout is only to
+            //check for preemption
+            while (!bin_client.waitForResult(ros::Duration(0.1)))
             {
-                ros::service::call("bin_state", query);
-                using namespace tfr_utilities;
-                if (JointAngle::BIN_MAX -  query.response.state < 0.1)
-                    break;
-                bin_publisher.publish(bin_cmd);
-                ros::Duration(0.1).sleep();
-            }
-            if (server.isPreemptRequested())
-            {
-                ROS_INFO("Teleop Action Server: DUMP preempted");
-                server.setPreempted();
-                return;
+                if (server.isPreemptRequested() || !ros::ok())
+                {
+                    bin_client.cancelGoal();
+                    ROS_INFO("Dumping Action Server: DUMP preempted");
+                    server.setPreempted();
+                    return;
+                }
             }
-            else if (!server.isActive() || !ros::ok())
+            if (bin_client.getState() != actionlib::SimpleClientGoalState::SUCCEEDED)
             {
-                ROS_INFO("Teleop Action Server: DUMP preempted");
+                ROS_WARN("Dumping Action Server: bin didn't raise");
                 server.setAborted();
                 return;
             }
@@ -51,6 +51,7 @@
 #include <tfr_utilities/location_codes.h>
 #include <tfr_utilities/status_code.h>
 #include <tfr_utilities/status_publisher.h>
+#include <tfr_utilities/twist_repeater.h>
 #include <actionlib/server/simple_action_server.h>
 #include <actionlib/client/simple_action_client.h>
 
@@ -67,7 +68,7 @@ class AutonomousExecutive
             dumpingClient{n, "dump", true},
             frequency{f},
             status_publisher{n},
-            drivebase_publisher{n.advertise<geometry_msgs::Twist>("cmd_vel", 5)},
+            drivebase_publisher{n, "cmd_vel/autonomy"},
             moveClient{n, "move_base", true}
             
         {
@@ -384,7 +385,7 @@ class AutonomousExecutive
         bool DUMPING;
         //how often to check for preemption
         ros::Duration frequency;
-        ros::Publisher drivebase_publisher;
+        tfr_utilities::TwistRepeater drivebase_publisher;
 };
 
 int main(int argc, char **argv)
@@ -11,6 +11,9 @@
  *   - Backward
  *   - Turn left
  *   - Turn right
+ * - Jog the turntable
+ *   - Clockwise and counterclockwise, each goal keeps it turning for the
+ *     control node's jog deadman, so stream them while the key is held.
  * - Dig
  *   - Executes digging for some duration calculated by the `get_digging_time` 
  *     service, must support preemption.
@@ -27,7 +30,10 @@
  * PARAMETERS 
  * -~linear_velocity: the max linear velocity. (double, default: 0.25)
  * -~angular_velocity: the max angular velocity. (double, default: 0.1)
+ * -~jog_velocity: how fast to jog the turntable in rad/s. (double, default: 0.3)
  * - ~rate: the rate in hz to check to preemption during long running calls, (double, default: 10)
+ *
+ * The arm and bin state come from the control node's /arm_bin_state topic.
  */ 
 #include <ros/ros.h>
 #include <ros/console.h>
@@ -36,14 +42,16 @@
 #include <tfr_msgs/TeleopAction.h>
 #include <tfr_msgs/DiggingAction.h>
 #include <tfr_msgs/EmptySrv.h>
-#include <tfr_msgs/BinStateSrv.h>
-#include <tfr_msgs/ArmStateSrv.h>
+#include <tfr_utilities/arm_bin_state_cache.h>
+#include <tfr_utilities/twist_repeater.h>
 #include <tfr_msgs/DurationSrv.h>
 #include <tfr_utilities/arm_manipulator.h>
 #include <trajectory_msgs/JointTrajectory.h>
 #include <geometry_msgs/Twist.h>
-#include <std_msgs/Float64.h>
 #include <tfr_msgs/ArmMoveAction.h>
+#include <tfr_msgs/BinAction.h>
+#include <tfr_msgs/ArmJog.h>
+#include <std_srvs/SetBool.h>
 #include <actionlib/server/simple_action_server.h>
 #include <actionlib/client/simple_action_client.h>
 
@@ -58,27 +66,32 @@ class TeleopExecutive
             private:
                 double linear;
                 double angular;
+                double jog;
             public:
-                DriveVelocity(double lin, double ang):
-                    linear{lin}, angular{ang}{}
+                DriveVelocity(double lin, double ang, double j):
+                    linear{lin}, angular{ang}, jog{j}{}
                 double getLinear(){return linear;}
                 double getAngular(){return angular;}
+                double getJog(){return jog;}
         };
 
         TeleopExecutive(ros::NodeHandle &n , DriveVelocity &drive, double f) :
             server{n, "teleop_action_server",
                 boost::bind(&TeleopExecutive::processCommand, this, _1),
                 false},
-            drivebase_publisher{n.advertise<geometry_msgs::Twist>("cmd_vel", 5)},
+            drivebase_publisher{n, "cmd_vel/teleop"},
             arm_manipulator{n},
-            bin_publisher{n.advertise<std_msgs::Float64>("/bin_position_controller/command", 5)},
+            arm_bin_state{n},
+            jog_publisher{n.advertise<tfr_msgs::ArmJog>("arm_jog", 1)},
             digging_client{n, "dig"},
             arm_client{n, "move_arm"},
+            bin_client{n, "bin"},
             drive_stats{drive},
             frequency{f}
         {
             digging_client.waitForServer();
             arm_client.waitForServer();
+            bin_client.waitForServer();
             server.start();
             ROS_INFO("Teleop Action Server: Online %f", ros::Time::now().toSec());
         }
@@ -157,25 +170,17 @@ class TeleopExecutive
 
                 case (tfr_utilities::TeleopCode::CLOCKWISE):
                     {
-                        ROS_INFO("Teleop Action Server: Command Recieved, CLOCKWISE");
-                        tfr_msgs::ArmStateSrv query;
-                        ros::service::call("arm_state", query);
-                        arm_manipulator.moveArm( query.response.states[0] - 0.03,
-                                  query.response.states[1],
-                                  query.response.states[2],
-                                  query.response.states[3]);
+                        ROS_DEBUG("Teleop Action Server: Command Recieved, CLOCKWISE");
+                        if (!jogTurntable(-drive_stats.getJog()))
+                            return;
                         break;
                     }
 
                 case (tfr_utilities::TeleopCode::COUNTERCLOCKWISE):
                     {
-                        ROS_INFO("Teleop Action Server: Command Recieved, COUNTERCLOCKWISE");
-                        tfr_msgs::ArmStateSrv query;
-                        ros::service::call("arm_state", query);
-                        arm_manipulator.moveArm( query.response.states[0] + 0.03,
-                                  query.response.states[1],
-                                  query.response.states[2],
-                                  query.response.states[3]);
+                        ROS_DEBUG("Teleop Action Server: Command Recieved, COUNTERCLOCKWISE");
+                        if (!jogTurntable(drive_stats.getJog()))
+                            return;
                         break;
                     }
 
@@ -216,25 +221,8 @@ class TeleopExecutive
                         ros::Duration(3.0).sleep();
                         arm_manipulator.moveArm(0.87, 0.1, 1.07, 1.5);
                         ros::Duration(3.0).sleep();
-                        std_msgs::Float64 bin_cmd;
-                        bin_cmd.data = tfr_utilities::JointAngle::BIN_MAX;
-                        tfr_msgs::BinStateSrv query;
-                        while (!server.isPreemptRequested() && ros::ok())
-                        {
-                            ros::service::call("bin_state", query);
-                            using namespace tfr_utilities;
-                            if (JointAngle::BIN_MAX -  query.response.state <
-                                    0.01)
-                                break;
-                            bin_publisher.publish(bin_cmd);
-                            frequency.sleep();
-                        }
-                        if (server.isPreemptRequested())
-                        {
-                            ROS_INFO("Teleop Action Server: DUMP preempted");
-                            server.setPreempted();
+                        if (!moveBin(tfr_msgs::BinGoal::RAISE_BIN, "DUMP"))
                             return;
-                        }
                         ROS_INFO("Teleop Action Server: DUMP finished");
                         break;
                     }
@@ -243,26 +231,8 @@ class TeleopExecutive
                     {
                         drivebase_publisher.publish(move_cmd);
                         ROS_INFO("Teleop Action Server: Command Recieved, RESET_DUMPING");
-                        //all zeros by default
-                        std_msgs::Float64 bin_cmd;
-                        bin_cmd.data = tfr_utilities::JointAngle::BIN_MIN;
-                        tfr_msgs::BinStateSrv query;
-                        while (!server.isPreemptRequested() && ros::ok())
-                        {
-                            ros::service::call("bin_state", query);
-                            using namespace tfr_utilities;
-                            if (query.response.state - JointAngle::BIN_MIN <
-                                    0.01)
-                                break;
-                            bin_publisher.publish(bin_cmd);
-                            frequency.sleep();
-                        }
-                        if (server.isPreemptRequested())
-                        {
-                            ROS_INFO("Teleop Action Server: DUMPING_RESET preempted");
-                            server.setPreempted();
+                        if (!moveBin(tfr_msgs::BinGoal::LOWER_BIN, "DUMPING_RESET"))
                             return;
-                        }
                         ROS_INFO("Teleop Action Server: DUMPING_RESET finished");
                         break;
                     }
@@ -273,9 +243,10 @@ class TeleopExecutive
                         //all zeros by default
                         drivebase_publisher.publish(move_cmd);
                         //first grab the current state of the arm
-                        tfr_msgs::ArmStateSrv query;
-                        ros::service::call("arm_state", query);
-                        arm_manipulator.moveArm(query.response.states[0], 0.20, 1.0, 1.6);
+                        std::vector<double> arm;
+                        if (!getArm(arm))
+                            return;
+                        arm_manipulator.moveArm(arm[0], 0.20, 1.0, 1.6);
                         ros::Duration(5.0).sleep();
                         arm_manipulator.moveArm(0, 0.20, 1.0, 1.6);
                         ros::Duration(8.0).sleep();
@@ -308,12 +279,13 @@ class TeleopExecutive
                 case (tfr_utilities::TeleopCode::RAISE_ARM):
                     {
                         ROS_INFO("Teleop Action Server: Command Recieved, RAISE_ARM");
-                        tfr_msgs::ArmStateSrv query;
-                        ros::service::call("arm_state", query);
                         //all zeros by default
                         drivebase_publisher.publish(move_cmd);
                         //first grab the current state of the arm
-                        arm_manipulator.moveArm(query.response.states[0], 0.10, 1.07, 1.6);
+                        std::vector<double> arm;
+                        if (!getArm(arm))
+                            return;
+                        arm_manipulator.moveArm(arm[0], 0.10, 1.07, 1.6);
                         ros::Duration(5.0).sleep();
                         ROS_INFO("Teleop Action Server: arm raise finished");
                         break;
@@ -333,12 +305,86 @@ class TeleopExecutive
             server.setSucceeded(result);
         }
 
+        /*
+         * Raises or lowers the bin through the control node. Returns false
+         * once the goal has been settled, if we were preempted or the bin
+         * didn't get there.
+         * */
+        bool moveBin(uint8_t code, const char *name)
+        {
+            tfr_msgs::BinGoal goal;
+            goal.command_code = code;
+            bin_client.sendGoal(goal);
+            //wakes as soon as the bin gets there, the timeout is only to
+            //check for preemption
+            while (!bin_client.waitForResult(frequency))
+            {
+                if (server.isPreemptRequested() || !ros::ok())
+                {
+                    bin_client.cancelGoal();
+                    ROS_INFO("Teleop Action Server: %s preempted", name);
+                    server.setPreempted();
+                    return false;
+                }
+            }
+            if (bin_client.getState() != actionlib::SimpleClientGoalState::SUCCEEDED)
+            {
+                ROS_WARN("Teleop Action Server: %s failed to move the bin", name);
+                tfr_msgs::TeleopResult result{};
+                server.setAborted(result);
+                return false;
+            }
+            return true;
+        }
+
+        /*
+         * Keeps the turntable moving at velocity until the jog deadman runs
+         * out, holding the rest of the arm. The jog controller is asked for
+         * every time, anything moving the arm since may have switched the
+         * trajectory controllers back in, the control node answers right
+         * away if it's already in.
+         * */
+        bool jogTurntable(double velocity)
+        {
+            std_srvs::SetBool request;
+            request.request.data = true;
+            if (!ros::service::call("toggle_arm_jog", request) || !request.response.success)
+            {
+                ROS_WARN("Teleop Action Server: couldn't toggle arm jog, %s",
+                        request.response.message.c_str());
+                tfr_msgs::TeleopResult result{};
+                server.setAborted(result);
+                return false;
+            }
+            tfr_msgs::ArmJog jog;
+            jog.header.stamp = ros::Time::now();
+            jog.velocity = {velocity, 0, 0, 0};
+            jog_publisher.publish(jog);
+            return true;
+        }
+
+        /*
+         * Gets the current state of the arm, aborts the goal if the control
+         * node hasn't told us one yet
+         * */
+        bool getArm(std::vector<double> &arm)
+        {
+            if (arm_bin_state.getArm(arm) && arm.size() == 4)
+                return true;
+            ROS_WARN("Teleop Action Server: no arm state from the control node");
+            tfr_msgs::TeleopResult result{};
+            server.setAborted(result);
+            return false;
+        }
+
         actionlib::SimpleActionServer<tfr_msgs::TeleopAction> server;
         actionlib::SimpleActionClient<tfr_msgs::DiggingAction> digging_client;
         actionlib::SimpleActionClient<tfr_msgs::ArmMoveAction> arm_client;
-        ros::Publisher drivebase_publisher;
+        actionlib::SimpleActionClient<tfr_msgs::BinAction> bin_client;
+        tfr_utilities::TwistRepeater drivebase_publisher;
         ArmManipulator arm_manipulator;
-        ros::Publisher bin_publisher;
+        tfr_utilities::ArmBinStateCache arm_bin_state;
+        ros::Publisher jog_publisher;
         DriveVelocity &drive_stats;
         //how often to check for preemption
         ros::Duration frequency;
@@ -350,11 +396,12 @@ int main(int argc, char** argv)
 {
     ros::init(argc, argv, "teleop_action_server");
     ros::NodeHandle n{};
-    double linear_velocity, angular_velocity, rate;
+    double linear_velocity, angular_velocity, jog_velocity, rate;
     ros::param::param<double>("~linear_velocity", linear_velocity, 0.25);
     ros::param::param<double>("~angular_velocity", angular_velocity, 0.3);
+    ros::param::param<double>("~jog_velocity", jog_velocity, 0.3);
     ros::param::param<double>("~rate", rate, 10.0);
-    TeleopExecutive::DriveVelocity velocities{linear_velocity, angular_velocity};
+    TeleopExecutive::DriveVelocity velocities{linear_velocity, angular_velocity, jog_velocity};
     TeleopExecutive teleop{n, velocities, 1.0/rate};
     ros::spin();
     return 0;
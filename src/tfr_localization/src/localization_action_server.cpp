@@ -12,7 +12,8 @@
  *  - ~turn_duration: how long to turn [s] (double, default: 0.0)
  *
  * published topics:
- *  - /cmd_vel publishes to the drivebase (geometry_msgs/Twist)
+ *  - /cmd_vel/localization publishes to the drivebase, repeated while it
+ *    turns (geometry_msgs/Twist)
  * */
 
 #include <ros/ros.h>
@@ -23,6 +24,7 @@
 #include <tfr_msgs/WrappedImage.h>
 #include <tfr_msgs/PoseSrv.h>
 #include <tfr_utilities/tf_manipulator.h>
+#include <tfr_utilities/twist_repeater.h>
 #include <geometry_msgs/Twist.h>
 
 class Localizer
@@ -32,7 +34,7 @@ class Localizer
                 duration, const double& thresh) : 
             aruco{n, "aruco_action_server"},
             server{n, "localize", boost::bind(&Localizer::localize, this, _1) ,false},
-            cmd_publisher{n.advertise<geometry_msgs::Twist>("cmd_vel", 5)},
+            cmd_publisher{n, "cmd_vel/localization"},
             turn_velocity{velocity},
             turn_duration{duration},
             threshold{thresh}
@@ -64,7 +66,7 @@ class Localizer
     private:
         actionlib::SimpleActionServer<tfr_msgs::LocalizationAction> server;
         actionlib::SimpleActionClient<tfr_msgs::ArucoAction> aruco;
-        ros::Publisher cmd_publisher;
+        tfr_utilities::TwistRepeater cmd_publisher;
         ros::ServiceClient rear_cam_client;
         ros::ServiceClient front_cam_client;
         TfManipulator tf_manipulator;
@@ -1,17 +1,24 @@
 /****************************************************************************************
  * File:            digging_queue.h
- * 
- * Purpose:         This class implements a queue of digging sets, used to
- *                  execute large sets of digging actions in a row. It
- *                  instantiates all of its stored states on construction, and
- *                  we then pop from it until we run out of states or we
- *                  run out of time to dig.
+ *
+ * Purpose:         This class holds the digging plan, the sets of digging
+ *                  states used to execute large sets of digging actions in a
+ *                  row. It loads every state once on construction into one
+ *                  contiguous block and never changes them after.
+ *
+ *                  Where we are in the plan is a cursor, the next set that
+ *                  hasn't been finished. Nothing is removed as sets are dug,
+ *                  so the next goal picks up where the last one left off, and
+ *                  the plan can be reset, skipped or rewound by moving the
+ *                  cursor. The cursor is locked, so it can be moved from
+ *                  another thread while a set is being dug.
  ***************************************************************************************/
 #ifndef DIGGING_QUEUE_H
 #define DIGGING_QUEUE_H
 
 #include <ros/ros.h>
-#include <queue>
+#include <mutex>
+#include <vector>
 #include "digging_set.h"
 
 namespace tfr_mining
@@ -20,41 +27,71 @@ namespace tfr_mining
     {
     public:
         /**
-         * Constructs the queue and instantiates all of the digging sets inside
-         * it.
+         * Constructs the queue and loads all of the digging sets inside it
+         * from the positions parameter.
          **/
         DiggingQueue(ros::NodeHandle nh);
         ~DiggingQueue() = default;
+        //the sets point into the queue's states
+        DiggingQueue(const DiggingQueue&) = delete;
+        DiggingQueue& operator=(const DiggingQueue&) = delete;
+        DiggingQueue(DiggingQueue&&) = delete;
+        DiggingQueue& operator=(DiggingQueue&&) = delete;
 
         /**
-         * Returns whether this queue is empty or not.
+         * The number of sets in the plan.
          **/
-        bool isEmpty();
+        size_t size() const;
 
         /**
-         * Returns the next set in the queue and removes it.
+         * Returns the set at index, throws std::out_of_range past the end.
          **/
-        DiggingSet popDiggingSet();
-    private:
-        std::queue<DiggingSet> sets;
+        const DiggingSet& getSet(size_t index) const;
 
         /**
-         * Helper method to generate a single dig, without any side dumping.
+         * Gets the index of the next unfinished set, or returns false if
+         * every set is done. Use this rather than asking isFinished() then
+         * getCursor(), the cursor can move in between.
          **/
-        void generateSingleDig(ros::NodeHandle &nh, DiggingSet &set, double rotation, int dig_number);
+        bool nextSet(size_t &index) const;
 
         /**
-         * Helper method which generates a set of digging positions. Generates ready pos -> dig pos (penetrating dirt)
-         * -> scoop pos (moving scoop upwards to remove dirt) -> out pos (scoop horizontal out of dirt) -> either bin
-         * dump (if dig_number > 2) or dump to side (if dig_number <= 2)
-         * 
-         * The rotation parameter is the angle of the dumping position (angle of the turntable for digs). Dig number is
-         * which dig this is in the set (aka in this hole we're digging, is this the first scoop, second scoop, etc?).
-         * This is used to determine whether we should dump to the side or into the bin.
+         * The index of the next unfinished set, size() once every set is
+         * done.
          **/
-        void generateDigAndDump(ros::NodeHandle &nh, DiggingSet &set, double rotation, int dig_number);
+        size_t getCursor() const;
+
+        /**
+         * Returns whether every set in the plan is done.
+         **/
+        bool isFinished() const;
+
+        /**
+         * Marks the set at index done, moving the cursor past it. Does
+         * nothing if the cursor was moved somewhere else while it was dug.
+         **/
+        void finishSet(size_t index);
+
+        /**
+         * Starts the plan over from the first set.
+         **/
+        void reset();
+
+        /**
+         * Moves the cursor to the next set without digging this one.
+         **/
+        void skip();
+
+        /**
+         * Moves the cursor back to the set before, to dig it again.
+         **/
+        void rewind();
+    private:
+        std::vector<DiggingState> states;
+        std::vector<DiggingSet> sets;
 
-        void loadTestingDig(ros::NodeHandle &nh, DiggingSet &set, std::string pos_name);
+        mutable std::mutex cursor_mutex;
+        size_t cursor;
     };
 }
 
@@ -1,47 +1,52 @@
 /****************************************************************************************
  * File:            digging_set.h
- * 
+ *
  * Purpose:         This class implements a set of digging states with a time
- *                  estimate. It is intended to be instantiated only by
- *                  DiggingQueue, and then used by the DiggingActionServer after
- *                  being returned out.
+ *                  estimate. It is a read only view of states owned by the
+ *                  DiggingQueue that made it, so it is only valid as long as
+ *                  that queue is, and is cheap to pass around.
  ***************************************************************************************/
 #ifndef DIGGING_SET_H
 #define DIGGING_SET_H
 
-#include <queue>
-#include <vector>
+#include <array>
+#include <cstddef>
 
 namespace tfr_mining
 {
+    /**
+     * turntable, lower arm, upper arm, scoop, then how long to wait or pulse
+     * the drivebase once there
+     **/
+    using DiggingState = std::array<double, 5>;
+
     class DiggingSet
     {
     public:
-        DiggingSet();
-        ~DiggingSet() = default;
         /**
-         * Inserts a new state into this set, and increases the time estimate
-         * accordingly.
+         * The count states starting at first, which take time in total.
          **/
-        void insertState(std::vector<double> state, double time);
+        DiggingSet(const DiggingState *first, size_t count, double time);
+        ~DiggingSet() = default;
 
         /**
-         * Returns whether this set is empty or not.
+         * The number of states in this set.
          **/
-        bool isEmpty();
+        size_t size() const;
 
         /**
-         * Returns the next state in this set and removes it.
+         * Returns the state at index, which must be less than size().
          **/
-        std::vector<double> popState();
+        const DiggingState& getState(size_t index) const;
 
         /**
          * Gets the time estimate for the set as a whole (cumulative for all
          * states).
          **/
-        double getTimeEstimate();
+        double getTimeEstimate() const;
     private:
-        std::queue<std::vector<double> > states;
+        const DiggingState *states;
+        size_t count;
         double time_estimate;
     };
 }
@@ -13,14 +13,25 @@
  *              devel/include/tfr_msgs/DiggingFeedback.h
  *              devel/include/tfr_msgs/DiggingGoal.h
  *              devel/include/tfr_msgs/DiggingResult.h
- * 
+ *
+ *          The digging plan is loaded once and kept for the whole run. Each
+ *          goal digs from the first set the last goals didn't finish, and
+ *          starts the plan over if every set is done. Feedback says how many
+ *          sets of the plan are done.
+ *
+ * Services: reset_digging_plan - start the plan over from the first set
+ *           skip_digging_set - don't dig the next set
+ *           rewind_digging_set - dig the set before the next one again
+ *
  ***************************************************************************************/
 
 #include <actionlib/server/simple_action_server.h>
 #include <actionlib/client/simple_action_client.h>
 #include <tfr_msgs/DiggingAction.h>  // Note: "Action" is appended
 #include <tfr_msgs/ArmMoveAction.h>  // Note: "Action" is appended
+#include <tfr_msgs/EmptySrv.h>
 #include <tfr_utilities/arm_manipulator.h>
+#include <tfr_utilities/twist_repeater.h>
 #include <geometry_msgs/Twist.h>
 #include <tfr_utilities/teleop_code.h>
 #include <actionlib/client/simple_action_client.h>
@@ -33,11 +44,16 @@ class DiggingActionServer {
 public:
     DiggingActionServer(ros::NodeHandle &nh, ros::NodeHandle &p_nh) :
         priv_nh{p_nh}, queue{priv_nh}, 
-        drivebase_publisher{nh.advertise<geometry_msgs::Twist>("cmd_vel", 5)},
+        drivebase_publisher{nh, "cmd_vel/digging"},
         server{nh, "dig", boost::bind(&DiggingActionServer::execute, this, _1),
             false},
-        arm_manipulator{nh}
-
+        arm_manipulator{nh},
+        reset_service{nh.advertiseService("reset_digging_plan",
+                &DiggingActionServer::resetPlan, this)},
+        skip_service{nh.advertiseService("skip_digging_set",
+                &DiggingActionServer::skipSet, this)},
+        rewind_service{nh.advertiseService("rewind_digging_set",
+                &DiggingActionServer::rewindSet, this)}
     {
         server.start();
     }
@@ -69,13 +85,22 @@ private:
         client.waitForServer();
         ROS_DEBUG("Connected with arm action server");
 
-        while (!queue.isEmpty())
+        if (queue.isFinished())
+        {
+            ROS_INFO("Every digging set is done, starting the plan over");
+            queue.reset();
+        }
+        publishProgress();
+
+        bool aborted = false;
+        size_t index;
+        while (!aborted && queue.nextSet(index))
         {
             ROS_INFO("Time remaining: %f", (endTime - ros::Time::now()).toSec());
-            tfr_mining::DiggingSet set = queue.popDiggingSet();
+            const tfr_mining::DiggingSet &set = queue.getSet(index);
             ros::Time now = ros::Time::now();
 
-            ROS_INFO("starting set");
+            ROS_INFO("starting set %zu of %zu", index + 1, queue.size());
             // If we don't have enough time, bail on the action and exit
             if ((endTime - now).toSec() < set.getTimeEstimate())
             {
@@ -84,22 +109,40 @@ private:
                 break;
             }
 
-            while (!set.isEmpty())
+            size_t next = 0;
+            while (next < set.size())
             {
-                std::vector<double> state = set.popState();
+                // The arm runs through every state up to the next one it
+                // has to stop at in a single move
+                size_t stop = next;
+                while (!needsStop(set.getState(stop)) && stop + 1 < set.size())
+                    stop++;
+                const tfr_mining::DiggingState &state = set.getState(stop);
                 tfr_msgs::ArmMoveGoal goal;
                 goal.pose.resize(5);
                 goal.pose[0] = state[0];
                 goal.pose[1] = state[1];
                 goal.pose[2] = state[2];
                 goal.pose[3] = state[3];
+                for (size_t i = next; i < stop; i++)
+                    goal.waypoints.insert(goal.waypoints.end(),
+                            set.getState(i).begin(), set.getState(i).begin() + 4);
+                // Let the arm plan the next state while this one moves
+                if (stop + 1 < set.size())
+                {
+                    const tfr_mining::DiggingState &after = set.getState(stop + 1);
+                    goal.next_pose.assign(after.begin(), after.begin() + 4);
+                }
 
-                ROS_INFO("goal %f %f %f %f", goal.pose[0], goal.pose[1], goal.pose[2], goal.pose[3]);
+                ROS_INFO("goal %f %f %f %f through %zu waypoints", goal.pose[0], goal.pose[1],
+                        goal.pose[2], goal.pose[3], stop - next);
+                next = stop + 1;
 
                 client.sendGoal(goal);
-                ros::Rate rate(10.0);
 
-                while (!client.getState().isDone() && ros::ok())
+                // Wakes as soon as the move is done so the next one goes out
+                // right away, the timeout is only to check for preemption
+                while (!client.waitForResult(ros::Duration(0.1)) && ros::ok())
                 {
                     if (server.isPreemptRequested() || !ros::ok())
                     {
@@ -115,23 +158,20 @@ private:
                         arm_manipulator.moveArm(0, 0.50, 1.07, 1.6);
                         return;
                     }
-
-
-                    rate.sleep();
                 }
                 
                 if (client.getState() != actionlib::SimpleClientGoalState::SUCCEEDED)
                 {
                     ROS_WARN("Error executing arm action server to state, exiting.");
-                    tfr_msgs::DiggingResult result;
-                    server.setAborted(result);
+                    aborted = true;
+                    break;
                 }
 
-                if (std::abs(goal.pose[0]) < 3.14159265/2) { // If the turntable is going to around the bin (the problem area)
+                if (nearBin(state)) { // If the turntable is going to around the bin (the problem area)
                     ros::Duration(1.5).sleep(); // Setting this to 2 seconds works for sure
                 }
                 
-                if (std::abs(state[4]) > 1.05 )
+                if (pulses(state))
                 {
                     geometry_msgs::Twist pulse;
                     pulse.linear.x = -0.2;
@@ -142,9 +182,18 @@ private:
                 }
                 else if (std::abs(state[4]) > 0.05)
                 {
+                    // The short pause let the arm settle between states,
+                    // so it's only kept where the arm stops anyway
                     ros::Duration(0.5).sleep(); 
                 }
             }
+
+            // An unfinished set is dug again from the start next time
+            if (!aborted)
+            {
+                queue.finishSet(index);
+                publishProgress();
+            }
         }
         ROS_WARN("Moving arm to final position, exiting.");
         arm_manipulator.moveArm(0.0, 0.1, 1.07, -1.0);
@@ -154,16 +203,84 @@ private:
         arm_manipulator.moveArm(0, 0.50, 1.07, 1.6);
 
         tfr_msgs::DiggingResult result;
-        server.setSucceeded(result);
+        if (aborted)
+            server.setAborted(result);
+        else
+            server.setSucceeded(result);
+    }
+
+    /*
+     * Tells the client how far through the plan we are
+     * */
+    void publishProgress()
+    {
+        tfr_msgs::DiggingFeedback feedback;
+        feedback.sets_done = queue.getCursor();
+        feedback.sets_total = queue.size();
+        server.publishFeedback(feedback);
+        ROS_INFO("Digging plan: %u of %u sets done", feedback.sets_done, feedback.sets_total);
     }
 
+    bool resetPlan(tfr_msgs::EmptySrv::Request &request,
+            tfr_msgs::EmptySrv::Response &response)
+    {
+        queue.reset();
+        ROS_INFO("Digging plan: reset, next set is 1 of %zu", queue.size());
+        return true;
+    }
+
+    bool skipSet(tfr_msgs::EmptySrv::Request &request,
+            tfr_msgs::EmptySrv::Response &response)
+    {
+        queue.skip();
+        ROS_INFO("Digging plan: skipped, %zu of %zu sets done", queue.getCursor(), queue.size());
+        return true;
+    }
+
+    bool rewindSet(tfr_msgs::EmptySrv::Request &request,
+            tfr_msgs::EmptySrv::Response &response)
+    {
+        queue.rewind();
+        ROS_INFO("Digging plan: rewound, %zu of %zu sets done", queue.getCursor(), queue.size());
+        return true;
+    }
+
+
+    /*
+     * Whether the turntable is around the bin, the problem area
+     * */
+    static bool nearBin(const tfr_mining::DiggingState &state)
+    {
+        return std::abs(state[0]) < 3.14159265/2;
+    }
+
+    /*
+     * Whether the drivebase is pulsed back once the arm is at a state
+     * */
+    static bool pulses(const tfr_mining::DiggingState &state)
+    {
+        return std::abs(state[4]) > 1.05;
+    }
+
+    /*
+     * Whether the arm has to stop at a state, to settle around the bin or
+     * to hold still while the drivebase pulses. Every other state is passed
+     * at speed, the arm blends the corner there
+     * */
+    static bool needsStop(const tfr_mining::DiggingState &state)
+    {
+        return nearBin(state) || pulses(state);
+    }
 
     ros::NodeHandle &priv_nh;
-    ros::Publisher drivebase_publisher;
+    tfr_utilities::TwistRepeater drivebase_publisher;
  
     ArmManipulator arm_manipulator;
     tfr_mining::DiggingQueue queue;
     Server server;
+    ros::ServiceServer reset_service;
+    ros::ServiceServer skip_service;
+    ros::ServiceServer rewind_service;
 };
 
 int main(int argc, char** argv)
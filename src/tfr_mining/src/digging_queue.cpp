@@ -3,38 +3,107 @@
 namespace tfr_mining
 {
     // Must be a private node handle ("~")
-    DiggingQueue::DiggingQueue(ros::NodeHandle nh) : sets{}
+    DiggingQueue::DiggingQueue(ros::NodeHandle nh) : states{}, sets{}, cursor{0}
     {
         XmlRpc::XmlRpcValue positions;
 
-        if (!nh.getParam("positions", positions)) {
+        if (!nh.getParam("positions", positions) ||
+                positions.getType() != XmlRpc::XmlRpcValue::TypeArray) {
             ROS_ERROR("Error loading positions, exiting");
             return;
         }
 
+        // Every state goes in first so the sets can point into them
+        std::vector<size_t> counts;
         for (int i = 0; i < positions.size(); i++) {
-            DiggingSet toAdd;
+            if (positions[i].getType() != XmlRpc::XmlRpcValue::TypeArray) {
+                ROS_ERROR("Digging set %d isn't a list of states, skipping it", i);
+                continue;
+            }
+            size_t count = 0;
             for (int j = 0; j < positions[i].size(); j++)
             {
-                std::vector<double> state;
-                for (int angle = 0; angle < 5; angle++) {
-                    state.push_back(positions[i][j][angle]);
+                XmlRpc::XmlRpcValue &position = positions[i][j];
+                if (position.getType() != XmlRpc::XmlRpcValue::TypeArray ||
+                        position.size() != static_cast<int>(DiggingState{}.size())) {
+                    ROS_ERROR("Digging set %d state %d doesn't have %zu values, skipping it",
+                            i, j, DiggingState{}.size());
+                    continue;
+                }
+                DiggingState state;
+                for (int angle = 0; angle < position.size(); angle++) {
+                    state[angle] = position[angle];
                 }
-                toAdd.insertState(state, 4.5); // Just use a constant time for simplicity.
+                states.push_back(state);
+                count++;
             }
-            sets.push(toAdd);
+            if (count > 0)
+                counts.push_back(count);
+        }
+
+        const DiggingState *first = states.data();
+        for (size_t count : counts) {
+            sets.emplace_back(first, count, 4.5 * count); // Just use a constant time for simplicity.
+            first += count;
         }
+        ROS_INFO("Loaded %zu digging sets, %zu states", sets.size(), states.size());
+    }
+
+    size_t DiggingQueue::size() const
+    {
+        return sets.size();
+    }
+
+    const DiggingSet& DiggingQueue::getSet(size_t index) const
+    {
+        return sets.at(index);
+    }
+
+    bool DiggingQueue::nextSet(size_t &index) const
+    {
+        std::lock_guard<std::mutex> lock(cursor_mutex);
+        if (cursor >= sets.size())
+            return false;
+        index = cursor;
+        return true;
+    }
+
+    size_t DiggingQueue::getCursor() const
+    {
+        std::lock_guard<std::mutex> lock(cursor_mutex);
+        return cursor;
+    }
+
+    bool DiggingQueue::isFinished() const
+    {
+        std::lock_guard<std::mutex> lock(cursor_mutex);
+        return cursor >= sets.size();
+    }
+
+    void DiggingQueue::finishSet(size_t index)
+    {
+        std::lock_guard<std::mutex> lock(cursor_mutex);
+        if (cursor == index && cursor < sets.size())
+            cursor++;
+    }
+
+    void DiggingQueue::reset()
+    {
+        std::lock_guard<std::mutex> lock(cursor_mutex);
+        cursor = 0;
     }
 
-    bool DiggingQueue::isEmpty()
+    void DiggingQueue::skip()
     {
-        return sets.empty();
+        std::lock_guard<std::mutex> lock(cursor_mutex);
+        if (cursor < sets.size())
+            cursor++;
     }
 
-    DiggingSet DiggingQueue::popDiggingSet()
+    void DiggingQueue::rewind()
     {
-        DiggingSet set = sets.front();
-        sets.pop();
-        return set;
+        std::lock_guard<std::mutex> lock(cursor_mutex);
+        if (cursor > 0)
+            cursor--;
     }
 }
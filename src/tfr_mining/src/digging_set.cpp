@@ -2,30 +2,23 @@
 
 namespace tfr_mining
 {
-    DiggingSet::DiggingSet() : states{}, time_estimate{0}
+    DiggingSet::DiggingSet(const DiggingState *first, size_t c, double time) :
+        states{first}, count{c}, time_estimate{time}
     {
-		
-    }
 
-    void DiggingSet::insertState(std::vector<double> state, double time)
-    {
-        states.push(state);
-        time_estimate += time;
     }
 
-    bool DiggingSet::isEmpty()
+    size_t DiggingSet::size() const
     {
-        return states.empty();
+        return count;
     }
 
-    std::vector<double> DiggingSet::popState()
+    const DiggingState& DiggingSet::getState(size_t index) const
     {
-        std::vector<double> state = states.front();
-        states.pop();
-        return state;
+        return states[index];
     }
 
-    double DiggingSet::getTimeEstimate()
+    double DiggingSet::getTimeEstimate() const
     {
         return time_estimate;
     }
@@ -16,6 +16,7 @@
 #include <tfr_msgs/TeleopAction.h>
 #include <tfr_msgs/ArmMoveAction.h>
 #include <tfr_msgs/ArmStateSrv.h>
+#include <tfr_msgs/ArmJog.h>
 
 #include <tfr_utilities/teleop_code.h>
 #include <tfr_utilities/status_code.h>
@@ -83,6 +84,9 @@ namespace tfr_mission_control {
             //NOTE can cause bouncy keys if user has too long of a delay for
             //repeated keys
             const double MOTOR_INTERVAL = 1000/4;
+            //how often to repeat turntable jogs while a button is held (ms),
+            //needs to beat the jog deadman in the control node
+            const int JOG_INTERVAL = 100;
 
             /* ======================================================================== */
             /* Variables                                                                */
@@ -105,6 +109,8 @@ namespace tfr_mission_control {
  
             //our message subscriber
             ros::Subscriber com;
+            //stops turntable jogs as soon as they're released
+            ros::Publisher jog_publisher;
 
             //Whether teleop commands should be accepted
             bool teleopEnabled;
@@ -127,6 +133,9 @@ namespace tfr_mission_control {
 
             void resetTurntable();
 
+            //sends a zero jog, which stops the arm where it is
+            void stopTurntable();
+
             /* ======================================================================== */
             /* Events                                                                   */
             /* ======================================================================== */
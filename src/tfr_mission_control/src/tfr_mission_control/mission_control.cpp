@@ -19,6 +19,7 @@ namespace tfr_mission_control {
         teleop{"teleop_action_server",true},
         arm_client{"move_arm", true},
         com{nh.subscribe("com", 5, &MissionControl::updateStatus, this)},
+        jog_publisher{nh.advertise<tfr_msgs::ArmJog>("arm_jog", 1)},
         teleopEnabled{false}
     {
         setObjectName("MissionControl");
@@ -120,11 +121,23 @@ namespace tfr_mission_control {
                 [this] () {performTeleop(tfr_utilities::TeleopCode::DIG);});
 
         /* for commands which do the turntable/drivebase we want to kill the
-         * motors after release*/
+         * motors after release. The turntable jogs stop on their own unless
+         * they keep coming, so those buttons repeat while they're held, and
+         * stop the turntable right away once they're let go. A repeating
+         * button is released between repeats too, but it's still down then*/
+        for (auto button : {ui.cw_button, ui.ccw_button})
+        {
+            button->setAutoRepeat(true);
+            button->setAutoRepeatDelay(JOG_INTERVAL);
+            button->setAutoRepeatInterval(JOG_INTERVAL);
+        }
         connect(ui.cw_button,&QPushButton::clicked,
                 [this] () {performTeleop(tfr_utilities::TeleopCode::CLOCKWISE);});
         connect(ui.ccw_button,&QPushButton::clicked,
                 [this] () {performTeleop(tfr_utilities::TeleopCode::COUNTERCLOCKWISE);});
+        for (auto button : {ui.cw_button, ui.ccw_button})
+            connect(button,&QPushButton::released,
+                    [this, button] () {if (!button->isDown()) stopTurntable();});
         connect(ui.raise_arm_button,&QPushButton::clicked,
                 [this] () {performTeleop(tfr_utilities::TeleopCode::RAISE_ARM);});
         connect(ui.forward_button,&QPushButton::pressed,
@@ -162,6 +175,7 @@ namespace tfr_mission_control {
     {
         //note because qt plugins are weird we need to manually kill ros entities
         com.shutdown();
+        jog_publisher.shutdown();
         autonomy.cancelAllGoals();
         autonomy.stopTrackingGoal();
         teleop.cancelAllGoals();
@@ -284,6 +298,18 @@ namespace tfr_mission_control {
      * */
     bool MissionControl::eventFilter(QObject* obj, QEvent* event)
     {
+        //a held key repeats as a release and a press, only stop the
+        //turntable for the real release
+        if (event->type()==QEvent::KeyRelease && teleopEnabled) {
+            QKeyEvent* key = static_cast<QKeyEvent*>(event);
+            auto  k = static_cast<Qt::Key>(key->key());
+            if (!key->isAutoRepeat() && (k == Qt::Key_Q || k == Qt::Key_E))
+            {
+                stopTurntable();
+                return true;
+            }
+            return QObject::eventFilter(obj, event);
+        }
         if (event->type()==QEvent::KeyPress && teleopEnabled) {
             QKeyEvent* key = static_cast<QKeyEvent*>(event);
             auto  k = static_cast<Qt::Key>(key->key());
@@ -307,6 +333,13 @@ namespace tfr_mission_control {
                     motorKill->start(MOTOR_INTERVAL);
                     performTeleop(tfr_utilities::TeleopCode::RIGHT);
                     break;
+                //releasing the key stops the turntable, no watchdog needed
+                case (Qt::Key_Q):
+                    performTeleop(tfr_utilities::TeleopCode::COUNTERCLOCKWISE);
+                    break;
+                case (Qt::Key_E):
+                    performTeleop(tfr_utilities::TeleopCode::CLOCKWISE);
+                    break;
             }
             //consume the key
             return true;
@@ -392,6 +425,15 @@ namespace tfr_mission_control {
         widget->setFocus();
     }
 
+    //stops a turntable jog without waiting for its deadman
+    void MissionControl::stopTurntable()
+    {
+        tfr_msgs::ArmJog jog;
+        jog.header.stamp = ros::Time::now();
+        jog.velocity = {0, 0, 0, 0};
+        jog_publisher.publish(jog);
+    }
+
     //performs a teleop command asynchronously 
     void MissionControl::performTeleop(tfr_utilities::TeleopCode code)
     {
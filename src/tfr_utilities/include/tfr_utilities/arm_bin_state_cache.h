@@ -0,0 +1,63 @@
+/*
+ * Keeps the newest bin and arm state published by the control node, so
+ * callers can read it without a service round trip, or sleep until it
+ * satisfies some condition.
+ *
+ * The control node publishes every cycle on a latched topic, so a new cache
+ * has a state as soon as it connects, and a waiter wakes within one control
+ * cycle of its condition holding.
+ *
+ * Callbacks have to be serviced by another thread (a spinner, or ros::spin
+ * in main while an action server runs goals) for waitFor to see updates.
+ * Safe to use from any thread.
+ * */
+#ifndef ARM_BIN_STATE_CACHE_H
+#define ARM_BIN_STATE_CACHE_H
+
+#include <ros/ros.h>
+#include <tfr_msgs/ArmBinState.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tfr_utilities
+{
+    class ArmBinStateCache
+    {
+        public:
+            using Predicate = std::function<bool(const tfr_msgs::ArmBinState&)>;
+
+            explicit ArmBinStateCache(ros::NodeHandle &n,
+                    const std::string &topic = "/arm_bin_state");
+            ~ArmBinStateCache() = default;
+            ArmBinStateCache(const ArmBinStateCache&) = delete;
+            ArmBinStateCache& operator=(const ArmBinStateCache&) = delete;
+            ArmBinStateCache(ArmBinStateCache&&) = delete;
+            ArmBinStateCache& operator=(ArmBinStateCache&&) = delete;
+
+            /*
+             * The newest state, false if none has arrived yet
+             * */
+            bool getState(tfr_msgs::ArmBinState &state) const;
+            bool getBin(double &bin) const;
+            bool getArm(std::vector<double> &arm) const;
+
+            /*
+             * Blocks until the newest state satisfies predicate, or timeout
+             * passes. Returns whether it was satisfied.
+             * */
+            bool waitFor(const Predicate &predicate, const ros::Duration &timeout) const;
+
+        private:
+            ros::Subscriber subscriber;
+            mutable std::mutex mutex;
+            mutable std::condition_variable updated;
+            tfr_msgs::ArmBinState::ConstPtr latest;
+
+            void stateCallback(const tfr_msgs::ArmBinState::ConstPtr &msg);
+    };
+}
+
+#endif
@@ -5,10 +5,21 @@
 #include <tfr_msgs/ArmMoveAction.h>
 #include <actionlib/server/simple_action_server.h>
 #include <trajectory_msgs/JointTrajectory.h>
+#include <std_srvs/SetBool.h>
+#include <tfr_utilities/arm_bin_state_cache.h>
+#include <tfr_utilities/time_optimal_path.h>
 
 /**
  * Provides a simple method for moving the arm without MoveIt.
  * This is a regular ole' class, just instantiate it and call moveArm.
+ *
+ * Moves go in a straight line from where the arm is, as fast as the joint
+ * limits MoveIt uses allow, see tfr_utilities/time_optimal_path.h. Those are
+ * in tfr_moveit/config/joint_limits.yaml, measured by the control node's
+ * calibration.
+ *
+ * The arm trajectory controllers are switched back in before each move, in
+ * case teleop left the jog controller in, see /toggle_arm_jog.
  * */
 class ArmManipulator
 {
@@ -28,11 +39,17 @@ class ArmManipulator
 		 * 
 		 *  - The method is not blocking, so the caller needs to wait for the arm to move.
 		 *    See digging_action_server.cpp for example.
+		 *
+		 *  - Callbacks have to be serviced by another thread to know where
+		 *    the arm is, see arm_bin_state_cache.h.
          * */
         void moveArm( const double& turntable, const double& lower_arm, const double& upper_arm, const double& scoop);
     private:
         ros::Publisher trajectory_publisher;
         ros::Publisher scoop_trajectory_publisher;
+        ros::ServiceClient jog_client;
+        tfr_utilities::ArmBinStateCache arm_state;
+        const tfr_utilities::TimeOptimalPath timing;
  };
 
 #endif
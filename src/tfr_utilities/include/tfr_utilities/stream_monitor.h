@@ -0,0 +1,116 @@
+/*
+ * Tracks the health of a stream of stamped, sequence numbered sensor readings
+ * from the consumer's point of view.
+ *
+ * The consumer calls update() once per cycle with the newest reading it has,
+ * and whether that reading arrived since the last cycle. We keep the age of
+ * the newest reading, how many sequence numbers were skipped (dropped in
+ * transport or overwritten before we got to them), and whether the stream
+ * has gone stale, so the consumer can degrade in a defined way rather than
+ * silently reuse old data.
+ *
+ * Only one thread may call update(), the getters are safe from any thread.
+ * */
+#ifndef STREAM_MONITOR_H
+#define STREAM_MONITOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+
+namespace tfr_utilities
+{
+    class StreamMonitor
+    {
+        public:
+            /*
+             * timeout is how old in seconds the newest reading may get before
+             * the stream is considered stale
+             * */
+            explicit StreamMonitor(double stale_timeout) :
+                timeout{stale_timeout}, last_seq{0}, last_stamp{0}, age{0},
+                received{0}, dropped{0}, stale_events{0}, stale{true}
+            {}
+            ~StreamMonitor() = default;
+            StreamMonitor(const StreamMonitor&) = delete;
+            StreamMonitor& operator=(const StreamMonitor&) = delete;
+            StreamMonitor(StreamMonitor&&) = delete;
+            StreamMonitor& operator=(StreamMonitor&&) = delete;
+
+            /*
+             * fresh: the reading arrived since the last update
+             * seq, stamp: sequence number and acquisition time (s) of the
+             * newest reading
+             * now: current time (s) on the same clock as stamp
+             *
+             * returns whether the stream is stale
+             * */
+            bool update(bool fresh, uint32_t seq, double stamp, double now)
+            {
+                uint64_t count = received.load(std::memory_order_relaxed);
+                if (fresh)
+                {
+                    //unsigned difference handles wrap around, a huge gap means
+                    //the publisher restarted so we don't count it
+                    uint32_t gap = seq - last_seq;
+                    if (count > 0 && gap > 1 && gap < (1u << 31))
+                        dropped.fetch_add(gap - 1, std::memory_order_relaxed);
+                    last_seq = seq;
+                    last_stamp = stamp;
+                    received.store(++count, std::memory_order_relaxed);
+                }
+
+                double current_age = (count == 0) ?
+                    std::numeric_limits<double>::infinity() :
+                    std::max(now - last_stamp, 0.0);
+                age.store(current_age, std::memory_order_relaxed);
+
+                bool now_stale = current_age > timeout;
+                if (now_stale && !stale.load(std::memory_order_relaxed))
+                    stale_events.fetch_add(1, std::memory_order_relaxed);
+                stale.store(now_stale, std::memory_order_relaxed);
+                return now_stale;
+            }
+
+            bool isStale() const
+            {
+                return stale.load(std::memory_order_relaxed);
+            }
+
+            //seconds since the newest reading was acquired, inf if none yet
+            double getAge() const
+            {
+                return age.load(std::memory_order_relaxed);
+            }
+
+            uint64_t getReceived() const
+            {
+                return received.load(std::memory_order_relaxed);
+            }
+
+            uint64_t getDropped() const
+            {
+                return dropped.load(std::memory_order_relaxed);
+            }
+
+            //how many times the stream went from fresh to stale
+            uint64_t getStaleEvents() const
+            {
+                return stale_events.load(std::memory_order_relaxed);
+            }
+
+        private:
+            const double timeout;
+            //owned by the updating thread
+            uint32_t last_seq;
+            double last_stamp;
+
+            std::atomic<double> age;
+            std::atomic<uint64_t> received;
+            std::atomic<uint64_t> dropped;
+            std::atomic<uint64_t> stale_events;
+            std::atomic<bool> stale;
+    };
+}
+#endif
@@ -0,0 +1,108 @@
+/*
+ * Times a path through joint space as fast as the actuators allow, given the
+ * most velocity and acceleration each joint can manage.
+ *
+ * The path is the straight lines between the waypoints, sampled every
+ * resolution (rad) of its length. Along it the speed is limited by whichever
+ * joint hits its velocity or acceleration limit first, accounting for the
+ * acceleration the path's curvature takes at speed. A backward pass finds how
+ * fast each sample can go and still stop in time, then a forward pass
+ * accelerates as hard as the limits and that allow, the classic time optimal
+ * bang-bang profile. It starts and ends at rest.
+ *
+ * With a deviation (rad) each corner between waypoints is blended with an
+ * arc that stays within it of the corner, so the path passes by the
+ * waypoint at whatever speed the arc's curvature allows instead of stopping
+ * there. Only where the path doubles straight back is there nothing to
+ * blend, and it stops.
+ *
+ * Without one, corners are crossed at whatever speed the curvature at that
+ * sample allows, so a sharp corner can briefly ask for more acceleration
+ * than the limit. Where the path doubles back, turning through more than a
+ * right angle, it stops. Either way each stretch between stops is timed on
+ * its own. Dense paths like MoveIt's come out smooth, and a single straight
+ * line is an exact trapezoid, or triangle if it's too short to reach full
+ * speed.
+ *
+ * Knows nothing about ROS, so the arm action server can time MoveIt plans
+ * and ArmManipulator its direct moves with the same limits.
+ * */
+#ifndef TIME_OPTIMAL_PATH_H
+#define TIME_OPTIMAL_PATH_H
+
+#include <vector>
+
+namespace tfr_utilities
+{
+    class TimeOptimalPath
+    {
+        public:
+            struct Limits
+            {
+                //per joint, rad/s and rad/s^2, all positive
+                std::vector<double> velocity;
+                std::vector<double> acceleration;
+            };
+
+            struct Point
+            {
+                //seconds from the start
+                double time;
+                std::vector<double> position;
+                std::vector<double> velocity;
+                std::vector<double> acceleration;
+            };
+
+            TimeOptimalPath(const Limits &limits, double resolution,
+                    double deviation = 0);
+            ~TimeOptimalPath() = default;
+            TimeOptimalPath(const TimeOptimalPath&) = delete;
+            TimeOptimalPath& operator=(const TimeOptimalPath&) = delete;
+            TimeOptimalPath(TimeOptimalPath&&) = delete;
+            TimeOptimalPath& operator=(TimeOptimalPath&&) = delete;
+
+            /*
+             * Samples and times the path through waypoints, every waypoint is
+             * one of the samples unless its corner is blended. A path that
+             * goes nowhere is a single point at 0. Returns false if the
+             * waypoints don't match the limits, or they're too tight to move
+             * at all.
+             * */
+            bool compute(const std::vector<std::vector<double>> &waypoints,
+                    std::vector<Point> &profile) const;
+
+        private:
+            const Limits limits;
+            const double resolution;
+            const double deviation;
+
+            //u = s'' bounds at a sample are lines in x = s'^2, see the .cpp
+            struct Line
+            {
+                double offset, slope;
+            };
+            struct Bounds
+            {
+                std::vector<Line> lower, upper;
+                double max_x;
+            };
+
+            //times a path that doesn't double back, from rest to rest
+            bool computePiece(const std::vector<std::vector<double>> &waypoints,
+                    std::vector<Point> &profile) const;
+            //the lines and blends through waypoints every resolution, with
+            //the length along the path to each sample and dq/ds and d2q/ds2
+            //there
+            void sample(const std::vector<std::vector<double>> &waypoints,
+                    std::vector<std::vector<double>> &samples,
+                    std::vector<double> &s,
+                    std::vector<std::vector<double>> &first,
+                    std::vector<std::vector<double>> &second) const;
+            Bounds boundsAt(const std::vector<double> &first,
+                    const std::vector<double> &second) const;
+            //the lowest of the lines at x
+            static double lowest(const std::vector<Line> &lines, double x);
+    };
+}
+
+#endif
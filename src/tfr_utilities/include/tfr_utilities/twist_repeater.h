@@ -0,0 +1,58 @@
+/*
+ * Publishes drivebase twists for nodes that set a velocity and then sleep
+ * or block for a while.
+ *
+ * The skid steer controller lets a moving twist expire after its source's
+ * timeout, so a node that publishes once would stop after the timeout. This
+ * re-publishes the latest twist at a fixed rate for as long as it moves,
+ * which keeps it live until the node replaces it, and lets it expire
+ * shortly after the node dies. A stop is only published once, so the treads
+ * go back to lower priority sources after the controller's stop_hold.
+ *
+ * Repeats happen on a ros::Timer, so callbacks have to be serviced by another
+ * thread (a spinner, or ros::spin in main while an action server runs goals).
+ * Safe to use from any thread.
+ * */
+#ifndef TWIST_REPEATER_H
+#define TWIST_REPEATER_H
+
+#include <ros/ros.h>
+#include <geometry_msgs/Twist.h>
+#include <mutex>
+#include <string>
+
+namespace tfr_utilities
+{
+    class TwistRepeater
+    {
+        public:
+            /*
+             * rate is how often (hz) a moving twist is repeated, it needs to
+             * beat the source's timeout in the skid steer controller
+             * */
+            TwistRepeater(ros::NodeHandle &n, const std::string &topic,
+                    double rate = 10.0);
+            ~TwistRepeater() = default;
+            TwistRepeater(const TwistRepeater&) = delete;
+            TwistRepeater& operator=(const TwistRepeater&) = delete;
+            TwistRepeater(TwistRepeater&&) = delete;
+            TwistRepeater& operator=(TwistRepeater&&) = delete;
+
+            /*
+             * Publishes twist now, and keeps repeating it until the next
+             * call if it moves
+             * */
+            void publish(const geometry_msgs::Twist &twist);
+
+        private:
+            ros::Publisher publisher;
+            ros::Timer timer;
+            std::mutex mutex;
+            geometry_msgs::Twist latest;
+            bool moving;
+
+            void repeat(const ros::TimerEvent &event);
+    };
+}
+
+#endif
@@ -0,0 +1,59 @@
+#include <arm_bin_state_cache.h>
+#include <chrono>
+
+namespace tfr_utilities
+{
+    ArmBinStateCache::ArmBinStateCache(ros::NodeHandle &n, const std::string &topic) :
+        subscriber{n.subscribe(topic, 1, &ArmBinStateCache::stateCallback, this)}
+    {}
+
+    bool ArmBinStateCache::getState(tfr_msgs::ArmBinState &state) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (latest == nullptr)
+            return false;
+        state = *latest;
+        return true;
+    }
+
+    bool ArmBinStateCache::getBin(double &bin) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (latest == nullptr)
+            return false;
+        bin = latest->bin;
+        return true;
+    }
+
+    bool ArmBinStateCache::getArm(std::vector<double> &arm) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (latest == nullptr)
+            return false;
+        arm = latest->arm;
+        return true;
+    }
+
+    bool ArmBinStateCache::waitFor(const Predicate &predicate,
+            const ros::Duration &timeout) const
+    {
+        auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration<double>(timeout.toSec());
+        std::unique_lock<std::mutex> lock(mutex);
+        return updated.wait_until(lock, deadline,
+                [&]{ return latest != nullptr && predicate(*latest); });
+    }
+
+    /*
+     * Messages are immutable once published, so holding the pointer is as
+     * good as a copy
+     * */
+    void ArmBinStateCache::stateCallback(const tfr_msgs::ArmBinState::ConstPtr &msg)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            latest = msg;
+        }
+        updated.notify_all();
+    }
+}
@@ -1,33 +1,103 @@
 #include <arm_manipulator.h>
 
+namespace
+{
+    const std::vector<std::string> ARM_JOINTS{"turntable_joint", "lower_arm_joint",
+        "upper_arm_joint", "scoop_joint"};
+    //the arm controller has the first three joints, the scoop controller the last
+    const size_t ARM_CONTROLLER_JOINTS = 3;
+    //how finely moves are sampled (rad), they're straight so this only sets
+    //how many points the controllers interpolate between
+    const double RESOLUTION = 0.05;
+    //how long to give a move when we don't know where the arm is (s)
+    const double BLIND_TIME = 3.0;
+
+    /*
+     * The limit MoveIt uses for the joint, kind being velocity or acceleration,
+     * or MoveIt's own default of 1 if there isn't one
+     * */
+    double limitOf(const std::string &joint, const std::string &kind)
+    {
+        const std::string prefix = "robot_description_planning/joint_limits/" + joint;
+        bool bounded = false;
+        double value = 0;
+        ros::param::get(prefix + "/has_" + kind + "_limits", bounded);
+        ros::param::get(prefix + "/max_" + kind, value);
+        return bounded && value > 0 ? value : 1.0;
+    }
+
+    tfr_utilities::TimeOptimalPath::Limits loadLimits()
+    {
+        tfr_utilities::TimeOptimalPath::Limits limits;
+        for (const auto &joint : ARM_JOINTS)
+        {
+            limits.velocity.push_back(limitOf(joint, "velocity"));
+            limits.acceleration.push_back(limitOf(joint, "acceleration"));
+        }
+        return limits;
+    }
+
+    trajectory_msgs::JointTrajectoryPoint pointOf(
+            const tfr_utilities::TimeOptimalPath::Point &point, size_t first, size_t last)
+    {
+        trajectory_msgs::JointTrajectoryPoint result;
+        result.positions.assign(point.position.begin() + first, point.position.begin() + last);
+        result.velocities.assign(point.velocity.begin() + first, point.velocity.begin() + last);
+        result.accelerations.assign(point.acceleration.begin() + first,
+                point.acceleration.begin() + last);
+        result.time_from_start = ros::Duration(point.time);
+        return result;
+    }
+}
+
 ArmManipulator::ArmManipulator(ros::NodeHandle &n):
             trajectory_publisher{n.advertise<trajectory_msgs::JointTrajectory>("/arm_controller/command", 5)},
-            scoop_trajectory_publisher{n.advertise<trajectory_msgs::JointTrajectory>("/arm_end_controller/command", 5)}
+            scoop_trajectory_publisher{n.advertise<trajectory_msgs::JointTrajectory>("/arm_end_controller/command", 5)},
+            jog_client{n.serviceClient<std_srvs::SetBool>("/toggle_arm_jog")},
+            arm_state{n},
+            timing{loadLimits(), RESOLUTION}
 { }
 
 void  ArmManipulator::moveArm(const double& turntable, const double& lower_arm ,const double& upper_arm,  const double& scoop )
 {
+    std::vector<double> goal{turntable, lower_arm, upper_arm, scoop};
+    std::vector<double> start;
+    std::vector<tfr_utilities::TimeOptimalPath::Point> profile;
+    bool known = arm_state.getArm(start);
+    if (!known || !timing.compute({start, goal}, profile))
+    {
+        if (known)
+            ROS_WARN("Arm Manipulator: couldn't time the move, moving over %f s", BLIND_TIME);
+        else
+            ROS_WARN("Arm Manipulator: don't know where the arm is, moving over %f s", BLIND_TIME);
+        std::vector<double> still(goal.size(), 0);
+        profile = {tfr_utilities::TimeOptimalPath::Point{0, start, still, still},
+            tfr_utilities::TimeOptimalPath::Point{BLIND_TIME, goal, still, still}};
+    }
+
     trajectory_msgs::JointTrajectory trajectory;
     trajectory.header.stamp = ros::Time::now();
-    trajectory.joint_names.resize(3);
-    trajectory.points.resize(1);
-    trajectory.points[0].positions.resize(3);
-    trajectory.joint_names[0]="turntable_joint";
-    trajectory.joint_names[1]="lower_arm_joint";
-    trajectory.joint_names[2]="upper_arm_joint";
-    trajectory.points[0].positions[0] = turntable;
-    trajectory.points[0].positions[1] = lower_arm;
-    trajectory.points[0].positions[2] = upper_arm;
-    trajectory.points[0].time_from_start = ros::Duration(0.06);
-    trajectory_publisher.publish(trajectory);
+    trajectory.joint_names.assign(ARM_JOINTS.begin(), ARM_JOINTS.begin() + ARM_CONTROLLER_JOINTS);
 
     trajectory_msgs::JointTrajectory scoop_trajectory;
-    scoop_trajectory.header.stamp = ros::Time::now();
-    scoop_trajectory.joint_names.resize(1);
-    scoop_trajectory.points.resize(1);
-    scoop_trajectory.points[0].positions.resize(1);
-    scoop_trajectory.joint_names[0]="scoop_joint";
-    scoop_trajectory.points[0].positions[0] = scoop;
-    scoop_trajectory.points[0].time_from_start = ros::Duration(0.06);
+    scoop_trajectory.header.stamp = trajectory.header.stamp;
+    scoop_trajectory.joint_names.assign(ARM_JOINTS.begin() + ARM_CONTROLLER_JOINTS, ARM_JOINTS.end());
+
+    //the first point is where the arm is, the controllers start from there anyway
+    for (size_t i = 1; i < profile.size(); i++)
+    {
+        trajectory.points.push_back(pointOf(profile[i], 0, ARM_CONTROLLER_JOINTS));
+        scoop_trajectory.points.push_back(pointOf(profile[i], ARM_CONTROLLER_JOINTS, ARM_JOINTS.size()));
+    }
+    //already there
+    if (trajectory.points.empty())
+        return;
+    //teleop may have left the jog controller in
+    std_srvs::SetBool release;
+    release.request.data = false;
+    if (!jog_client.call(release) || !release.response.success)
+        ROS_WARN("Arm Manipulator: couldn't switch back from arm jog, %s",
+                release.response.message.c_str());
+    trajectory_publisher.publish(trajectory);
     scoop_trajectory_publisher.publish(scoop_trajectory);
 }
@@ -0,0 +1,364 @@
+#include <time_optimal_path.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace tfr_utilities
+{
+    namespace
+    {
+        constexpr double EPSILON = 1e-9;
+        //turns smaller than this are straight on, and ones within it of a
+        //half turn double straight back, there's no circle to blend them
+        constexpr double STRAIGHT = 1e-6;
+        constexpr double PI = 3.14159265358979323846;
+        //most an arc turns between samples, however tight it is. Its
+        //acceleration is only bounded at the samples, this keeps what it
+        //asks for between them within a few percent of the limit
+        constexpr double ARC_STEP = 0.02;
+
+        double distance(const std::vector<double> &a, const std::vector<double> &b)
+        {
+            double total = 0;
+            for (size_t j = 0; j < a.size(); j++)
+                total += (a[j] - b[j]) * (a[j] - b[j]);
+            return std::sqrt(total);
+        }
+
+        //the angle the path turns through at b, 0 going straight on
+        double turn(const std::vector<double> &a, const std::vector<double> &b,
+                const std::vector<double> &c)
+        {
+            double dot = 0;
+            for (size_t j = 0; j < a.size(); j++)
+                dot += (b[j] - a[j]) * (c[j] - b[j]);
+            dot /= distance(a, b) * distance(b, c);
+            return std::acos(std::max(-1.0, std::min(1.0, dot)));
+        }
+    }
+
+    TimeOptimalPath::TimeOptimalPath(const Limits &l, double r, double d) :
+        limits(l), resolution{r}, deviation{d} {}
+
+    bool TimeOptimalPath::compute(const std::vector<std::vector<double>> &waypoints,
+            std::vector<Point> &profile) const
+    {
+        profile.clear();
+        const size_t joints = limits.velocity.size();
+        if (waypoints.empty() || resolution <= 0 || limits.acceleration.size() != joints)
+            return false;
+        for (size_t j = 0; j < joints; j++)
+            if (!(limits.velocity[j] > 0) || !(limits.acceleration[j] > 0))
+                return false;
+        for (const auto &waypoint : waypoints)
+            if (waypoint.size() != joints)
+                return false;
+
+        std::vector<std::vector<double>> path{waypoints.front()};
+        for (const auto &waypoint : waypoints)
+            if (distance(path.back(), waypoint) >= EPSILON)
+                path.push_back(waypoint);
+        if (path.size() == 1)
+        {
+            std::vector<double> still(joints, 0);
+            profile.push_back(Point{0, path.front(), still, still});
+            return true;
+        }
+
+        //points in the middle of a straight line are dropped when blending,
+        //so the corners either side can blend over all of it
+        if (deviation > 0)
+        {
+            std::vector<std::vector<double>> corners{path.front()};
+            for (size_t k = 1; k + 1 < path.size(); k++)
+                if (turn(corners.back(), path[k], path[k + 1]) >= STRAIGHT)
+                    corners.push_back(path[k]);
+            corners.push_back(path.back());
+            path.swap(corners);
+        }
+
+        //the path has to stop where it can't be blended, it doubles straight
+        //back or, without blending, turns through more than a right angle.
+        //The derivatives there are meaningless, so each stretch between is
+        //timed on its own
+        const double sharpest = deviation > 0 ? PI - STRAIGHT : PI / 2;
+        size_t start = 0;
+        for (size_t k = 1; k < path.size(); k++)
+        {
+            if (k + 1 < path.size() && turn(path[k - 1], path[k], path[k + 1]) <= sharpest)
+                continue;
+            std::vector<Point> piece;
+            if (!computePiece(std::vector<std::vector<double>>(path.begin() + start,
+                            path.begin() + k + 1), piece))
+            {
+                profile.clear();
+                return false;
+            }
+            //the pieces meet at rest, so the first point repeats the last
+            double offset = profile.empty() ? 0 : profile.back().time;
+            for (size_t i = profile.empty() ? 0 : 1; i < piece.size(); i++)
+            {
+                piece[i].time += offset;
+                profile.push_back(piece[i]);
+            }
+            start = k;
+        }
+        return true;
+    }
+
+    bool TimeOptimalPath::computePiece(const std::vector<std::vector<double>> &waypoints,
+            std::vector<Point> &profile) const
+    {
+        const size_t joints = limits.velocity.size();
+
+        std::vector<std::vector<double>> samples, first, second;
+        std::vector<double> s;
+        sample(waypoints, samples, s, first, second);
+        const size_t n = samples.size();
+
+        std::vector<Bounds> bounds;
+        bounds.reserve(n);
+        for (size_t i = 0; i < n; i++)
+            bounds.push_back(boundsAt(first[i], second[i]));
+
+        //backward, the fastest each sample can go and still stop at the end,
+        //the largest x with x + 2 h lower(x) <= the next sample's x
+        std::vector<double> x(n, 0);
+        for (size_t i = n - 1; i-- > 0;)
+        {
+            double h = s[i + 1] - s[i];
+            double best = bounds[i].max_x;
+            for (const auto &line : bounds[i].lower)
+            {
+                double slope = 1 + 2 * h * line.slope;
+                if (slope > EPSILON)
+                    best = std::min(best, (x[i + 1] - 2 * h * line.offset) / slope);
+            }
+            x[i] = std::max(0.0, best);
+        }
+
+        //forward, accelerating as hard as allowed from rest
+        x[0] = 0;
+        for (size_t i = 0; i + 1 < n; i++)
+        {
+            double h = s[i + 1] - s[i];
+            double reachable = x[i] + 2 * h * lowest(bounds[i].upper, x[i]);
+            x[i + 1] = std::max(0.0, std::min(x[i + 1], reachable));
+        }
+
+        //constant s'' between samples
+        double time = 0, accel = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (i > 0)
+            {
+                double speeds = std::sqrt(x[i - 1]) + std::sqrt(x[i]);
+                if (speeds < EPSILON)
+                    return false;
+                time += 2 * (s[i] - s[i - 1]) / speeds;
+            }
+            if (i + 1 < n)
+                accel = (x[i + 1] - x[i]) / (2 * (s[i + 1] - s[i]));
+            Point point{time, samples[i], std::vector<double>(joints),
+                std::vector<double>(joints)};
+            for (size_t j = 0; j < joints; j++)
+            {
+                point.velocity[j] = first[i][j] * std::sqrt(x[i]);
+                point.acceleration[j] = first[i][j] * accel + second[i][j] * x[i];
+            }
+            profile.push_back(point);
+        }
+        return true;
+    }
+
+    /*
+     * Each corner is blended with the arc of a circle tangent to both lines,
+     * as in Kunz and Stilman's time optimal trajectory generation. Turning
+     * through angle at a corner, the arc starts and ends
+     *      length = deviation sin(angle / 2) / (1 - cos(angle / 2))
+     * along the lines from it, which keeps it within deviation of the
+     * corner, but no more than halfway along either line so the next blend
+     * fits. Its radius is length / tan(angle / 2).
+     * */
+    void TimeOptimalPath::sample(const std::vector<std::vector<double>> &waypoints,
+            std::vector<std::vector<double>> &samples, std::vector<double> &s,
+            std::vector<std::vector<double>> &first,
+            std::vector<std::vector<double>> &second) const
+    {
+        const size_t joints = limits.velocity.size();
+        const size_t m = waypoints.size();
+
+        //the turn at each corner, and how far from it the blend starts
+        std::vector<double> angles(m, 0), lengths(m, 0);
+        for (size_t k = 1; deviation > 0 && k + 1 < m; k++)
+        {
+            angles[k] = turn(waypoints[k - 1], waypoints[k], waypoints[k + 1]);
+            if (angles[k] < STRAIGHT)
+                continue;
+            lengths[k] = std::min({distance(waypoints[k - 1], waypoints[k]) / 2,
+                    distance(waypoints[k], waypoints[k + 1]) / 2,
+                    deviation * std::sin(angles[k] / 2) / (1 - std::cos(angles[k] / 2))});
+        }
+
+        //sample each line and arc at no more than resolution apart, s is
+        //the length along the path so far. Two steps at the least, a line
+        //needs a sample to speed up to between starting and stopping
+        std::vector<double> still(joints, 0);
+        samples.assign(1, waypoints.front());
+        s.assign(1, 0);
+        first.assign(1, still);
+        second.assign(1, still);
+        //arcs know their derivatives exactly, including at the ends where
+        //they meet the lines, the rest are found by finite differences
+        std::vector<bool> exact{false};
+        for (size_t k = 0; k + 1 < m; k++)
+        {
+            const auto &corner = waypoints[k + 1];
+            double line = distance(waypoints[k], corner);
+            std::vector<double> in(joints);
+            for (size_t j = 0; j < joints; j++)
+                in[j] = (corner[j] - waypoints[k][j]) / line;
+
+            //the straight part, up to where the blend at its end starts.
+            //Blends that meet halfway leave nothing of it
+            std::vector<double> from = samples.back();
+            std::vector<double> to(joints);
+            for (size_t j = 0; j < joints; j++)
+                to[j] = corner[j] - in[j] * lengths[k + 1];
+            double length = distance(from, to);
+            int steps = std::max(2, static_cast<int>(std::ceil(length / resolution)));
+            double start = s.back();
+            for (int step = 1; length >= EPSILON && step <= steps; step++)
+            {
+                double t = static_cast<double>(step) / steps;
+                std::vector<double> sample(joints);
+                for (size_t j = 0; j < joints; j++)
+                    sample[j] = from[j] + (to[j] - from[j]) * t;
+                samples.push_back(sample);
+                s.push_back(start + length * t);
+                first.push_back(still);
+                second.push_back(still);
+                exact.push_back(false);
+            }
+            if (lengths[k + 1] == 0)
+                continue;
+
+            //the arc, center + radius (x cos(a) + y sin(a)) from where the
+            //line left off, a going from 0 to the angle turned
+            const auto &next = waypoints[k + 2];
+            double angle = angles[k + 1];
+            double radius = lengths[k + 1] / std::tan(angle / 2);
+            std::vector<double> inward(joints);
+            for (size_t j = 0; j < joints; j++)
+                inward[j] = (next[j] - corner[j]) / distance(corner, next) - in[j];
+            double norm = std::sqrt(std::inner_product(inward.begin(), inward.end(),
+                        inward.begin(), 0.0));
+            std::vector<double> x(joints);
+            for (size_t j = 0; j < joints; j++)
+            {
+                double center = corner[j] + inward[j] / norm * radius / std::cos(angle / 2);
+                x[j] = (to[j] - center) / radius;
+            }
+            steps = static_cast<int>(std::ceil(std::max(angle / ARC_STEP,
+                            radius * angle / resolution)));
+            start = s.back();
+            exact.back() = true;
+            for (int step = 0; step <= steps; step++)
+            {
+                double a = angle * step / steps;
+                if (step > 0)
+                {
+                    std::vector<double> sample(joints);
+                    for (size_t j = 0; j < joints; j++)
+                    {
+                        sample[j] = to[j] + radius * (x[j] * (std::cos(a) - 1) +
+                                in[j] * std::sin(a));
+                    }
+                    samples.push_back(sample);
+                    s.push_back(start + radius * a);
+                    first.push_back(still);
+                    second.push_back(still);
+                    exact.push_back(true);
+                }
+                for (size_t j = 0; j < joints; j++)
+                {
+                    first.back()[j] = in[j] * std::cos(a) - x[j] * std::sin(a);
+                    second.back()[j] = -(x[j] * std::cos(a) + in[j] * std::sin(a)) / radius;
+                }
+            }
+        }
+
+        //dq/ds and d2q/ds2 at the rest
+        const size_t n = samples.size();
+        for (size_t i = 0; i < n; i++)
+        {
+            if (exact[i])
+                continue;
+            size_t before = i == 0 ? 0 : i - 1;
+            size_t after = i == n - 1 ? n - 1 : i + 1;
+            double span = s[after] - s[before];
+            for (size_t j = 0; j < joints; j++)
+                first[i][j] = (samples[after][j] - samples[before][j]) / span;
+            if (i == 0 || i == n - 1)
+                continue;
+            double back = s[i] - s[i - 1], ahead = s[i + 1] - s[i];
+            for (size_t j = 0; j < joints; j++)
+            {
+                second[i][j] = ((samples[i + 1][j] - samples[i][j]) / ahead -
+                        (samples[i][j] - samples[i - 1][j]) / back) / (span / 2);
+            }
+        }
+    }
+
+    /*
+     * Joint j moves at q' s' and accelerates at q' s'' + q'' s'^2, so with
+     * x = s'^2 its limits are
+     *      x <= (v / q')^2
+     *      -a <= q' s'' + q'' x <= a
+     * the second being two lines bounding s'' for any x. The highest lower
+     * line and lowest upper line leave an interval of s'' that closes up
+     * once x is too high, that's max_x along with the velocity limits.
+     * */
+    TimeOptimalPath::Bounds TimeOptimalPath::boundsAt(const std::vector<double> &first,
+            const std::vector<double> &second) const
+    {
+        Bounds bounds;
+        bounds.max_x = std::numeric_limits<double>::infinity();
+        for (size_t j = 0; j < first.size(); j++)
+        {
+            double slope = first[j], curve = second[j];
+            double velocity = limits.velocity[j], acceleration = limits.acceleration[j];
+            if (std::abs(slope) > EPSILON)
+            {
+                bounds.max_x = std::min(bounds.max_x, (velocity / slope) * (velocity / slope));
+                Line low{-acceleration / slope, -curve / slope};
+                Line high{acceleration / slope, -curve / slope};
+                if (slope < 0)
+                    std::swap(low, high);
+                bounds.lower.push_back(low);
+                bounds.upper.push_back(high);
+            }
+            else if (std::abs(curve) > EPSILON)
+                bounds.max_x = std::min(bounds.max_x, acceleration / std::abs(curve));
+        }
+        for (const auto &low : bounds.lower)
+        {
+            for (const auto &high : bounds.upper)
+            {
+                double closing = low.slope - high.slope;
+                if (closing > EPSILON)
+                    bounds.max_x = std::min(bounds.max_x, (high.offset - low.offset) / closing);
+            }
+        }
+        return bounds;
+    }
+
+    double TimeOptimalPath::lowest(const std::vector<Line> &lines, double x)
+    {
+        double result = std::numeric_limits<double>::infinity();
+        for (const auto &line : lines)
+            result = std::min(result, line.offset + line.slope * x);
+        return result;
+    }
+}
@@ -0,0 +1,26 @@
+#include <twist_repeater.h>
+
+namespace tfr_utilities
+{
+    TwistRepeater::TwistRepeater(ros::NodeHandle &n, const std::string &topic,
+            double rate) :
+        publisher{n.advertise<geometry_msgs::Twist>(topic, 1)},
+        timer{n.createTimer(ros::Duration(1.0 / rate), &TwistRepeater::repeat, this)},
+        latest{}, moving{false}
+    {}
+
+    void TwistRepeater::publish(const geometry_msgs::Twist &twist)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        latest = twist;
+        moving = twist.linear.x != 0 || twist.angular.z != 0;
+        publisher.publish(latest);
+    }
+
+    void TwistRepeater::repeat(const ros::TimerEvent &event)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (moving)
+            publisher.publish(latest);
+    }
+}
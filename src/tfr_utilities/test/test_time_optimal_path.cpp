@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+#include "time_optimal_path.h"
+
+using tfr_utilities::TimeOptimalPath;
+
+namespace
+{
+    const double RESOLUTION = 0.05;
+    const double DEVIATION = 0.1;
+    //blends are only bounded at their samples, so a little over between
+    const double BLEND_SLACK = 1.05;
+    //the profile's own discretization error
+    const double SLACK = 1e-6;
+
+    TimeOptimalPath::Limits limits(size_t joints, double velocity, double acceleration)
+    {
+        return TimeOptimalPath::Limits{std::vector<double>(joints, velocity),
+            std::vector<double>(joints, acceleration)};
+    }
+
+    /*
+     * Checks the profile starts and ends at rest at the ends of the path and
+     * never asks for more than the limits between its points
+     * */
+    void expectWithin(const std::vector<TimeOptimalPath::Point> &profile,
+            const std::vector<double> &from, const std::vector<double> &to,
+            double velocity, double acceleration)
+    {
+        ASSERT_FALSE(profile.empty());
+        EXPECT_EQ(profile.front().time, 0);
+        for (size_t j = 0; j < from.size(); j++)
+        {
+            EXPECT_NEAR(profile.front().position[j], from[j], SLACK);
+            EXPECT_NEAR(profile.back().position[j], to[j], SLACK);
+            EXPECT_NEAR(profile.front().velocity[j], 0, SLACK);
+            EXPECT_NEAR(profile.back().velocity[j], 0, SLACK);
+        }
+        for (size_t i = 1; i < profile.size(); i++)
+        {
+            const auto &a = profile[i - 1], &b = profile[i];
+            double dt = b.time - a.time;
+            ASSERT_GT(dt, 0);
+            for (size_t j = 0; j < from.size(); j++)
+            {
+                EXPECT_LE(std::abs(b.velocity[j]), velocity + SLACK);
+                EXPECT_LE(std::abs(b.velocity[j] - a.velocity[j]) / dt, acceleration + SLACK);
+            }
+        }
+    }
+
+    /*
+     * Checks the profile only stops at its ends, and passes corner no
+     * further than the deviation away, returning how close it came
+     * */
+    double expectBlended(const std::vector<TimeOptimalPath::Point> &profile,
+            const std::vector<double> &corner)
+    {
+        double closest = std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < profile.size(); i++)
+        {
+            double speed = 0, away = 0;
+            for (size_t j = 0; j < corner.size(); j++)
+            {
+                speed += profile[i].velocity[j] * profile[i].velocity[j];
+                away += std::pow(profile[i].position[j] - corner[j], 2);
+            }
+            if (i > 0 && i + 1 < profile.size())
+            {
+                EXPECT_GT(std::sqrt(speed), 0.01) << "stopped at " << i;
+            }
+            closest = std::min(closest, std::sqrt(away));
+        }
+        //the samples straddle the arc's middle
+        EXPECT_LE(closest, DEVIATION + 1e-3);
+        return closest;
+    }
+}
+
+TEST(TimeOptimalPath, Trapezoid)
+{
+    TimeOptimalPath timing{limits(1, 0.5, 0.5), RESOLUTION};
+    std::vector<TimeOptimalPath::Point> profile;
+    ASSERT_TRUE(timing.compute({{0}, {1}}, profile));
+    expectWithin(profile, {0}, {1}, 0.5, 0.5);
+    //1 s up to speed over 0.25, 1 s at speed over 0.5, 1 s back down
+    EXPECT_NEAR(profile.back().time, 3.0, SLACK);
+}
+
+TEST(TimeOptimalPath, Triangle)
+{
+    TimeOptimalPath timing{limits(2, 10, 0.5), RESOLUTION};
+    std::vector<TimeOptimalPath::Point> profile;
+    ASSERT_TRUE(timing.compute({{0, 0}, {0.6, -0.8}}, profile));
+    expectWithin(profile, {0, 0}, {0.6, -0.8}, 10, 0.5);
+    //the upper arm's 0.8 is the limit, half speeding up, half slowing down
+    EXPECT_NEAR(profile.back().time, 2 * std::sqrt(0.8 / 0.5), SLACK);
+}
+
+TEST(TimeOptimalPath, ShortMoves)
+{
+    TimeOptimalPath timing{limits(1, 1, 1), RESOLUTION};
+    for (double length : {0.0001, 0.005, 0.01, 0.04, 0.05})
+    {
+        std::vector<TimeOptimalPath::Point> profile;
+        ASSERT_TRUE(timing.compute({{1}, {1 + length}}, profile)) << length;
+        expectWithin(profile, {1}, {1 + length}, 1, 1);
+        EXPECT_NEAR(profile.back().time, 2 * std::sqrt(length), SLACK) << length;
+    }
+}
+
+TEST(TimeOptimalPath, NoMove)
+{
+    TimeOptimalPath timing{limits(2, 1, 1), RESOLUTION};
+    std::vector<TimeOptimalPath::Point> profile;
+    ASSERT_TRUE(timing.compute({{0.5, 0.5}, {0.5, 0.5}, {0.5, 0.5}}, profile));
+    ASSERT_EQ(profile.size(), 1u);
+    EXPECT_EQ(profile[0].time, 0);
+    EXPECT_EQ(profile[0].position, std::vector<double>({0.5, 0.5}));
+    EXPECT_EQ(profile[0].velocity, std::vector<double>({0, 0}));
+}
+
+TEST(TimeOptimalPath, Reversal)
+{
+    //there's nothing to blend, so it's the same either way
+    for (double deviation : {0.0, DEVIATION})
+    {
+        TimeOptimalPath timing{limits(1, 1, 1), RESOLUTION, deviation};
+        std::vector<TimeOptimalPath::Point> profile;
+        ASSERT_TRUE(timing.compute({{0}, {0.5}, {0.1}}, profile));
+        expectWithin(profile, {0}, {0.1}, 1, 1);
+
+        //stops at the cusp, then two triangles
+        bool stopped = false;
+        for (const auto &point : profile)
+            if (std::abs(point.position[0] - 0.5) < SLACK)
+                stopped = std::abs(point.velocity[0]) < SLACK;
+        EXPECT_TRUE(stopped);
+        EXPECT_NEAR(profile.back().time, 2 * std::sqrt(0.5) + 2 * std::sqrt(0.4), SLACK);
+    }
+}
+
+TEST(TimeOptimalPath, BlendedCorner)
+{
+    //turning through 120 degrees
+    std::vector<std::vector<double>> path{{0, 0}, {1, 0}, {0.5, std::sqrt(0.75)}};
+    TimeOptimalPath blended{limits(2, 1, 1), RESOLUTION, DEVIATION};
+    std::vector<TimeOptimalPath::Point> profile;
+    ASSERT_TRUE(blended.compute(path, profile));
+    expectWithin(profile, path.front(), path.back(), 1, BLEND_SLACK);
+    //the middle of the arc is exactly the deviation out
+    EXPECT_NEAR(expectBlended(profile, path[1]), DEVIATION, 1e-3);
+
+    //without the blend it stops at the corner, a trapezoid then a triangle
+    //with the upper arm at full acceleration
+    TimeOptimalPath sharp{limits(2, 1, 1), RESOLUTION};
+    std::vector<TimeOptimalPath::Point> stopping;
+    ASSERT_TRUE(sharp.compute(path, stopping));
+    EXPECT_NEAR(stopping.back().time, 2 + 2 * std::sqrt(std::sqrt(0.75)), SLACK);
+    EXPECT_LT(profile.back().time, stopping.back().time - 0.1);
+}
+
+TEST(TimeOptimalPath, SharpCorners)
+{
+    //well past a right angle, the blends get tighter but it never stops
+    TimeOptimalPath timing{limits(3, 1, 2), RESOLUTION, DEVIATION};
+    std::vector<std::vector<double>> path{{0, 0, 0}, {1, 0, 0}, {0.2, 0.3, 0},
+        {0.2, 0.3, 0.4}, {0.3, 0.4, 0.45}, {0.6, 0.7, 0.6}};
+    std::vector<TimeOptimalPath::Point> profile;
+    ASSERT_TRUE(timing.compute(path, profile));
+    expectWithin(profile, path.front(), path.back(), 1, 2 * BLEND_SLACK);
+    for (size_t k = 1; k + 1 < path.size(); k++)
+        expectBlended(profile, path[k]);
+}
+
+TEST(TimeOptimalPath, BadLimits)
+{
+    std::vector<TimeOptimalPath::Point> profile;
+    TimeOptimalPath zero{limits(1, 0, 1), RESOLUTION};
+    EXPECT_FALSE(zero.compute({{0}, {1}}, profile));
+    TimeOptimalPath timing{limits(2, 1, 1), RESOLUTION};
+    EXPECT_FALSE(timing.compute({{0}, {1}}, profile));
+    EXPECT_FALSE(timing.compute({}, profile));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}